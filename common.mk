@@ -1,19 +1,47 @@
 
 CFLAGS = $(DEFINES) $(INCLUDES) $(OPT_FLAGS) -std=gnu11 
 CXXFLAGS = $(DEFINES) $(INCLUDES) $(OPT_FLAGS) -std=gnu++11 
-LDFLAGS = -Wl,--start-group -lSDL -lSDL_image -lpng -ljpeg -lSDL_mixer -logg -lvorbisidec -lmikmod -lmodplug -lm -pthread -lz -lstdc++ $(EXTRA_LDFLAGS) -Wl,--end-group
+
+# make TRACE=YES: timeline of frame phases, dumped to ~/.gambatte/trace.json (see common/trace.h)
+ifeq ($(TRACE), YES)
+DEFINES += -DENABLE_TRACE
+endif
+# make PROFILE=YES: instructions and cycles per ROM bank and PC, written to ~/.gambatte/profile.txt (see libgambatte/src/profiler.h)
+ifeq ($(PROFILE), YES)
+DEFINES += -DENABLE_PROFILER
+endif
+# make CPUTRACE=YES: ring of the last instructions run, see libgambatte/src/cputrace.h
+ifeq ($(CPUTRACE), YES)
+DEFINES += -DENABLE_CPU_TRACE
+endif
+LDFLAGS = -Wl,--start-group -lSDL -lSDL_image -lpng -ljpeg -lSDL_mixer -logg -lvorbisidec -lmikmod -lmodplug -lm -pthread -lrt -lz -lstdc++ $(EXTRA_LDFLAGS) -Wl,--end-group
+
+RESAMPLE_OBJS = \
+	common/resample/src/chainresampler.o \
+	common/resample/src/i0.o \
+	common/resample/src/kaiser50sinc.o \
+	common/resample/src/kaiser70sinc.o \
+	common/resample/src/makesinckernel.o \
+	common/resample/src/resamplerinfo.o \
+	common/resample/src/u48div.o
+
+RESAMPLERBENCH_OBJS = common/resample/bench/resamplerbench.o $(RESAMPLE_OBJS)
+RESAMPLERQUALITY_OBJS = common/resample/bench/resamplerquality.o $(RESAMPLE_OBJS)
+SCALERBENCH_OBJS = gambatte_sdl/bench/scalerbench.o gambatte_sdl/bench/legacyscalers.o gambatte_sdl/scaler.o gambatte_sdl/scalerengine.o gambatte_sdl/ghostblend.o
 
 # Redream (main engine)
-OBJS =  \
+LIBGAMBATTE_OBJS = \
 	libgambatte/src/bitmap_font.o \
 	libgambatte/src/bootloader.o \
 	libgambatte/src/cpu.o \
+	libgambatte/src/cputrace.o \
 	libgambatte/src/gambatte.o \
 	libgambatte/src/initstate.o \
 	libgambatte/src/interrupter.o \
 	libgambatte/src/interruptrequester.o \
 	libgambatte/src/loadres.o \
 	libgambatte/src/memory.o \
+	libgambatte/src/profiler.o \
 	libgambatte/src/sound.o \
 	libgambatte/src/state_osd_elements.o \
 	libgambatte/src/statesaver.o \
@@ -34,17 +62,26 @@ OBJS =  \
 	libgambatte/src/video/lyc_irq.o \
 	libgambatte/src/video/next_m0_time.o \
 	libgambatte/src/video/ppu.o \
-	libgambatte/src/video/sprite_mapper.o
+	libgambatte/src/video/sprite_mapper.o \
+	libgambatte/src/video/tile_cache.o
 	
 ifeq ($(NOZIP), YES)
-OBJS += libgambatte/src/file/file.o
+LIBGAMBATTE_OBJS += libgambatte/src/file/file.o
 else
-OBJS += libgambatte/src/file/file_zip.o libgambatte/src/file/unzip/ioapi.o libgambatte/src/file/unzip/unzip.o
+LIBGAMBATTE_OBJS += libgambatte/src/file/file_zip.o libgambatte/src/file/unzip/ioapi.o libgambatte/src/file/unzip/unzip.o
 endif
+
+INPUTLATENCY_OBJS = gambatte_sdl/bench/inputlatency.o $(LIBGAMBATTE_OBJS) common/trace.o
+ROMCRAWL_OBJS = gambatte_sdl/bench/romcrawl.o $(LIBGAMBATTE_OBJS) common/trace.o
+COREBENCH_OBJS = gambatte_sdl/bench/corebench.o $(LIBGAMBATTE_OBJS) common/trace.o
+RAMSEARCHBENCH_OBJS = gambatte_sdl/bench/ramsearchbench.o gambatte_sdl/ramsearch.o $(LIBGAMBATTE_OBJS) common/trace.o
+NETPLAYBENCH_OBJS = common/netplay/bench/netplaybench.o common/netplay/netplay.o common/netplay/nettransport.o $(LIBGAMBATTE_OBJS) common/trace.o
 	
-OBJS +=	gambatte_sdl/src/audiosink.o \
+OBJS =	$(LIBGAMBATTE_OBJS) \
+	gambatte_sdl/src/audiosink.o \
 	gambatte_sdl/src/blitterwrapper.o \
 	gambatte_sdl/src/parser.o \
+	gambatte_sdl/src/recorder.o \
 	gambatte_sdl/src/sdlblitter.o \
 	gambatte_sdl/src/str_to_sdlkey.o \
 	gambatte_sdl/src/usec.o \
@@ -53,14 +90,14 @@ OBJS +=	gambatte_sdl/src/audiosink.o \
 	gambatte_sdl/menu.o \
 	gambatte_sdl/libmenu.o \
 	gambatte_sdl/scaler.o \
-	common/adaptivesleep.o \
-	common/resample/src/chainresampler.o \
-	common/resample/src/i0.o \
-	common/resample/src/kaiser50sinc.o \
-	common/resample/src/kaiser70sinc.o \
-	common/resample/src/makesinckernel.o \
-	common/resample/src/resamplerinfo.o \
-	common/resample/src/u48div.o \
+	gambatte_sdl/scalerengine.o \
+	gambatte_sdl/ghostblend.o \
+	gambatte_sdl/bordercache.o \
+	gambatte_sdl/ramsearch.o \
+	common/framepacer.o \
+	common/perfhud.o \
+	common/trace.o \
+	$(RESAMPLE_OBJS) \
 	common/rateest.o \
 	common/skipsched.o \
 	common/videolink/rgb32conv.o \
@@ -82,5 +119,39 @@ builddate:
 executable: $(OBJS)
 	$(CC) -o $(OUTPUTNAME) $(OBJS) $(CFLAGS) $(LDFLAGS)
 
+# Resampler throughput benchmark, run it on the device: ./resamplerbench [outrate] [seconds]
+resamplerbench: $(RESAMPLERBENCH_OBJS)
+	$(CXX) -o $@ $(RESAMPLERBENCH_OBJS) $(CXXFLAGS) -lm -lstdc++
+
+# Resampler cost/quality table (cpu, heap, delay, SNR, alias rejection): ./resamplerquality [outrate...]
+resamplerquality: $(RESAMPLERQUALITY_OBJS)
+	$(CXX) -o $@ $(RESAMPLERQUALITY_OBJS) $(CXXFLAGS) -lm -lstdc++
+
+# Scaler ns/frame, bytes touched and LLC miss rate: ./scalerbench [-n frames] [capture.bmp...]
+scalerbench: $(SCALERBENCH_OBJS)
+	$(CXX) -o $@ $(SCALERBENCH_OBJS) $(CXXFLAGS) -lSDL -lm -lstdc++
+
+# Input to photon latency with and without late input latching: ./inputlatency [-b button] [-f frames] rom
+inputlatency: $(INPUTLATENCY_OBJS)
+	$(CXX) -o $@ $(INPUTLATENCY_OBJS) $(CXXFLAGS) -lz -lm -pthread -lstdc++
+
+# Boots every ROM under dir with random buttons, one per CPU, and writes fps, slow memory
+# access peaks (with PROFILE=YES), hangs and crashes as CSV: ./romcrawl [-s seconds] [-j jobs] dir > crawl.csv
+romcrawl: $(ROMCRAWL_OBJS)
+	$(CXX) -o $@ $(ROMCRAWL_OBJS) $(CXXFLAGS) -lz -lm -pthread -lstdc++
+
+# Rollback netplay soak test over the loopback (or -u player:localport:host:port over UDP),
+# rollback depth and cost per frame: ./netplaybench [-f frames] [-d delay] [-l min-max] [-p loss%] rom
+netplaybench: $(NETPLAYBENCH_OBJS)
+	$(CXX) -o $@ $(NETPLAYBENCH_OBJS) $(CXXFLAGS) -lz -lm -pthread -lstdc++
+
+# Core ms/frame headless, with a video hash to check two builds emulate the same: ./corebench [-f frames] [-r runs] rom...
+corebench: $(COREBENCH_OBJS)
+	$(CXX) -o $@ $(COREBENCH_OBJS) $(CXXFLAGS) -lz -lm -pthread -lstdc++
+
+# RAM search SIMD against plain C++ filtering, same candidates and ns per pass: ./ramsearchbench [-f frames] [-n passes] rom
+ramsearchbench: $(RAMSEARCHBENCH_OBJS)
+	$(CXX) -o $@ $(RAMSEARCHBENCH_OBJS) $(CXXFLAGS) -lz -lm -pthread -lstdc++
+
 clean:
-	rm $(OBJS) $(OUTPUTNAME)
+	rm -f $(OBJS) $(OUTPUTNAME) $(RESAMPLERBENCH_OBJS) resamplerbench $(RESAMPLERQUALITY_OBJS) resamplerquality $(SCALERBENCH_OBJS) scalerbench $(INPUTLATENCY_OBJS) inputlatency $(ROMCRAWL_OBJS) romcrawl $(NETPLAYBENCH_OBJS) netplaybench $(COREBENCH_OBJS) corebench $(RAMSEARCHBENCH_OBJS) ramsearchbench
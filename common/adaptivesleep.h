@@ -1,35 +0,0 @@
-/***************************************************************************
- *   Copyright (C) 2008 by Sindre Aamås                                    *
- *   sinamas@users.sourceforge.net                                         *
- *                                                                         *
- *   This program is free software; you can redistribute it and/or modify  *
- *   it under the terms of the GNU General Public License version 2 as     *
- *   published by the Free Software Foundation.                            *
- *                                                                         *
- *   This program is distributed in the hope that it will be useful,       *
- *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
- *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
- *   GNU General Public License version 2 for more details.                *
- *                                                                         *
- *   You should have received a copy of the GNU General Public License     *
- *   version 2 along with this program; if not, write to the               *
- *   Free Software Foundation, Inc.,                                       *
- *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
- ***************************************************************************/
-#ifndef ADAPTIVE_SLEEP_H
-#define ADAPTIVE_SLEEP_H
-
-#include "usec.h"
-
-class AdaptiveSleep {
-public:
-	AdaptiveSleep() : oversleep_(0), oversleepVar_(0), noSleep_(60) {}
-	usec_t sleepUntil(usec_t base, usec_t inc);
-
-private:
-	usec_t oversleep_;
-	usec_t oversleepVar_;
-	unsigned noSleep_;
-};
-
-#endif
@@ -0,0 +1,82 @@
+#include "framepacer.h"
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+
+static long long monotonicNs() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static void sleepUntilNs(long long t) {
+	timespec ts;
+	ts.tv_sec = t / 1000000000;
+	ts.tv_nsec = t % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR)
+		;
+}
+
+static usec_t absdiff(usec_t a, usec_t b) { return a < b ? b - a : a - b; }
+
+FramePacer::FramePacer()
+: deadline_(0)
+, jitterMean_(0)
+, jitterVar_(0)
+, spinMargin_(0)
+, windowPos_(0)
+{
+	std::fill(window_, window_ + jitter_window, 0);
+	std::fill(hist_, hist_ + num_jitter_buckets, 0);
+	hist_[0] = jitter_window;
+}
+
+usec_t FramePacer::jitterBucketLimit(int bucket) {
+	static usec_t const limits[num_jitter_buckets] = {
+		50, 100, 250, 500, 1000, 2000, 4000, usec_t(-1)
+	};
+
+	return limits[bucket];
+}
+
+void FramePacer::recordJitter(usec_t const jitter) {
+	int bucket = 0;
+	while (jitter >= jitterBucketLimit(bucket))
+		++bucket;
+
+	--hist_[window_[windowPos_]];
+	++hist_[bucket];
+	window_[windowPos_] = bucket;
+	windowPos_ = (windowPos_ + 1) % jitter_window;
+
+	jitterVar_ = (jitterVar_ * 15 + absdiff(jitter, jitterMean_) + 8) >> 4;
+	jitterMean_ = (jitterMean_ * 15 + jitter + 8) >> 4;
+
+	// Only spin when sleeping alone would regularly miss the deadline.
+	usec_t const expected = jitterMean_ + 2 * jitterVar_;
+	spinMargin_ = expected > spin_threshold
+	            ? std::min<usec_t>(expected, max_spin_margin)
+	            : 0;
+}
+
+void FramePacer::waitForNextFrameTime(usec_t const frametime) {
+	long long now = monotonicNs();
+	if (!deadline_)
+		deadline_ = now;
+
+	deadline_ += frametime * 1000ll;
+	if (now >= deadline_) {
+		deadline_ = now;
+		return;
+	}
+
+	long long const wake = deadline_ - spinMargin_ * 1000ll;
+	if (wake > now) {
+		sleepUntilNs(wake);
+		now = monotonicNs();
+		recordJitter(now > wake ? usec_t((now - wake) / 1000) : 0);
+	}
+
+	while (now < deadline_)
+		now = monotonicNs();
+}
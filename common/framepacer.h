@@ -0,0 +1,44 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include "usec.h"
+
+// Frame pacing that sleeps on an absolute CLOCK_MONOTONIC deadline rather than
+// spinning the last stretch of every frame. The wake-up jitter of
+// every sleep is measured, and only when it is too large to hit the deadline
+// (coarse timers, no hrtimers) does it wake early and spin the remainder.
+class FramePacer {
+public:
+	enum { num_jitter_buckets = 8 };
+	enum { jitter_window = 256 };
+
+	FramePacer();
+
+	// Returns when frametime usecs have passed since the previous deadline.
+	// Falling behind moves the deadline instead of trying to catch up.
+	void waitForNextFrameTime(usec_t frametime);
+
+	// Number of the last jitter_window wake-ups that were late by less than
+	// jitterBucketLimit(bucket), but not less than the previous bucket's limit.
+	unsigned jitterCount(int bucket) const { return hist_[bucket]; }
+	static usec_t jitterBucketLimit(int bucket);
+
+	usec_t jitterMean() const { return jitterMean_; }
+	bool spinning() const { return spinMargin_ != 0; }
+
+private:
+	enum { spin_threshold = 1000 };
+	enum { max_spin_margin = 8000 };
+
+	long long deadline_;
+	usec_t jitterMean_;
+	usec_t jitterVar_;
+	usec_t spinMargin_;
+	unsigned char window_[jitter_window];
+	unsigned windowPos_;
+	unsigned hist_[num_jitter_buckets];
+
+	void recordJitter(usec_t jitter);
+};
+
+#endif
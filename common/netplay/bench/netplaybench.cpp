@@ -0,0 +1,277 @@
+// Rollback netplay soak test and cost report.
+//
+// Runs a ROM with both players mashing random buttons, and reports for each
+// peer how often and how far it rolled back, what running frames again cost
+// and what saving state every frame costs.
+//
+// By default both peers run in this process over a LoopbackTransport with
+// the given delay and loss, and at the end the states of their Game Boys are
+// compared: any difference is a desync, i.e. something the save states miss.
+// With -u it is one peer of a real session over UDP, run in real time; run
+// it on both ends and compare the hashes printed at the end.
+//
+// usage: netplaybench [-f frames] [-d delay] [-l min-max] [-p loss%] [-s seed] rom
+//        netplaybench -u player:localport:host:port [-f frames] [-d delay] rom
+//
+//   -f  frames to run (3600)
+//   -d  input delay in frames (2)
+//   -l  loopback latency range in frames, one way (1-4)
+//   -p  percentage of datagrams the loopback drops (5)
+//   -s  seed for the buttons and the loopback (1)
+
+#include "../netplay.h"
+#include <gambatte.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+using gambatte::GB;
+using gambatte::uint_least32_t;
+
+enum { gb_width = 160, gb_height = 144 };
+
+// Holds a random set of buttons for a random number of frames.
+class Masher {
+public:
+	explicit Masher(unsigned long seed) : rng_(seed), held_(0), left_(0) { next(); }
+
+	unsigned buttons() const { return held_; }
+
+	void next() {
+		if (left_) {
+			--left_;
+			return;
+		}
+
+		// start and select reset some games when pressed together.
+		held_ = random() & ~0x0Cu;
+		left_ = random() % 16;
+	}
+
+private:
+	unsigned long rng_;
+	unsigned held_;
+	unsigned left_;
+
+	unsigned random() {
+		rng_ = (rng_ * 1103515245ul + 12345) & 0x7FFFFFFFul;
+		return rng_ >> 16;
+	}
+};
+
+struct Peer {
+	GB gb[2];
+	std::vector<uint_least32_t> video;
+	std::vector<uint_least32_t> audio;
+	Masher masher;
+
+	explicit Peer(unsigned long seed)
+	: video(gb_width * gb_height)
+	, audio(Netplay::samples_per_frame + 2064)
+	, masher(seed)
+	{
+	}
+
+	bool load(char const *rom) { return !gb[0].load(rom) && !gb[1].load(rom); }
+
+	void step(Netplay &netplay) {
+		std::size_t samples = 0;
+		netplay.runFrame(masher.buttons(), &video[0], gb_width, &audio[0], samples);
+		if (samples)
+			masher.next();
+	}
+};
+
+unsigned long memoryHash(GB &gb) {
+	static GB::MemoryArea const areas[] = { GB::WRAM, GB::HRAM, GB::SRAM };
+	unsigned long h = 2166136261ul;
+	for (std::size_t a = 0; a < sizeof areas / sizeof *areas; ++a) {
+		std::size_t size = 0;
+		unsigned char const *const p = gb.memoryArea(areas[a], size);
+		for (std::size_t i = 0; i < size; ++i)
+			h = ((h ^ p[i]) * 16777619ul) & 0xFFFFFFFFul;
+	}
+
+	return h;
+}
+
+std::string state(GB &gb) {
+	std::ostringstream out;
+	gb.saveState(out);
+	return out.str();
+}
+
+void report(char const *name, Netplay const &netplay) {
+	Netplay::Stats const &s = netplay.stats();
+	double const frames = s.frames ? s.frames : 1;
+	std::printf("%s: %lu frames, %lu stalls, %lu rollbacks, %.2f frames run again per frame\n",
+	            name, s.frames, s.stalls, s.rollbacks, s.resimulatedFrames / frames);
+	std::printf("  rollback depth:");
+	for (int d = 1; d <= Netplay::max_rollback; ++d)
+		std::printf(" %d:%lu", d, s.depth[d]);
+
+	std::printf("\n  per frame: %.3f ms in all, %.3f ms saving state, %.3f ms running frames again"
+	            " (worst rollback %.3f ms)\n",
+	            s.frameUsecs / frames / 1000, s.saveUsecs / frames / 1000,
+	            s.resimulateUsecs / frames / 1000, s.maxResimulateUsecs / 1000.0);
+}
+
+long long monotonicUsecs() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+int runLoopback(char const *rom, unsigned long frames, int delay,
+                unsigned minLatency, unsigned maxLatency, unsigned loss, unsigned long seed) {
+	Peer a(seed), b(seed * 31 + 7);
+	if (!a.load(rom) || !b.load(rom)) {
+		std::fprintf(stderr, "failed to load ROM %s\n", rom);
+		return EXIT_FAILURE;
+	}
+
+	LoopbackTransport ta(seed), tb(seed + 1);
+	LoopbackTransport::connect(ta, tb);
+	ta.setConditions(minLatency, maxLatency, loss);
+	tb.setConditions(minLatency, maxLatency, loss);
+
+	GB *const gba[2] = { &a.gb[0], &a.gb[1] };
+	GB *const gbb[2] = { &b.gb[0], &b.gb[1] };
+	Netplay pa(gba, ta, 0, delay);
+	Netplay pb(gbb, tb, 1, delay);
+
+	// a lost datagram is made up for by the next, so this only runs out
+	// when nothing gets through at all.
+	for (unsigned long tick = 0; pa.confirmedFrames() < frames || pb.confirmedFrames() < frames; ++tick) {
+		if (tick > frames * 10 + 1000) {
+			std::puts("stuck: the peers stopped hearing from each other");
+			return EXIT_FAILURE;
+		}
+
+		if (pa.frame() < frames)
+			a.step(pa);
+		else
+			pa.sync();
+
+		if (pb.frame() < frames)
+			b.step(pb);
+		else
+			pb.sync();
+
+		ta.advance();
+		tb.advance();
+	}
+
+	pa.sync();
+	pb.sync();
+
+	std::printf("%s: %lu frames, delay %d, latency %u-%u frames, %u%% loss\n",
+	            rom, frames, delay, minLatency, maxLatency, loss);
+	report("peer 0", pa);
+	report("peer 1", pb);
+
+	bool synced = !pa.mismatched() && !pb.mismatched();
+	for (int i = 0; i < 2; ++i) {
+		if (state(a.gb[i]) != state(b.gb[i])) {
+			std::printf("player %d's Game Boy desynced: memory %08lx vs %08lx\n",
+			            i, memoryHash(a.gb[i]), memoryHash(b.gb[i]));
+			synced = false;
+		}
+	}
+
+	std::puts(synced ? "in sync" : "DESYNC");
+	return synced ? 0 : EXIT_FAILURE;
+}
+
+int runUdp(char const *rom, char const *spec, unsigned long frames, int delay, unsigned long seed) {
+	int player = 0;
+	unsigned localPort = 0, port = 0;
+	char host[256] = "";
+	if (std::sscanf(spec, "%d:%u:%255[^:]:%u", &player, &localPort, host, &port) != 4
+			|| (player != 0 && player != 1)) {
+		std::fprintf(stderr, "expected -u player:localport:host:port, got %s\n", spec);
+		return EXIT_FAILURE;
+	}
+
+	Peer peer(seed * (player + 1));
+	if (!peer.load(rom)) {
+		std::fprintf(stderr, "failed to load ROM %s\n", rom);
+		return EXIT_FAILURE;
+	}
+
+	UdpTransport transport;
+	if (!transport.open(localPort, host, port))
+		return EXIT_FAILURE;
+
+	GB *const gb[2] = { &peer.gb[0], &peer.gb[1] };
+	Netplay netplay(gb, transport, player, delay);
+	long long deadline = monotonicUsecs();
+	while (netplay.frame() < frames) {
+		peer.step(netplay);
+		deadline += 16743;
+		long long const wait = deadline - monotonicUsecs();
+		if (wait > 0)
+			usleep(wait);
+	}
+
+	// keep answering for a while, in case the other end still misses input.
+	long long const end = monotonicUsecs() + 2000000;
+	while (netplay.confirmedFrames() < frames || monotonicUsecs() < end) {
+		netplay.sync();
+		usleep(1000);
+	}
+
+	report(player ? "peer 1" : "peer 0", netplay);
+	if (netplay.mismatched())
+		std::puts("the other peer started from a different ROM, save data or delay");
+
+	std::printf("memory hashes %08lx %08lx\n", memoryHash(peer.gb[0]), memoryHash(peer.gb[1]));
+	return 0;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long frames = 3600;
+	int delay = 2;
+	unsigned minLatency = 1, maxLatency = 4, loss = 5;
+	unsigned long seed = 1;
+	char const *udp = 0;
+	char const *rom = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (argv[i][0] != '-') {
+			rom = argv[i];
+			continue;
+		}
+
+		char const *const arg = i + 1 < argc && !argv[i][2] ? argv[++i] : 0;
+		switch (arg ? argv[i - 1][1] : 0) {
+		case 'f': frames = std::strtoul(arg, 0, 0); break;
+		case 'd': delay = std::atoi(arg); break;
+		case 'l': std::sscanf(arg, "%u-%u", &minLatency, &maxLatency); break;
+		case 'p': loss = std::atoi(arg); break;
+		case 's': seed = std::strtoul(arg, 0, 0); break;
+		case 'u': udp = arg; break;
+		default: rom = 0; i = argc; break;
+		}
+	}
+
+	if (!rom || loss > 100) {
+		std::fputs("usage: netplaybench [-f frames] [-d delay] [-l min-max] [-p loss%] [-s seed] rom\n"
+		           "       netplaybench -u player:localport:host:port [-f frames] [-d delay] rom\n",
+		           stderr);
+		return EXIT_FAILURE;
+	}
+
+	return udp
+	     ? runUdp(rom, udp, frames, delay, seed)
+	     : runLoopback(rom, frames, delay, minLatency, maxLatency, loss, seed);
+}
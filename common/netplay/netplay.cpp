@@ -0,0 +1,265 @@
+#include "netplay.h"
+#include <algorithm>
+#include <ctime>
+#include <istream>
+#include <ostream>
+
+namespace {
+
+enum { header_size = 15, max_inputs_per_datagram = 64 };
+
+unsigned long long monotonicUsecs() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+unsigned long fnv(unsigned long h, unsigned char const *p, std::size_t n) {
+	while (n--)
+		h = ((h ^ *p++) * 16777619ul) & 0xFFFFFFFFul;
+
+	return h;
+}
+
+void put32(unsigned char *p, unsigned long v) {
+	p[0] = v >> 24 & 0xFF;
+	p[1] = v >> 16 & 0xFF;
+	p[2] = v >>  8 & 0xFF;
+	p[3] = v       & 0xFF;
+}
+
+unsigned long get32(unsigned char const *p) {
+	return (unsigned long)p[0] << 24 | (unsigned long)p[1] << 16 | p[2] << 8 | p[3];
+}
+
+}
+
+void Netplay::StateBuffer::rewind() {
+	char *const p = data_.empty() ? 0 : &data_[0];
+	setg(p, p, p + data_.size());
+}
+
+Netplay::StateBuffer::int_type Netplay::StateBuffer::overflow(int_type const c) {
+	if (!traits_type::eq_int_type(c, traits_type::eof()))
+		data_.push_back(traits_type::to_char_type(c));
+
+	return traits_type::not_eof(c);
+}
+
+std::streamsize Netplay::StateBuffer::xsputn(char const *const s, std::streamsize const n) {
+	data_.insert(data_.end(), s, s + n);
+	return n;
+}
+
+Netplay::Netplay(gambatte::GB *const gb[2], NetTransport &transport,
+                 int const localPlayer, int const inputDelay)
+: transport_(transport)
+, local_(localPlayer & 1)
+, delay_(std::min(std::max(inputDelay, 0), int(max_input_delay)))
+, pos_()
+, scratch_(samples_per_frame + 2064)
+, frame_(0)
+, localEnd_(delay_)
+, remoteEnd_(delay_)
+, remoteAck_(delay_)
+, rollbackTo_(0)
+, session_(2166136261ul)
+, mismatched_(false)
+, stats_()
+{
+	std::fill(inputs_[0], inputs_[0] + input_ring, 0);
+	std::fill(inputs_[1], inputs_[1] + input_ring, 0);
+	std::fill(used_, used_ + input_ring, 0);
+
+	for (int i = 0; i < 2; ++i) {
+		gb_[i] = gb[i];
+		cable_[i].other = gb[i ^ 1];
+		gb_[i]->setInputGetter(&input_[i]);
+		gb_[i]->setLateInputLatch(false);
+		gb_[i]->setLinkCable(&cable_[i]);
+
+		std::size_t size = 0;
+		unsigned char const *const sram = gb_[i]->memoryArea(gambatte::GB::SRAM, size);
+		std::string const title = gb_[i]->romTitle();
+		session_ = fnv(session_, reinterpret_cast<unsigned char const *>(title.data()), title.size());
+		session_ = fnv(session_, sram, size);
+	}
+
+	unsigned char const delay = delay_;
+	session_ = fnv(session_, &delay, 1);
+}
+
+Netplay::~Netplay() {
+	for (int i = 0; i < 2; ++i) {
+		gb_[i]->setLinkCable(0);
+		gb_[i]->setInputGetter(0);
+	}
+}
+
+void Netplay::send() {
+	unsigned char buf[header_size + max_inputs_per_datagram];
+	unsigned long const end = std::min(localEnd_, remoteAck_ + max_inputs_per_datagram);
+
+	buf[0] = 'G';
+	buf[1] = 'N';
+	put32(buf + 2, session_);
+	put32(buf + 6, remoteAck_);
+	put32(buf + 10, remoteEnd_);
+	buf[14] = end - remoteAck_;
+	for (unsigned long f = remoteAck_; f < end; ++f)
+		buf[header_size + f - remoteAck_] = inputs_[local_][f % input_ring];
+
+	transport_.send(buf, header_size + (end - remoteAck_));
+}
+
+void Netplay::receive() {
+	unsigned char buf[header_size + 255];
+	int const remote = local_ ^ 1;
+
+	while (std::size_t const n = transport_.receive(buf, sizeof buf)) {
+		if (n < header_size || buf[0] != 'G' || buf[1] != 'N' || n < header_size + std::size_t(buf[14]))
+			continue;
+
+		if (get32(buf + 2) != session_) {
+			mismatched_ = true;
+			continue;
+		}
+
+		unsigned long const ack = get32(buf + 10);
+		if (ack > remoteAck_ && ack <= localEnd_)
+			remoteAck_ = ack;
+
+		unsigned long const first = get32(buf + 6);
+		for (unsigned long f = std::max(first, remoteEnd_); f < first + buf[14]; ++f) {
+			// past remoteEnd_ would leave a gap, and the ring only reaches so far.
+			if (f != remoteEnd_ || f >= frame_ + input_ring / 2)
+				break;
+
+			unsigned char const in = buf[header_size + f - first];
+			inputs_[remote][f % input_ring] = in;
+			if (f < frame_ && used_[f % input_ring] != in)
+				rollbackTo_ = std::min(rollbackTo_, f);
+
+			++remoteEnd_;
+		}
+	}
+}
+
+void Netplay::save(unsigned long const frame) {
+	Snapshot &s = snapshots_[frame % (max_rollback + 1)];
+	for (int i = 0; i < 2; ++i) {
+		s.state[i].clear();
+		std::ostream out(&s.state[i]);
+		gb_[i]->saveState(out);
+		s.pos[i] = pos_[i];
+	}
+}
+
+void Netplay::load(unsigned long const frame) {
+	Snapshot &s = snapshots_[frame % (max_rollback + 1)];
+	for (int i = 0; i < 2; ++i) {
+		s.state[i].rewind();
+		std::istream in(&s.state[i]);
+		gb_[i]->loadState(in);
+		pos_[i] = s.pos[i];
+	}
+}
+
+std::ptrdiff_t Netplay::simulate(unsigned long const frame,
+                                 gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch,
+                                 gambatte::uint_least32_t *const audioBuf, std::size_t &samples) {
+	int const remote = local_ ^ 1;
+	unsigned char const remoteInput = frame < remoteEnd_
+	                                ? inputs_[remote][frame % input_ring]
+	                                : inputs_[remote][(remoteEnd_ - 1) % input_ring];
+	used_[frame % input_ring] = remoteInput;
+	input_[local_].is = inputs_[local_][frame % input_ring];
+	input_[remote].is = remoteInput;
+
+	// the two run in turns a fraction of a frame long, so that neither gets
+	// far ahead of the other between link cable transfers.
+	std::size_t const start = pos_[local_];
+	std::ptrdiff_t blit = -1;
+	for (int slice = 1; slice <= slices_per_frame; ++slice) {
+		std::size_t const target = std::size_t(samples_per_frame) * slice / slices_per_frame;
+		for (int i = 0; i < 2; ++i) {
+			while (pos_[i] < target) {
+				bool const output = i == local_ && audioBuf;
+				std::size_t n = target - pos_[i];
+				std::ptrdiff_t const b = gb_[i]->runFor(i == local_ ? videoBuf : 0, pitch,
+					output ? audioBuf + (pos_[i] - start) : &scratch_[0], n);
+				if (b >= 0 && output)
+					blit = pos_[i] - start + b;
+
+				pos_[i] += n;
+			}
+		}
+	}
+
+	samples = pos_[local_] - start;
+	pos_[0] -= samples_per_frame;
+	pos_[1] -= samples_per_frame;
+	return blit;
+}
+
+void Netplay::rollback(gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch) {
+	unsigned long long const start = monotonicUsecs();
+	unsigned long const from = rollbackTo_;
+
+	load(from);
+	for (unsigned long f = from; f < frame_; ++f) {
+		if (f != from)
+			save(f);
+
+		// frames span two runFrame calls, so the picture is drawn as usual.
+		std::size_t samples = 0;
+		simulate(f, videoBuf, pitch, 0, samples);
+	}
+
+	unsigned long const usecs = monotonicUsecs() - start;
+	++stats_.rollbacks;
+	++stats_.depth[frame_ - from];
+	stats_.resimulatedFrames += frame_ - from;
+	stats_.resimulateUsecs += usecs;
+	stats_.maxResimulateUsecs = std::max(stats_.maxResimulateUsecs, usecs);
+}
+
+void Netplay::sync() {
+	receive();
+	send();
+	if (rollbackTo_ < frame_)
+		rollback(0, 0);
+
+	rollbackTo_ = frame_;
+}
+
+std::ptrdiff_t Netplay::runFrame(unsigned const localInput,
+                                 gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch,
+                                 gambatte::uint_least32_t *const audioBuf, std::size_t &samples) {
+	unsigned long long const start = monotonicUsecs();
+
+	receive();
+	if (frame_ >= remoteEnd_ + max_rollback) {
+		++stats_.stalls;
+		send();
+		samples = 0;
+		return -1;
+	}
+
+	inputs_[local_][localEnd_ % input_ring] = localInput;
+	++localEnd_;
+	send();
+
+	if (rollbackTo_ < frame_)
+		rollback(videoBuf, pitch);
+
+	unsigned long long const saveStart = monotonicUsecs();
+	save(frame_);
+	stats_.saveUsecs += monotonicUsecs() - saveStart;
+
+	std::ptrdiff_t const blit = simulate(frame_, videoBuf, pitch, audioBuf, samples);
+	rollbackTo_ = ++frame_;
+	++stats_.frames;
+	stats_.frameUsecs += monotonicUsecs() - start;
+	return blit;
+}
@@ -0,0 +1,141 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include "nettransport.h"
+#include "uncopyable.h"
+#include <gambatte.h>
+#include <cstddef>
+#include <streambuf>
+#include <vector>
+
+// Two player rollback netplay for link cable games. Each peer runs both
+// Game Boys, joined by an emulated link cable, so only the buttons go over
+// the network. The remote player's buttons are predicted to stay as they
+// were; when they turn out to have changed, both Game Boys are put back to
+// the saved state of the first frame predicted wrong and run again with the
+// right buttons, so the picture jumps rather than the game waiting.
+//
+// Both peers must start from the same state: the same ROM, the same save
+// data for each player's Game Boy, and the same input delay. Games that
+// read the cartridge clock will drift apart, since it follows the wall clock.
+class Netplay : Uncopyable {
+public:
+	enum { max_rollback = 8 };
+	enum { max_input_delay = 16 };
+	enum { samples_per_frame = 35112 };
+
+	struct Stats {
+		unsigned long frames;
+		// calls to runFrame that ran nothing, the remote player being
+		// max_rollback frames behind.
+		unsigned long stalls;
+		unsigned long rollbacks;
+		// number of rollbacks going back 1 to max_rollback frames.
+		unsigned long depth[max_rollback + 1];
+		unsigned long resimulatedFrames;
+		unsigned long long resimulateUsecs;
+		unsigned long maxResimulateUsecs;
+		unsigned long long saveUsecs;
+		unsigned long long frameUsecs;
+	};
+
+	// gb[0] and gb[1] are the Game Boys of player 0 and player 1, already
+	// loaded. localPlayer is the one whose buttons runFrame gets. Input is
+	// applied inputDelay frames after it is given, which hides that much
+	// round trip without a rollback.
+	Netplay(gambatte::GB *const gb[2], NetTransport &transport, int localPlayer, int inputDelay);
+	~Netplay();
+
+	// Runs the next frame of both Game Boys with the local player's buttons,
+	// first running again any frames the remote buttons were predicted wrong
+	// for. Takes and returns the same as GB::runFor for the local player's
+	// Game Boy, except that it always runs a whole frame of samples; samples
+	// is 0 when it had to wait for the remote player.
+	std::ptrdiff_t runFrame(unsigned localInput, gambatte::uint_least32_t *videoBuf,
+	                        std::ptrdiff_t pitch, gambatte::uint_least32_t *audioBuf,
+	                        std::size_t &samples);
+
+	// Receives and resends input and rolls back if needed, without running
+	// a new frame. For catching up at the end of a session.
+	void sync();
+
+	unsigned long frame() const { return frame_; }
+
+	// Frames both players' buttons are known for.
+	unsigned long confirmedFrames() const { return remoteEnd_ < frame_ ? remoteEnd_ : frame_; }
+
+	// True once a datagram from a peer that started differently arrived.
+	bool mismatched() const { return mismatched_; }
+
+	Stats const & stats() const { return stats_; }
+
+private:
+	enum { input_ring = 256 };
+	enum { slices_per_frame = 32 };
+
+	class PlayerInput : public gambatte::InputGetter {
+	public:
+		unsigned is;
+		PlayerInput() : is(0) {}
+		virtual unsigned operator()() { return is; }
+	};
+
+	class Cable : public gambatte::LinkCable {
+	public:
+		gambatte::GB *other;
+		Cable() : other(0) {}
+		virtual unsigned exchange(unsigned data) { return other->linkTransfer(data); }
+	};
+
+	// Saved state of one Game Boy, reusing its memory from frame to frame.
+	class StateBuffer : public std::streambuf {
+	public:
+		void clear() { data_.clear(); setg(0, 0, 0); }
+		void rewind();
+
+	protected:
+		virtual int_type overflow(int_type c);
+		virtual std::streamsize xsputn(char const *s, std::streamsize n);
+
+	private:
+		std::vector<char> data_;
+	};
+
+	struct Snapshot {
+		StateBuffer state[2];
+		std::size_t pos[2];
+	};
+
+	gambatte::GB *gb_[2];
+	NetTransport &transport_;
+	int const local_;
+	int const delay_;
+	PlayerInput input_[2];
+	Cable cable_[2];
+	unsigned char inputs_[2][input_ring];
+	// the remote buttons each frame was last run with.
+	unsigned char used_[input_ring];
+	Snapshot snapshots_[max_rollback + 1];
+	// samples each Game Boy has run past the start of the frame.
+	std::size_t pos_[2];
+	std::vector<gambatte::uint_least32_t> scratch_;
+	unsigned long frame_;
+	unsigned long localEnd_;
+	unsigned long remoteEnd_;
+	unsigned long remoteAck_;
+	unsigned long rollbackTo_;
+	unsigned long session_;
+	bool mismatched_;
+	Stats stats_;
+
+	void receive();
+	void send();
+	void rollback(gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch);
+	void save(unsigned long frame);
+	void load(unsigned long frame);
+	std::ptrdiff_t simulate(unsigned long frame, gambatte::uint_least32_t *videoBuf,
+	                        std::ptrdiff_t pitch, gambatte::uint_least32_t *audioBuf,
+	                        std::size_t &samples);
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "nettransport.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+UdpTransport::UdpTransport()
+: fd_(-1)
+, peerAddr_(0)
+, peerPort_(0)
+{
+}
+
+UdpTransport::~UdpTransport() {
+	if (fd_ >= 0)
+		close(fd_);
+}
+
+bool UdpTransport::open(unsigned short const localPort, char const *const host, unsigned short const port) {
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo *res = 0;
+	if (getaddrinfo(host, 0, &hints, &res) || !res) {
+		std::fprintf(stderr, "netplay: could not resolve %s\n", host);
+		return false;
+	}
+
+	peerAddr_ = reinterpret_cast<sockaddr_in const *>(res->ai_addr)->sin_addr.s_addr;
+	peerPort_ = htons(port);
+	freeaddrinfo(res);
+
+	fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd_ < 0) {
+		std::perror("netplay: socket");
+		return false;
+	}
+
+	sockaddr_in local;
+	std::memset(&local, 0, sizeof local);
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(localPort);
+	if (bind(fd_, reinterpret_cast<sockaddr const *>(&local), sizeof local) < 0) {
+		std::perror("netplay: bind");
+		return false;
+	}
+
+	if (fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK) < 0) {
+		std::perror("netplay: fcntl");
+		return false;
+	}
+
+	return true;
+}
+
+void UdpTransport::send(void const *const data, std::size_t const size) {
+	sockaddr_in peer;
+	std::memset(&peer, 0, sizeof peer);
+	peer.sin_family = AF_INET;
+	peer.sin_addr.s_addr = peerAddr_;
+	peer.sin_port = peerPort_;
+	sendto(fd_, data, size, 0, reinterpret_cast<sockaddr const *>(&peer), sizeof peer);
+}
+
+std::size_t UdpTransport::receive(void *const data, std::size_t const size) {
+	for (;;) {
+		sockaddr_in from;
+		socklen_t fromlen = sizeof from;
+		ssize_t const n = recvfrom(fd_, data, size, 0, reinterpret_cast<sockaddr *>(&from), &fromlen);
+		if (n <= 0)
+			return 0;
+
+		if (from.sin_addr.s_addr == peerAddr_ && from.sin_port == peerPort_)
+			return n;
+	}
+}
+
+LoopbackTransport::LoopbackTransport(unsigned long const seed)
+: peer_(0)
+, now_(0)
+, rng_(seed)
+, minDelay_(0)
+, maxDelay_(0)
+, lossPercent_(0)
+{
+}
+
+void LoopbackTransport::connect(LoopbackTransport &a, LoopbackTransport &b) {
+	a.peer_ = &b;
+	b.peer_ = &a;
+}
+
+void LoopbackTransport::setConditions(unsigned const minDelay, unsigned const maxDelay,
+                                      unsigned const lossPercent) {
+	minDelay_ = minDelay;
+	maxDelay_ = maxDelay > minDelay ? maxDelay : minDelay;
+	lossPercent_ = lossPercent;
+}
+
+unsigned long LoopbackTransport::random() {
+	rng_ = (rng_ * 1103515245ul + 12345) & 0x7FFFFFFFul;
+	return rng_ >> 8;
+}
+
+void LoopbackTransport::send(void const *const data, std::size_t const size) {
+	if (!peer_ || random() % 100 < lossPercent_)
+		return;
+
+	Datagram d;
+	d.due = peer_->now_ + minDelay_ + random() % (maxDelay_ - minDelay_ + 1);
+	d.data.assign(static_cast<char const *>(data), static_cast<char const *>(data) + size);
+	peer_->inbox_.push_back(d);
+}
+
+std::size_t LoopbackTransport::receive(void *const data, std::size_t const size) {
+	for (std::deque<Datagram>::iterator it = inbox_.begin(); it != inbox_.end(); ++it) {
+		if (it->due <= now_) {
+			std::size_t const n = it->data.size() < size ? it->data.size() : size;
+			std::memcpy(data, &it->data[0], n);
+			inbox_.erase(it);
+			return n;
+		}
+	}
+
+	return 0;
+}
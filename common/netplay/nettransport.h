@@ -0,0 +1,75 @@
+#ifndef NETTRANSPORT_H
+#define NETTRANSPORT_H
+
+#include "uncopyable.h"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// How Netplay peers reach each other. Datagrams may be lost, duplicated or
+// come out of order, as with UDP, and Netplay copes with all of it by
+// sending every input until the other end has acknowledged it.
+class NetTransport {
+public:
+	virtual ~NetTransport() {}
+
+	virtual void send(void const *data, std::size_t size) = 0;
+
+	// Copies the next datagram waiting into data and returns its size, or 0
+	// if there is none. Never blocks.
+	virtual std::size_t receive(void *data, std::size_t size) = 0;
+};
+
+class UdpTransport : public NetTransport, Uncopyable {
+public:
+	UdpTransport();
+	virtual ~UdpTransport();
+
+	// Listens on localPort and sends to host:port, ignoring datagrams from
+	// anywhere else. Prints why and returns false if that fails.
+	bool open(unsigned short localPort, char const *host, unsigned short port);
+
+	virtual void send(void const *data, std::size_t size);
+	virtual std::size_t receive(void *data, std::size_t size);
+
+private:
+	int fd_;
+	unsigned long peerAddr_;
+	unsigned short peerPort_;
+};
+
+// Both ends in one process, for trying netplay without a network. A
+// datagram is delivered between minDelay and maxDelay ticks of the
+// receiving end's clock after it was sent, so they can overtake each other,
+// and lossPercent of them are dropped.
+class LoopbackTransport : public NetTransport {
+public:
+	explicit LoopbackTransport(unsigned long seed = 1);
+
+	static void connect(LoopbackTransport &a, LoopbackTransport &b);
+	void setConditions(unsigned minDelay, unsigned maxDelay, unsigned lossPercent);
+
+	// Moves this end's clock on by one tick, e.g. once per frame.
+	void advance() { ++now_; }
+
+	virtual void send(void const *data, std::size_t size);
+	virtual std::size_t receive(void *data, std::size_t size);
+
+private:
+	struct Datagram {
+		unsigned long due;
+		std::vector<char> data;
+	};
+
+	LoopbackTransport *peer_;
+	std::deque<Datagram> inbox_;
+	unsigned long now_;
+	unsigned long rng_;
+	unsigned minDelay_;
+	unsigned maxDelay_;
+	unsigned lossPercent_;
+
+	unsigned long random();
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "perfhud.h"
+#include <algorithm>
+
+PerfHud::PerfHud()
+: pos_(0)
+, visible_(false)
+{
+	for (int t = 0; t < num_timings; ++t)
+		pending_[t] = 0;
+
+	clear();
+}
+
+void PerfHud::clear() {
+	Frame const empty = { { 0 }, 0, 1, false };
+	std::fill(frames_, frames_ + num_frames, empty);
+	for (int t = 0; t < num_timings; ++t)
+		pending_[t].store(0, std::memory_order_relaxed);
+}
+
+void PerfHud::setVisible(bool const visible) {
+	if (visible && !this->visible())
+		clear();
+
+	visible_.store(visible, std::memory_order_relaxed);
+}
+
+void PerfHud::endFrame(float const fill, bool const skipped, int const speed) {
+	if (!visible())
+		return;
+
+	Frame &f = frames_[pos_];
+	for (int t = 0; t < num_timings; ++t) {
+		unsigned long const usecs = pending_[t].exchange(0, std::memory_order_relaxed);
+		f.time[t] = std::min<unsigned long>(usecs, 0xFFFF);
+	}
+
+	f.fill = static_cast<unsigned char>(std::min(std::max(fill, 0.0f), 1.0f) * 100 + 0.5f);
+	f.speed = std::min(std::max(speed, 1), 255);
+	f.skipped = skipped;
+	pos_ = (pos_ + 1) % num_frames;
+}
+
+usec_t PerfHud::mean(Timing const t) const {
+	usec_t sum = 0;
+	for (int n = 0; n < num_frames; ++n)
+		sum += frames_[n].time[t];
+
+	return (sum + num_frames / 2) / num_frames;
+}
+
+unsigned PerfHud::numSkipped() const {
+	unsigned count = 0;
+	for (int n = 0; n < num_frames; ++n)
+		count += frames_[n].skipped;
+
+	return count;
+}
@@ -0,0 +1,60 @@
+#ifndef PERFHUD_H
+#define PERFHUD_H
+
+#include "usec.h"
+#include <atomic>
+
+// What every one of the last num_frames frames cost, for the performance HUD.
+// While the HUD is hidden recording is a test of one flag, so the calls can
+// stay in release builds. Timings may come from the presentation thread too;
+// they count towards the frame that ends next.
+class PerfHud {
+public:
+	enum Timing { time_emulate, time_scale, time_present, time_audio, num_timings };
+	enum { num_frames = 120 };
+
+	PerfHud();
+
+	// Becoming visible starts the graphs over.
+	void setVisible(bool visible);
+	bool visible() const { return visible_.load(std::memory_order_relaxed); }
+
+	// Start of a timed stretch, 0 while hidden.
+	usec_t start() const { return visible() ? getusecs() : 0; }
+
+	void stop(Timing t, usec_t start) {
+		if (start)
+			pending_[t].fetch_add(getusecs() - start, std::memory_order_relaxed);
+	}
+
+	// fill is the audio buffer fill from 0 to 1, speed the fast forward
+	// multiplier, 1 at normal speed.
+	void endFrame(float fill, bool skipped, int speed);
+
+	// Frame n of the last num_frames, 0 being the oldest.
+	usec_t timing(Timing t, int n) const { return frame(n).time[t]; }
+	unsigned fill(int n) const { return frame(n).fill; }
+	bool skipped(int n) const { return frame(n).skipped; }
+	unsigned speed(int n) const { return frame(n).speed; }
+
+	usec_t mean(Timing t) const;
+	unsigned numSkipped() const;
+
+private:
+	struct Frame {
+		unsigned short time[num_timings];
+		unsigned char fill;
+		unsigned char speed;
+		bool skipped;
+	};
+
+	Frame frames_[num_frames];
+	unsigned pos_;
+	std::atomic<unsigned long> pending_[num_timings];
+	std::atomic<bool> visible_;
+
+	Frame const & frame(int n) const { return frames_[(pos_ + n) % num_frames]; }
+	void clear();
+};
+
+#endif
@@ -0,0 +1,108 @@
+// Resampler throughput benchmark.
+//
+// Feeds a few seconds of Game Boy rate (2097152 Hz) stereo audio through every
+// ResamplerInfo entry, one video frame (35112 samples) per resample call like
+// the frontend does, and prints input samples/sec. When SIMD filter kernels are
+// compiled in, each resampler is run once with and once without them and the
+// outputs are compared.
+//
+// usage: resamplerbench [outrate] [seconds]
+
+#include "resample/resampler.h"
+#include "resample/resamplerinfo.h"
+#include "array.h"
+#include "scoped_ptr.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+enum { in_rate = 2097152 };
+enum { period_size = 35112 };
+
+void fillInput(short *buf, std::size_t frames) {
+	// two squares that do not share a period, roughly what the PSG produces.
+	for (std::size_t i = 0; i < frames; ++i) {
+		buf[i * 2    ] = (i / 2383) & 1 ? 12000 : -12000;
+		buf[i * 2 + 1] = (i / 1597) & 1 ? 9000 : -9000;
+	}
+}
+
+struct Result {
+	double seconds;
+	std::size_t outSamples;
+};
+
+Result run(ResamplerInfo const &info, long outRate,
+           short const *in, std::size_t inFrames, short *out) {
+	scoped_ptr<Resampler> const r(info.create(in_rate, outRate, period_size));
+	Result res = { 0, 0 };
+	std::clock_t const start = std::clock();
+
+	for (std::size_t pos = 0; pos + period_size <= inFrames; pos += period_size) {
+		res.outSamples += r->resample(out + res.outSamples * ResamplerInfo::channels,
+		                              in + pos * ResamplerInfo::channels, period_size);
+	}
+
+	res.seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+	return res;
+}
+
+void print(char const *desc, char const *kernel, Result const &res, std::size_t inFrames) {
+	double const sps = res.seconds > 0 ? inFrames / res.seconds : 0;
+	std::printf("%-36s %-6s %8.3f s %12.0f smp/s %7.1fx realtime\n",
+	            desc, kernel, res.seconds, sps, sps / in_rate);
+}
+
+} // anon namespace
+
+int main(int argc, char *argv[]) {
+	long const outRate = argc > 1 ? std::atol(argv[1]) : 48000;
+	long const seconds = argc > 2 ? std::atol(argv[2]) : 10;
+	if (outRate <= 0 || seconds <= 0) {
+		std::fprintf(stderr, "usage: %s [outrate] [seconds]\n", argv[0]);
+		return 1;
+	}
+
+	std::size_t const inFrames = (std::size_t(in_rate) * seconds / period_size) * period_size;
+	std::size_t const outCapacity = (inFrames / period_size + 1)
+	                              * (std::size_t(period_size) * outRate / in_rate + 64);
+	Array<short> const in(inFrames * ResamplerInfo::channels);
+	Array<short> const outScalar(outCapacity * ResamplerInfo::channels);
+	Array<short> const outSimd(outCapacity * ResamplerInfo::channels);
+	fillInput(in, inFrames);
+
+	std::printf("%ld s of %d Hz stereo -> %ld Hz, SIMD kernels %s\n\n",
+	            seconds, int(in_rate), outRate,
+	            ResamplerInfo::simdAvailable() ? "available" : "not compiled in");
+
+	for (std::size_t n = 0; n < ResamplerInfo::num(); ++n) {
+		ResamplerInfo const &info = ResamplerInfo::get(n);
+
+		ResamplerInfo::setSimd(false);
+		Result const scalar = run(info, outRate, in, inFrames, outScalar);
+		print(info.desc, "scalar", scalar, inFrames);
+
+		if (ResamplerInfo::simdAvailable()) {
+			ResamplerInfo::setSimd(true);
+			Result const simd = run(info, outRate, in, inFrames, outSimd);
+			print(info.desc, "simd", simd, inFrames);
+
+			std::size_t mismatches = simd.outSamples == scalar.outSamples ? 0 : 1;
+			for (std::size_t i = 0; !mismatches
+					&& i < scalar.outSamples * ResamplerInfo::channels; ++i) {
+				mismatches += outScalar[i] != outSimd[i];
+			}
+
+			if (mismatches)
+				std::printf("%-36s output differs between kernels\n", "");
+			else if (simd.seconds > 0)
+				std::printf("%-36s speedup %.2fx\n", "", scalar.seconds / simd.seconds);
+		}
+	}
+
+	ResamplerInfo::setSimd(true);
+	return 0;
+}
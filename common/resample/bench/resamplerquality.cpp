@@ -0,0 +1,382 @@
+// Resampler cost and quality suite.
+//
+// Runs every resampler (including the Hamming and Blackman sinc variants that
+// are not exposed in ResamplerInfo) on synthetic Game Boy rate (2097152 Hz)
+// input and reports, for 44.1 and 48 kHz output:
+//
+//   cpu      CPU milliseconds spent per second of audio (PSG-like square input)
+//   heap     peak heap use of the resampler instance
+//   delay    group delay, from the 50% crossing of a step response
+//   gain     pass band gain at 1 kHz
+//   sine     SNR of a 1 kHz sine (everything that is not the sine is noise)
+//   square   SNR of a PSG square wave (everything that is not a harmonic
+//            below the output Nyquist frequency is noise, mostly aliases)
+//   alias    worst rejection of tones above Nyquist that alias below 20 kHz,
+//            relative to the pass band gain
+//   sweep    average rejection over a linear sweep from (outrate - 20 kHz)
+//            up to 1 MHz, all of which would alias into the audible band
+//
+// usage: resamplerquality [outrate...]
+
+#include "resample/resampler.h"
+#include "resample/resamplerinfo.h"
+#include "resample/src/blackmansinc.h"
+#include "resample/src/chainresampler.h"
+#include "resample/src/hammingsinc.h"
+#include "scoped_ptr.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <vector>
+
+// Heap accounting, so that we can tell what each resampler instance costs.
+namespace {
+
+std::size_t heapNow;
+std::size_t heapPeak;
+
+union HeapHeader {
+	std::size_t size;
+	double align_;
+};
+
+void * heapAlloc(std::size_t size) {
+	HeapHeader *const h = static_cast<HeapHeader *>(std::malloc(sizeof(HeapHeader) + size));
+	if (!h)
+		std::abort();
+
+	h->size = size;
+	heapNow += size;
+	if (heapNow > heapPeak)
+		heapPeak = heapNow;
+
+	return h + 1;
+}
+
+void heapFree(void *p) {
+	if (p) {
+		HeapHeader *const h = static_cast<HeapHeader *>(p) - 1;
+		heapNow -= h->size;
+		std::free(h);
+	}
+}
+
+} // anon namespace
+
+void * operator new(std::size_t size) { return heapAlloc(size); }
+void * operator new[](std::size_t size) { return heapAlloc(size); }
+void operator delete(void *p) throw() { heapFree(p); }
+void operator delete[](void *p) throw() { heapFree(p); }
+void operator delete(void *p, std::size_t) throw() { heapFree(p); }
+void operator delete[](void *p, std::size_t) throw() { heapFree(p); }
+
+namespace {
+
+enum { in_rate = 2097152 };
+enum { period_size = 35112 };
+enum { amplitude = 16000 };
+
+double const pi = 3.14159265358979323846;
+
+struct Candidate {
+	char const *desc;
+	Resampler * (*create)(long inRate, long outRate, std::size_t periodSize);
+};
+
+struct Signal {
+	std::vector<double> left;
+	double outRate;
+	double cpuSeconds;
+	std::size_t peakHeap;
+};
+
+// Mono test signals, duplicated to both channels when fed.
+void makeSine(std::vector<short> &in, double freq, double seconds) {
+	in.resize(std::size_t(in_rate * seconds));
+	for (std::size_t i = 0; i < in.size(); ++i)
+		in[i] = short(std::floor(amplitude * std::sin(2 * pi * freq * i / in_rate) + 0.5));
+}
+
+// Square as generated by PSG channel 1/2 at 50% duty, freq = 131072 / (2048 - x).
+void makeSquare(std::vector<short> &in, unsigned x, double seconds) {
+	std::size_t const period = 16 * (2048 - x);
+	in.resize(std::size_t(in_rate * seconds));
+	for (std::size_t i = 0; i < in.size(); ++i)
+		in[i] = i % period < period / 2 ? amplitude : -amplitude;
+}
+
+void makeSweep(std::vector<short> &in, double f0, double f1, double seconds) {
+	in.resize(std::size_t(in_rate * seconds));
+	for (std::size_t i = 0; i < in.size(); ++i) {
+		double const t = double(i) / in_rate;
+		double const phase = 2 * pi * (f0 * t + (f1 - f0) * t * t / (2 * seconds));
+		in[i] = short(std::floor(amplitude * std::sin(phase) + 0.5));
+	}
+}
+
+void makeStep(std::vector<short> &in, std::size_t stepPos, double seconds) {
+	in.resize(std::size_t(in_rate * seconds));
+	for (std::size_t i = 0; i < in.size(); ++i)
+		in[i] = i < stepPos ? 0 : amplitude;
+}
+
+Signal process(Candidate const &c, long outRate, std::vector<short> const &in) {
+	Signal sig;
+	std::size_t const heapBase = heapNow;
+	heapPeak = heapNow;
+	scoped_ptr<Resampler> const r(c.create(in_rate, outRate, period_size));
+	// resample() does not allocate, so this is all the instance will ever use.
+	sig.peakHeap = heapPeak - heapBase;
+
+	unsigned long mul, div;
+	r->exactRatio(mul, div);
+	sig.outRate = double(in_rate) * mul / div;
+
+	std::vector<short> inbuf(std::size_t(period_size) * ResamplerInfo::channels);
+	std::vector<short> outbuf(r->maxOut(period_size) * ResamplerInfo::channels);
+	sig.left.reserve(std::size_t(double(in.size()) * outRate / in_rate) + 1024);
+	sig.cpuSeconds = 0;
+
+	for (std::size_t pos = 0; pos + period_size <= in.size(); pos += period_size) {
+		for (std::size_t i = 0; i < std::size_t(period_size); ++i)
+			inbuf[i * 2] = inbuf[i * 2 + 1] = in[pos + i];
+
+		std::clock_t const start = std::clock();
+		std::size_t const n = r->resample(&outbuf[0], &inbuf[0], period_size);
+		sig.cpuSeconds += double(std::clock() - start) / CLOCKS_PER_SEC;
+
+		for (std::size_t i = 0; i < n; ++i)
+			sig.left.push_back(outbuf[i * 2]);
+	}
+
+	return sig;
+}
+
+// Least squares fit of dc + sum of sinusoids at freqs to sig.left[begin, end).
+// Returns the power of the residual and stores the amplitude of each sinusoid
+// in amps.
+double fit(Signal const &sig, std::vector<double> const &freqs,
+           std::size_t begin, std::size_t end, std::vector<double> &amps) {
+	std::size_t const dim = 1 + 2 * freqs.size();
+	std::vector<double> gram(dim * dim, 0), rhs(dim, 0), basis(dim);
+	for (std::size_t i = begin; i < end; ++i) {
+		basis[0] = 1;
+		for (std::size_t k = 0; k < freqs.size(); ++k) {
+			double const w = 2 * pi * freqs[k] / sig.outRate;
+			basis[1 + 2 * k] = std::cos(w * i);
+			basis[2 + 2 * k] = std::sin(w * i);
+		}
+
+		for (std::size_t r = 0; r < dim; ++r) {
+			rhs[r] += basis[r] * sig.left[i];
+			for (std::size_t c = r; c < dim; ++c)
+				gram[r * dim + c] += basis[r] * basis[c];
+		}
+	}
+
+	for (std::size_t r = 0; r < dim; ++r) {
+		for (std::size_t c = 0; c < r; ++c)
+			gram[r * dim + c] = gram[c * dim + r];
+	}
+
+	// gram is symmetric positive definite, plain Gaussian elimination is fine.
+	for (std::size_t p = 0; p < dim; ++p) {
+		for (std::size_t r = p + 1; r < dim; ++r) {
+			double const f = gram[r * dim + p] / gram[p * dim + p];
+			for (std::size_t c = p; c < dim; ++c)
+				gram[r * dim + c] -= f * gram[p * dim + c];
+
+			rhs[r] -= f * rhs[p];
+		}
+	}
+
+	std::vector<double> coef(dim);
+	for (std::size_t p = dim; p--;) {
+		double v = rhs[p];
+		for (std::size_t c = p + 1; c < dim; ++c)
+			v -= gram[p * dim + c] * coef[c];
+
+		coef[p] = v / gram[p * dim + p];
+	}
+
+	amps.resize(freqs.size());
+	for (std::size_t k = 0; k < freqs.size(); ++k)
+		amps[k] = std::sqrt(coef[1 + 2 * k] * coef[1 + 2 * k] + coef[2 + 2 * k] * coef[2 + 2 * k]);
+
+	double residual = 0;
+	for (std::size_t i = begin; i < end; ++i) {
+		double y = sig.left[i] - coef[0];
+		for (std::size_t k = 0; k < freqs.size(); ++k) {
+			double const w = 2 * pi * freqs[k] / sig.outRate;
+			y -= coef[1 + 2 * k] * std::cos(w * i) + coef[2 + 2 * k] * std::sin(w * i);
+		}
+
+		residual += y * y;
+	}
+
+	return residual / (end - begin);
+}
+
+double toneAmplitude(Signal const &sig, double freq, std::size_t begin, std::size_t end) {
+	std::vector<double> amps;
+	fit(sig, std::vector<double>(1, freq), begin, end, amps);
+	return amps[0];
+}
+
+double power(Signal const &sig, std::size_t begin, std::size_t end) {
+	double p = 0;
+	for (std::size_t i = begin; i < end; ++i)
+		p += sig.left[i] * sig.left[i];
+
+	return p / (end - begin);
+}
+
+double toDb(double ratio) { return ratio > 0 ? 10 * std::log10(ratio) : 999; }
+
+// skips the start-up transient of the filters.
+std::size_t settled(Signal const &sig) { return std::size_t(sig.outRate / 10); }
+
+// Returns the SNR of a 1 kHz sine and stores the amplitude gain in gain.
+double sineSnr(Candidate const &c, long outRate, double &gain) {
+	std::vector<short> in;
+	makeSine(in, 1000, 2);
+	Signal const sig = process(c, outRate, in);
+	std::vector<double> amps;
+	double const noise = fit(sig, std::vector<double>(1, 1000.0),
+	                         settled(sig), sig.left.size(), amps);
+	gain = amps[0] / amplitude;
+	return toDb(amps[0] * amps[0] / 2 / noise);
+}
+
+double squareSnr(Candidate const &c, long outRate, double &cpuMsPerSec, std::size_t &heap) {
+	unsigned const x = 2000;
+	double const f0 = 131072.0 / (2048 - x);
+	double const seconds = 4;
+	std::vector<short> in;
+	makeSquare(in, x, seconds);
+	Signal const sig = process(c, outRate, in);
+	cpuMsPerSec = sig.cpuSeconds * 1000 / seconds;
+	heap = sig.peakHeap;
+
+	std::vector<double> freqs;
+	for (double f = f0; f < sig.outRate / 2; f += 2 * f0)
+		freqs.push_back(f);
+
+	std::vector<double> amps;
+	double const noise = fit(sig, freqs, settled(sig), sig.left.size(), amps);
+	double harmonics = 0;
+	for (std::size_t k = 0; k < amps.size(); ++k)
+		harmonics += amps[k] * amps[k] / 2;
+
+	return toDb(harmonics / noise);
+}
+
+// Rejection is relative to the pass band gain.
+double aliasRejection(Candidate const &c, long outRate, double gain) {
+	static double const aliasFreqs[] = { 1000, 5000, 10000, 15000, 19000 };
+	double worst = 999;
+	for (std::size_t n = 0; n < sizeof aliasFreqs / sizeof *aliasFreqs; ++n) {
+		for (int image = 1; image <= 2; ++image) {
+			for (int sign = -1; sign <= 1; sign += 2) {
+				double const freq = image * double(outRate) + sign * aliasFreqs[n];
+				std::vector<short> in;
+				makeSine(in, freq, 0.5);
+				Signal const sig = process(c, outRate, in);
+				double const alias = std::fabs(freq - image * sig.outRate);
+				double const a = toneAmplitude(sig, alias, settled(sig), sig.left.size());
+				double const db = toDb(gain * gain * amplitude * amplitude / (a * a));
+				if (db < worst)
+					worst = db;
+			}
+		}
+	}
+
+	return worst;
+}
+
+double sweepRejection(Candidate const &c, long outRate, double gain) {
+	double const seconds = 4;
+	std::vector<short> in;
+	makeSweep(in, outRate - 20000.0, 1000000, seconds);
+	Signal const sig = process(c, outRate, in);
+	std::size_t const begin = settled(sig), end = sig.left.size() - settled(sig);
+	return toDb(gain * gain * amplitude * amplitude / 2 / power(sig, begin, end));
+}
+
+double groupDelayMs(Candidate const &c, long outRate) {
+	std::size_t const stepPos = in_rate / 4;
+	std::vector<short> in;
+	makeStep(in, stepPos, 0.5);
+	Signal const sig = process(c, outRate, in);
+	double const half = sig.left.back() / 2;
+	for (std::size_t i = 1; i < sig.left.size(); ++i) {
+		if (sig.left[i] >= half && sig.left[i - 1] < half) {
+			double const t = (i - 1 + (half - sig.left[i - 1]) / (sig.left[i] - sig.left[i - 1]))
+			               / sig.outRate;
+			return (t - double(stepPos) / in_rate) * 1000;
+		}
+	}
+
+	return -1;
+}
+
+} // anon namespace
+
+int main(int argc, char *argv[]) {
+	std::vector<long> outRates;
+	for (int i = 1; i < argc; ++i) {
+		long const rate = std::atol(argv[i]);
+		if (rate <= 0) {
+			std::fprintf(stderr, "usage: %s [outrate...]\n", argv[0]);
+			return 1;
+		}
+
+		outRates.push_back(rate);
+	}
+
+	if (outRates.empty()) {
+		outRates.push_back(44100);
+		outRates.push_back(48000);
+	}
+
+	std::vector<Candidate> candidates;
+	for (std::size_t n = 0; n < ResamplerInfo::num(); ++n) {
+		Candidate const c = { ResamplerInfo::get(n).desc, ResamplerInfo::get(n).create };
+		candidates.push_back(c);
+	}
+
+	{
+		Candidate const hamming = { "Hamming windowed sinc", ChainResampler::create<HammingSinc> };
+		Candidate const blackman = { "Blackman windowed sinc", ChainResampler::create<BlackmanSinc> };
+		candidates.push_back(hamming);
+		candidates.push_back(blackman);
+	}
+
+	for (std::size_t r = 0; r < outRates.size(); ++r) {
+		std::printf("%d Hz -> %ld Hz\n", int(in_rate), outRates[r]);
+		std::printf("%-36s %8s %8s %8s %8s %8s %8s %8s %8s\n", "resampler",
+		            "cpu", "heap", "delay", "gain", "sine", "square", "alias", "sweep");
+		std::printf("%-36s %8s %8s %8s %8s %8s %8s %8s %8s\n", "",
+		            "ms/s", "KiB", "ms", "dB", "dB", "dB", "dB", "dB");
+
+		for (std::size_t n = 0; n < candidates.size(); ++n) {
+			Candidate const &c = candidates[n];
+			double cpu, gain;
+			std::size_t heap;
+			double const square = squareSnr(c, outRates[r], cpu, heap);
+			double const sine = sineSnr(c, outRates[r], gain);
+			std::printf("%-36s %8.2f %8.1f %8.3f %8.1f %8.1f %8.1f %8.1f %8.1f\n", c.desc,
+			            cpu, heap / 1024.0, groupDelayMs(c, outRates[r]),
+			            20 * std::log10(gain), sine, square,
+			            aliasRejection(c, outRates[r], gain),
+			            sweepRejection(c, outRates[r], gain));
+			std::fflush(stdout);
+		}
+
+		std::printf("\n");
+	}
+
+	return 0;
+}
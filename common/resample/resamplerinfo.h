@@ -51,6 +51,18 @@ struct ResamplerInfo {
 	/** Returns ResamplerInfo number n. Where n is less than num(). */
 	static ResamplerInfo const & get(std::size_t n) { return resamplers_[n]; }
 
+	/** Returns true if SIMD filter kernels were compiled in for this target. */
+	static bool simdAvailable();
+
+	/** Returns true if the SIMD filter kernels are in use. */
+	static bool simd();
+
+	/**
+	  * Enables or disables the SIMD filter kernels. Has no effect if simdAvailable()
+	  * is false. Takes effect for all resamplers, including existing instances.
+	  */
+	static void setSimd(bool enable);
+
 private:
 	static ResamplerInfo const resamplers_[];
 	static std::size_t const num_;
@@ -0,0 +1,84 @@
+#ifndef FIRMAC_H
+#define FIRMAC_H
+
+#include <cstddef>
+
+// SIMD kernels are picked at build time from what the compiler targets.
+// Define RESAMPLE_NO_SIMD to force the plain C++ loops.
+#ifndef RESAMPLE_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FIRMAC_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FIRMAC_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(FIRMAC_SSE2) || defined(FIRMAC_NEON)
+#define FIRMAC_SIMD
+#endif
+
+// Runtime switch for the SIMD kernels. Defined in resamplerinfo.cpp and
+// controlled through ResamplerInfo::setSimd.
+extern bool firMacSimd;
+
+// Multiply-accumulates n kernel taps against n interleaved stereo frames.
+// k[j] is applied to s[2*j] (left) and s[2*j+1] (right).
+//
+// The SIMD paths accumulate in 32 bits, same as the C++ loop on the 32-bit
+// targets we ship on, so the result only differs from the 64-bit long
+// accumulation if the true sum would not fit an int anyway.
+inline void firMacStereo(short const *k, short const *s, std::size_t n,
+                         long &accl, long &accr)
+{
+#if defined(FIRMAC_SSE2)
+	if (firMacSimd && n >= 4) {
+		__m128i acc = _mm_setzero_si128();
+		do {
+			// k0 k1 k0 k1 k2 k3 k2 k3
+			__m128i kv = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(k));
+			kv = _mm_unpacklo_epi32(kv, kv);
+			// l0 r0 l1 r1 l2 r2 l3 r3 -> l0 l1 r0 r1 l2 l3 r2 r3
+			__m128i sv = _mm_loadu_si128(reinterpret_cast<__m128i const *>(s));
+			sv = _mm_shufflelo_epi16(sv, _MM_SHUFFLE(3, 1, 2, 0));
+			sv = _mm_shufflehi_epi16(sv, _MM_SHUFFLE(3, 1, 2, 0));
+			// l01 r01 l23 r23
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(kv, sv));
+			k += 4;
+			s += 8;
+		} while ((n -= 4) >= 4);
+
+		acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+		accl += _mm_cvtsi128_si32(acc);
+		accr += _mm_cvtsi128_si32(_mm_srli_si128(acc, 4));
+	}
+#elif defined(FIRMAC_NEON)
+	if (firMacSimd && n >= 4) {
+		int32x4_t al = vdupq_n_s32(0);
+		int32x4_t ar = vdupq_n_s32(0);
+		do {
+			int16x4_t const kv = vld1_s16(k);
+			int16x4x2_t const sv = vld2_s16(s);
+			al = vmlal_s16(al, kv, sv.val[0]);
+			ar = vmlal_s16(ar, kv, sv.val[1]);
+			k += 4;
+			s += 8;
+		} while ((n -= 4) >= 4);
+
+		int32x2_t const lr = vpadd_s32(vadd_s32(vget_low_s32(al), vget_high_s32(al)),
+		                               vadd_s32(vget_low_s32(ar), vget_high_s32(ar)));
+		accl += vget_lane_s32(lr, 0);
+		accr += vget_lane_s32(lr, 1);
+	}
+#endif
+
+	for (; n; --n) {
+		accl += *k * s[0];
+		accr += *k * s[1];
+		++k;
+		s += 2;
+	}
+}
+
+#endif
@@ -20,6 +20,7 @@
 #define POLYPHASEFIR_H
 
 #include "array.h"
+#include "firmac.h"
 #include "rshift16_round.h"
 #include <algorithm>
 #include <cstring>
@@ -125,12 +126,16 @@ std::size_t PolyphaseFir<channels, phases>::filter(short *out,
 			short const *k = kernel_ + ((x + 1) % phases) * phaseLen;
 			short const *const s = in + (x / phases + 1) * channels + c;
 			long accl = 0, accr = 0;
-			std::ptrdiff_t i = -static_cast<std::ptrdiff_t>(phaseLen * channels);
-			do {
-				accl += *k * s[i  ];
-				accr += *k * s[i+1];
-				++k;
-			} while (i += channels);
+			if (channels == 2) {
+				firMacStereo(k, s - phaseLen * 2, phaseLen, accl, accr);
+			} else {
+				std::ptrdiff_t i = -static_cast<std::ptrdiff_t>(phaseLen * channels);
+				do {
+					accl += *k * s[i  ];
+					accr += *k * s[i+1];
+					++k;
+				} while (i += channels);
+			}
 
 			out[0] = rshift16_round(accl);
 			out[1] = rshift16_round(accr);
@@ -18,6 +18,7 @@
  ***************************************************************************/
 #include "../resamplerinfo.h"
 #include "chainresampler.h"
+#include "firmac.h"
 #include "kaiser50sinc.h"
 #include "kaiser70sinc.h"
 // #include "hammingsinc.h"
@@ -40,3 +41,21 @@ ResamplerInfo const ResamplerInfo::resamplers_[] = {
 
 std::size_t const ResamplerInfo::num_ =
 	sizeof ResamplerInfo::resamplers_ / sizeof *ResamplerInfo::resamplers_;
+
+#ifdef FIRMAC_SIMD
+bool firMacSimd = true;
+#else
+bool firMacSimd = false;
+#endif
+
+bool ResamplerInfo::simdAvailable() {
+#ifdef FIRMAC_SIMD
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool ResamplerInfo::simd() { return firMacSimd; }
+
+void ResamplerInfo::setSimd(bool const enable) { firMacSimd = enable && simdAvailable(); }
@@ -0,0 +1,110 @@
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include "array.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+// Lock-free ring buffer for exactly one producer thread and one consumer thread.
+// write() may only be called by the producer and read() only by the consumer.
+// Neither blocks; the caller checks avail()/used() first and decides what to do
+// when there is not enough room or data. reset() and fill() touch both
+// positions and must only be called while the consumer is not running.
+template<typename T>
+class SpscRingBuffer {
+public:
+	explicit SpscRingBuffer(std::size_t size = 0)
+	: endpos_(0), rpos_(0), wpos_(0)
+	{
+		reset(size);
+	}
+
+	void reset(std::size_t size);
+	void fill(T value);
+	void read(T *out, std::size_t num);
+	void write(T const *in, std::size_t num);
+
+	std::size_t avail() const {
+		std::size_t const r = rpos_.load(std::memory_order_acquire);
+		std::size_t const w = wpos_.load(std::memory_order_acquire);
+		return (w < r ? 0 : endpos_) + r - w - 1;
+	}
+
+	std::size_t used() const {
+		std::size_t const r = rpos_.load(std::memory_order_acquire);
+		std::size_t const w = wpos_.load(std::memory_order_acquire);
+		return (w < r ? endpos_ : 0) + w - r;
+	}
+
+	std::size_t size() const {
+		return endpos_ - 1;
+	}
+
+private:
+	enum { cache_line_size = 64 };
+
+	Array<T> buf_;
+	std::size_t endpos_;
+	// keep the two positions on separate cache lines so that the threads
+	// do not keep stealing the line from each other.
+	char pad0_[cache_line_size];
+	std::atomic<std::size_t> rpos_;
+	char pad1_[cache_line_size];
+	std::atomic<std::size_t> wpos_;
+	char pad2_[cache_line_size];
+};
+
+template<typename T>
+void SpscRingBuffer<T>::reset(std::size_t size) {
+	endpos_ = size + 1;
+	rpos_.store(0, std::memory_order_relaxed);
+	wpos_.store(0, std::memory_order_release);
+	buf_.reset(size ? endpos_ : 0);
+}
+
+template<typename T>
+void SpscRingBuffer<T>::fill(T value) {
+	std::fill(buf_.get(), buf_.get() + buf_.size(), value);
+	rpos_.store(0, std::memory_order_relaxed);
+	wpos_.store(endpos_ - 1, std::memory_order_release);
+}
+
+template<typename T>
+void SpscRingBuffer<T>::read(T *out, std::size_t num) {
+	std::size_t rpos = rpos_.load(std::memory_order_relaxed);
+	if (rpos + num > endpos_) {
+		std::size_t const n = endpos_ - rpos;
+		std::memcpy(out, buf_ + rpos, n * sizeof *out);
+		rpos = 0;
+		num -= n;
+		out += n;
+	}
+
+	std::memcpy(out, buf_ + rpos, num * sizeof *out);
+	if ((rpos += num) == endpos_)
+		rpos = 0;
+
+	rpos_.store(rpos, std::memory_order_release);
+}
+
+template<typename T>
+void SpscRingBuffer<T>::write(T const *in, std::size_t num) {
+	std::size_t wpos = wpos_.load(std::memory_order_relaxed);
+	if (wpos + num > endpos_) {
+		std::size_t const n = endpos_ - wpos;
+		std::memcpy(buf_ + wpos, in, n * sizeof *buf_);
+		wpos = 0;
+		num -= n;
+		in += n;
+	}
+
+	std::memcpy(buf_ + wpos, in, num * sizeof *buf_);
+	if ((wpos += num) == endpos_)
+		wpos = 0;
+
+	wpos_.store(wpos, std::memory_order_release);
+}
+
+#endif
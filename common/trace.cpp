@@ -0,0 +1,107 @@
+#include "trace.h"
+
+#ifdef ENABLE_TRACE
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+
+namespace {
+
+struct Event {
+	char const *name;
+	long long ns;
+	pthread_t thread;
+	char phase;
+};
+
+Event ring[trace::ring_size];
+std::atomic<unsigned long> next(0);
+char exitPath[1024];
+
+long long monotonicNs() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+// Chrome wants small thread ids; number the threads in order of appearance.
+int threadId(pthread_t *threads, int &numThreads, int maxThreads, pthread_t t) {
+	for (int i = 0; i < numThreads; ++i) {
+		if (pthread_equal(threads[i], t))
+			return i + 1;
+	}
+
+	if (numThreads == maxThreads)
+		return maxThreads;
+
+	threads[numThreads] = t;
+	return ++numThreads;
+}
+
+void dumpOnExit() {
+	trace::dump(exitPath);
+}
+
+}
+
+void trace::record(char const *const name, char const phase) {
+	Event &e = ring[next.fetch_add(1, std::memory_order_relaxed) % ring_size];
+	e.name = name;
+	e.ns = monotonicNs();
+	e.thread = pthread_self();
+	e.phase = phase;
+}
+
+bool trace::dump(char const *const path) {
+	unsigned long const end = next.load(std::memory_order_relaxed);
+	unsigned long const count = end < unsigned(ring_size) ? end : unsigned(ring_size);
+	std::FILE *const file = std::fopen(path, "w");
+	if (!file) {
+		std::fprintf(stderr, "Could not write trace to %s\n", path);
+		return false;
+	}
+
+	enum { max_threads = 16 };
+	pthread_t threads[max_threads];
+	int numThreads = 0;
+	long long t0 = 0;
+	for (unsigned long n = end - count; n != end; ++n) {
+		if (ring[n % ring_size].name && (!t0 || ring[n % ring_size].ns < t0))
+			t0 = ring[n % ring_size].ns;
+	}
+
+	char const *separator = "";
+	std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+	for (unsigned long n = end - count; n != end; ++n) {
+		Event const e = ring[n % ring_size];
+		// taken by a thread that has not filled it in yet.
+		if (!e.name)
+			continue;
+
+		long long const ns = e.ns - t0;
+		std::fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld.%03d,\"pid\":1,\"tid\":%d%s}",
+		             separator, e.name, e.phase, ns / 1000, int(ns % 1000),
+		             threadId(threads, numThreads, max_threads, e.thread),
+		             e.phase == 'i' ? ",\"s\":\"t\"" : "");
+		separator = ",";
+	}
+
+	std::fputs("\n]}\n", file);
+	bool const ok = !std::ferror(file);
+	std::fclose(file);
+	std::printf("trace: %lu events written to %s\n", count, path);
+	return ok;
+}
+
+void trace::dumpAtExit(char const *const path) {
+	bool const registered = exitPath[0];
+	std::strncpy(exitPath, path, sizeof exitPath - 1);
+	if (!registered)
+		std::atexit(dumpOnExit);
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline of frame phases for chrome://tracing and Perfetto. Built with
+// -DENABLE_TRACE (make TRACE=YES, scons trace=1), every TRACE_ macro records a
+// timestamped event into a fixed ring buffer that keeps the newest
+// trace::ring_size events, and trace::dump() writes them out as Chrome trace
+// JSON. Without ENABLE_TRACE the macros expand to nothing.
+//
+// Event names must be string literals, only the pointer is kept.
+
+#ifdef ENABLE_TRACE
+
+namespace trace {
+
+enum { ring_size = 1 << 15 };
+
+void record(char const *name, char phase);
+
+// Writes the events in the ring to path. Returns false if it could not be written.
+bool dump(char const *path);
+
+// Dumps to path when the program exits.
+void dumpAtExit(char const *path);
+
+class Scope {
+public:
+	explicit Scope(char const *name) : name_(name) { record(name_, 'B'); }
+	~Scope() { record(name_, 'E'); }
+
+private:
+	char const *const name_;
+
+	Scope(Scope const &);
+	Scope & operator=(Scope const &);
+};
+
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_BEGIN(name) trace::record(name, 'B')
+#define TRACE_END(name) trace::record(name, 'E')
+#define TRACE_INSTANT(name) trace::record(name, 'i')
+#define TRACE_SCOPE(name) trace::Scope const TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_DUMP(path) trace::dump(path)
+#define TRACE_DUMP_AT_EXIT(path) trace::dumpAtExit(path)
+
+#else
+
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_DUMP(path) ((void)0)
+#define TRACE_DUMP_AT_EXIT(path) ((void)0)
+
+#endif
+
+#endif
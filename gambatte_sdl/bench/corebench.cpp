@@ -0,0 +1,120 @@
+// Core emulation speed, headless, for comparing builds.
+//
+// Runs each ROM from power on with no buttons pressed, once to hash every
+// frame it produces and then a number of times timed, and prints the best
+// and the median time per frame. Only the core runs: no video conversion,
+// resampling or sleeping. The video hash lets two builds be checked to emulate
+// the same thing before their times are compared, e.g. the GDMA/HDMA block
+// copy in Memory::bulkDma against the byte loop on DMA heavy CGB games.
+//
+// usage: corebench [-f frames] [-r runs] rom...
+//
+//   -f  frames to run (3600)
+//   -r  timed runs per ROM (5)
+
+#include <gambatte.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+using gambatte::GB;
+using gambatte::uint_least32_t;
+
+enum { gb_width = 160, gb_height = 144 };
+enum { samples_per_frame = 35112, max_overproduction = 2064 };
+
+long long threadUsecs() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+/**
+  * Runs frames from power on, hashing each frame if hash is not null.
+  * Returns false if the ROM could not be loaded.
+  */
+bool run(char const *rom, unsigned long frames, unsigned long *hash, bool *cgb) {
+	GB gb;
+	if (gb.load(rom) != gambatte::LOADRES_OK)
+		return false;
+
+	std::vector<uint_least32_t> video(gb_width * gb_height);
+	std::vector<uint_least32_t> audio(samples_per_frame + max_overproduction);
+	for (unsigned long f = 0; f < frames;) {
+		std::size_t samples = samples_per_frame;
+		if (gb.runFor(&video[0], gb_width, &audio[0], samples) < 0)
+			continue;
+
+		++f;
+		if (hash) {
+			// FNV-1a
+			for (std::size_t i = 0; i < video.size(); ++i)
+				*hash = ((*hash ^ video[i]) * 16777619ul) & 0xFFFFFFFFul;
+		}
+	}
+
+	*cgb = gb.isCgb();
+	return true;
+}
+
+int benchRom(char const *rom, unsigned long frames, int runs) {
+	unsigned long hash = 2166136261ul;
+	bool cgb = false;
+	if (!run(rom, frames, &hash, &cgb)) {
+		std::fprintf(stderr, "%s: could not be loaded\n", rom);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<long long> usecs;
+	for (int i = 0; i < runs; ++i) {
+		long long const start = threadUsecs();
+		run(rom, frames, 0, &cgb);
+		usecs.push_back(threadUsecs() - start);
+	}
+
+	std::sort(usecs.begin(), usecs.end());
+	double const best = usecs.front() / 1000.0 / frames;
+	double const median = usecs[usecs.size() / 2] / 1000.0 / frames;
+	std::printf("%s: %s, %lu frames, videohash %08lx, %.4f ms/frame best (%.0f fps), %.4f median\n",
+	            rom, cgb ? "cgb" : "dmg", frames, hash, best, 1000 / best, median);
+	return EXIT_SUCCESS;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long frames = 3600;
+	int runs = 5;
+	std::vector<char const *> roms;
+
+	for (int i = 1; i < argc; ++i) {
+		if (argv[i][0] != '-') {
+			roms.push_back(argv[i]);
+			continue;
+		}
+
+		char const *const arg = i + 1 < argc && !argv[i][2] ? argv[++i] : 0;
+		switch (arg ? argv[i - 1][1] : 0) {
+		case 'f': frames = std::strtoul(arg, 0, 0); break;
+		case 'r': runs = std::atoi(arg); break;
+		default: roms.clear(); i = argc; break;
+		}
+	}
+
+	if (roms.empty() || frames == 0 || runs < 1) {
+		std::fputs("usage: corebench [-f frames] [-r runs] rom...\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	int status = EXIT_SUCCESS;
+	for (std::size_t i = 0; i < roms.size(); ++i) {
+		if (benchRom(roms[i], frames, runs) != EXIT_SUCCESS)
+			status = EXIT_FAILURE;
+	}
+
+	return status;
+}
@@ -0,0 +1,243 @@
+// Input to photon latency, in frames, for one ROM.
+//
+// Presses a button at a number of points spread over a frame, holds it, and
+// counts the frames until the picture first differs from a run without the
+// press. Latency is from the press to the end of that frame, the point where
+// the frontend gets to show it. This is done for the two ways the SDL
+// frontend feeds input to the core:
+//
+//   frame  the buttons are sampled once per frame, between runFor calls,
+//          which is what the event loop does by default
+//   late   the core latches the buttons when the game first reads P1 in a
+//          frame (GB::setLateInputLatch, --late-input)
+//
+// How much late latching saves depends on where in the frame the game reads
+// P1. A game that reads it in its vblank handler, right after the frame
+// ends, gains next to nothing; one that reads it half way down the screen
+// sees presses made since the frame started one frame sooner.
+//
+// usage: inputlatency [-b button] [-f frames] [-n presses] [-w frames] rom
+//
+//   -b  button to press: a, b, select, start, right, left, up or down (start)
+//   -f  frames to run before the first press, to get past the title (300)
+//   -n  number of presses spread over a frame (16)
+//   -w  frames to wait for a change before giving up (10)
+
+#include <gambatte.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using gambatte::GB;
+using gambatte::InputGetter;
+using gambatte::uint_least32_t;
+using gambatte::uint_least64_t;
+
+enum { gb_width = 160, gb_height = 144 };
+enum { samples_per_frame = 35112, max_overproduction = 2064 };
+
+class HeldInput : public InputGetter {
+public:
+	unsigned live;
+	unsigned sampled;
+	bool lateLatch;
+
+	HeldInput() : live(0), sampled(0), lateLatch(false) {}
+	virtual unsigned operator()() { return lateLatch ? live : sampled; }
+};
+
+struct Run {
+	GB gb;
+	HeldInput input;
+	std::vector<uint_least32_t> video;
+	std::vector<uint_least32_t> audio;
+	unsigned long pos;
+
+	Run()
+	: video(gb_width * gb_height)
+	, audio(samples_per_frame + max_overproduction)
+	, pos(0)
+	{
+		gb.setInputGetter(&input);
+	}
+
+	/**
+	  * Runs to at least until samples into the run, or to the end of a frame
+	  * if that comes first. Returns where the frame ended, or 0 if none did.
+	  */
+	unsigned long step(unsigned long until) {
+		std::size_t samples = until > pos ? until - pos : 1;
+		if (samples > samples_per_frame)
+			samples = samples_per_frame;
+
+		std::ptrdiff_t const blit = gb.runFor(&video[0], gb_width, &audio[0], samples);
+		unsigned long const frameEnd = blit >= 0 ? pos + blit : 0;
+		pos += samples;
+		if (blit >= 0)
+			input.sampled = input.live;
+
+		return frameEnd;
+	}
+
+	unsigned long frameHash() const {
+		uint_least64_t hashes[gb_height];
+		gb.lineHashes(hashes);
+		unsigned long h = 2166136261ul;
+		for (int i = 0; i < gb_height; ++i)
+			h = ((h ^ static_cast<unsigned long>(hashes[i] & 0xFFFFFFFFul)) * 16777619ul) & 0xFFFFFFFFul;
+
+		return h;
+	}
+};
+
+struct Frame {
+	unsigned long end;
+	unsigned long hash;
+};
+
+struct Stats {
+	double min, max, sum;
+	unsigned long count, missed;
+
+	Stats() : min(1e9), max(0), sum(0), count(0), missed(0) {}
+
+	void add(double frames) {
+		min = frames < min ? frames : min;
+		max = frames > max ? frames : max;
+		sum += frames;
+		++count;
+	}
+};
+
+int button(char const *name) {
+	static char const *const names[] = { "a", "b", "select", "start", "right", "left", "up", "down" };
+	for (int i = 0; i < 8; ++i) {
+		if (!std::strcmp(name, names[i]))
+			return 1 << i;
+	}
+
+	return 0;
+}
+
+void usage() {
+	std::fputs("usage: inputlatency [-b button] [-f frames] [-n presses] [-w frames] rom\n", stderr);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	unsigned pressed = InputGetter::START;
+	long skipFrames = 300;
+	long presses = 16;
+	long waitFrames = 10;
+	char const *rom = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc) {
+			char const *const arg = argv[++i];
+			switch (argv[i - 1][1]) {
+			case 'b': pressed = button(arg); break;
+			case 'f': skipFrames = std::atol(arg); break;
+			case 'n': presses = std::atol(arg); break;
+			case 'w': waitFrames = std::atol(arg); break;
+			default: pressed = 0; break;
+			}
+		} else if (!rom) {
+			rom = argv[i];
+		} else
+			rom = 0;
+	}
+
+	if (!rom || !pressed || skipFrames < 0 || presses < 1 || waitFrames < 1) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	std::string const statePath = std::string(P_tmpdir) + "/inputlatency.gqs";
+	std::vector<Frame> baseline;
+
+	{
+		Run run;
+		if (run.gb.load(rom)) {
+			std::fprintf(stderr, "failed to load ROM %s\n", rom);
+			return EXIT_FAILURE;
+		}
+
+		for (long n = 0; n < skipFrames;) {
+			if (run.step(run.pos + samples_per_frame))
+				++n;
+		}
+
+		if (!run.gb.saveState(&run.video[0], gb_width, statePath)) {
+			std::fprintf(stderr, "failed to write %s\n", statePath.c_str());
+			return EXIT_FAILURE;
+		}
+
+		// the first press is at the end of a frame, the last one just before the next.
+		run.pos = 0;
+		while (baseline.size() < std::size_t(waitFrames) + 1) {
+			if (unsigned long const end = run.step(run.pos + samples_per_frame)) {
+				Frame const f = { end, run.frameHash() };
+				baseline.push_back(f);
+			}
+		}
+	}
+
+	std::printf("%s: %ld presses over a frame, %ld frames in\n", rom, presses, skipFrames);
+
+	for (int late = 0; late < 2; ++late) {
+		Run run;
+		run.gb.load(rom);
+		run.gb.setLateInputLatch(late);
+		run.input.lateLatch = late;
+
+		Stats stats;
+		for (long n = 0; n < presses; ++n) {
+			run.gb.loadState(statePath);
+			run.input.live = run.input.sampled = 0;
+			run.pos = 0;
+
+			std::size_t frame = 0;
+			unsigned long const at = baseline[0].end * n / presses;
+			while (run.pos < at) {
+				if (run.step(at))
+					++frame;
+			}
+
+			unsigned long const pressPos = run.pos;
+			run.input.live = pressed;
+
+			bool seen = false;
+			while (frame < baseline.size() && !seen) {
+				if (unsigned long const end = run.step(run.pos + samples_per_frame)) {
+					if (run.frameHash() != baseline[frame].hash) {
+						stats.add(double(end - pressPos) / samples_per_frame);
+						seen = true;
+					}
+
+					++frame;
+				}
+			}
+
+			if (!seen)
+				++stats.missed;
+		}
+
+		std::printf("%-6s", late ? "late" : "frame");
+		if (stats.count) {
+			std::printf(" min %.2f avg %.2f max %.2f frames",
+			            stats.min, stats.sum / stats.count, stats.max);
+		}
+		if (stats.missed)
+			std::printf(" (%lu presses changed nothing within %ld frames)", stats.missed, waitFrames);
+
+		std::putchar('\n');
+	}
+
+	std::remove(statePath.c_str());
+	return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef LEGACYSCALERS_H
+#define LEGACYSCALERS_H
+
+#include "../scaler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void scale15x_fast(uint32_t* dst, uint32_t* src);
+void scale15x_pseudobilinear(uint32_t* dst, uint32_t* src, int dstwidth);
+void scale166x_fast(uint32_t* dst, uint32_t* src);
+void scale166x_pseudobilinear(uint32_t* dst, uint32_t* src);
+void fullscreen_upscale_pseudobilinear(uint32_t* dst, uint32_t* src);
+
+void scale15x_2(uint32_t* dst, uint32_t* src);
+void scale166x_2(uint32_t* dst, uint32_t* src);
+void fullscreen_2(uint32_t* dst, uint32_t* src);
+
+void scale15x_dotmatrix2(uint32_t* dst, uint32_t* src, const uint32_t gridcolor);
+void scale166x_dotmatrix2(uint32_t* dst, uint32_t* src, const uint32_t gridcolor);
+void fullscreen_dotmatrix2(uint32_t* dst, uint32_t* src, const uint32_t gridcolor);
+
+void scale15x_crt2(uint32_t* dst, uint32_t* src);
+void scale166x_crt2(uint32_t* dst, uint32_t* src);
+void fullscreen_crt2(uint32_t* dst, uint32_t* src);
+
+void scale15x_dotmatrix3(uint32_t* dst, uint32_t* src, const uint32_t gridcolor);
+void scale166x_dotmatrix3(uint32_t* dst, uint32_t* src, const uint32_t gridcolor);
+void fullscreen_dotmatrix3(uint32_t* dst, uint32_t* src, const uint32_t gridcolor);
+
+void scale15x_crt3(uint32_t* dst, uint32_t* src);
+void scale166x_crt3(uint32_t* dst, uint32_t* src);
+void fullscreen_crt3(uint32_t* dst, uint32_t* src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
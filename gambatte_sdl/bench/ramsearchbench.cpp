@@ -0,0 +1,184 @@
+// RAM search pass cost, and a check of the SIMD comparisons against the
+// plain C++ ones.
+//
+// Runs a ROM for a while so that RAM holds what a game keeps there. Then two
+// RamSearch objects, one filtering with SSE2 or NEON (whichever this was
+// built for) and one with the plain loop, take a snapshot, the game runs a
+// frame, and both filter; this is done a number of times for each filter
+// and the two must keep exactly the same candidates. Last, the time of a
+// pass is measured with every byte a candidate, the worst case.
+//
+// usage: ramsearchbench [-f frames] [-n passes] rom
+//
+//   -f  frames to run before taking the snapshot (600)
+//   -n  timed passes per filter (10000)
+
+#include "../ramsearch.h"
+#include <gambatte.h>
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+using gambatte::GB;
+using gambatte::uint_least32_t;
+
+enum { gb_width = 160, gb_height = 144 };
+enum { samples_per_frame = 35112, max_overproduction = 2064 };
+enum { check_frames = 60 };
+
+char const *const filterNames[] = { "equal", "changed", "increased", "decreased", "value" };
+
+long long threadNsecs() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+class Runner {
+public:
+	Runner()
+	: video_(gb_width * gb_height)
+	, audio_(samples_per_frame + max_overproduction)
+	{
+	}
+
+	bool load(char const *rom) { return gb.load(rom) == gambatte::LOADRES_OK; }
+
+	void runFrames(unsigned long frames) {
+		for (unsigned long f = 0; f < frames;) {
+			std::size_t samples = samples_per_frame;
+			if (gb.runFor(&video_[0], gb_width, &audio_[0], samples) >= 0)
+				++f;
+		}
+	}
+
+	GB gb;
+
+private:
+	std::vector<uint_least32_t> video_;
+	std::vector<uint_least32_t> audio_;
+};
+
+bool sameCandidates(RamSearch const &a, RamSearch const &b) {
+	std::size_t const n = a.count();
+	if (b.count() != n)
+		return false;
+
+	std::vector<RamSearch::Match> ma(n + 1), mb(n + 1);
+	if (a.matches(&ma[0], n) != n || b.matches(&mb[0], n) != n)
+		return false;
+
+	for (std::size_t i = 0; i < n; ++i) {
+		if (ma[i].area != mb[i].area || ma[i].address != mb[i].address
+				|| ma[i].bank != mb[i].bank || ma[i].value != mb[i].value) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+  * Filters both with f from a fresh snapshot, one frame later, check_frames
+  * times over. Returns false on a mismatch.
+  */
+bool check(Runner &r, RamSearch::Filter f) {
+	RamSearch simd(true), scalar(false);
+	std::size_t length = 0;
+	unsigned char const *const wram = r.gb.memoryArea(GB::WRAM, length);
+	unsigned long kept = 0;
+	for (int i = 0; i < check_frames; ++i) {
+		simd.reset(r.gb);
+		scalar.reset(r.gb);
+		unsigned const value = wram[i * 97 % length];
+		r.runFrames(1);
+		simd.filter(r.gb, f, value);
+		scalar.filter(r.gb, f, value);
+		if (!sameCandidates(simd, scalar)) {
+			std::printf("%-9s mismatch on pass %d: %lu simd, %lu scalar candidates\n",
+			            filterNames[f], i + 1, (unsigned long)simd.count(),
+			            (unsigned long)scalar.count());
+			return false;
+		}
+
+		kept += simd.count();
+	}
+
+	std::printf("%-9s same over %d passes, %lu candidates kept on average\n",
+	            filterNames[f], check_frames, kept / check_frames);
+	return true;
+}
+
+/** Average ns per pass with every byte a candidate. */
+double timePass(GB &gb, bool useSimd, RamSearch::Filter f, unsigned long passes) {
+	RamSearch search(useSimd);
+	long long total = 0;
+	for (unsigned long i = 0; i < passes; ++i) {
+		search.reset(gb);
+		long long const start = threadNsecs();
+		search.filter(gb, f, 0);
+		total += threadNsecs() - start;
+	}
+
+	return double(total) / passes;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	unsigned long frames = 600;
+	unsigned long passes = 10000;
+	char const *rom = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (argv[i][0] != '-') {
+			rom = argv[i];
+			continue;
+		}
+
+		char const *const arg = i + 1 < argc && !argv[i][2] ? argv[++i] : 0;
+		switch (arg ? argv[i - 1][1] : 0) {
+		case 'f': frames = std::strtoul(arg, 0, 0); break;
+		case 'n': passes = std::strtoul(arg, 0, 0); break;
+		default: rom = 0; i = argc; break;
+		}
+	}
+
+	if (!rom || passes == 0) {
+		std::fputs("usage: ramsearchbench [-f frames] [-n passes] rom\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	Runner r;
+	if (!r.load(rom)) {
+		std::fprintf(stderr, "%s: could not be loaded\n", rom);
+		return EXIT_FAILURE;
+	}
+
+	r.runFrames(frames);
+
+	std::size_t wram = 0, hram = 0, sram = 0;
+	r.gb.memoryArea(GB::WRAM, wram);
+	r.gb.memoryArea(GB::HRAM, hram);
+	r.gb.memoryArea(GB::SRAM, sram);
+	std::printf("%s: %s, %lu bytes WRAM, %lu HRAM, %lu SRAM, built with%s SIMD\n",
+	            rom, r.gb.isCgb() ? "cgb" : "dmg", (unsigned long)wram, (unsigned long)hram,
+	            (unsigned long)sram, RamSearch::simd() ? "" : "out");
+
+	bool same = true;
+	for (int f = RamSearch::filter_equal; f <= RamSearch::filter_value; ++f)
+		same &= check(r, RamSearch::Filter(f));
+
+	std::printf("ns per pass, every byte a candidate:\n");
+	for (int f = RamSearch::filter_equal; f <= RamSearch::filter_value; ++f) {
+		RamSearch::Filter const filter = RamSearch::Filter(f);
+		double const simd = timePass(r.gb, true, filter, passes);
+		double const scalar = timePass(r.gb, false, filter, passes);
+		std::printf("%-9s %8.0f simd %8.0f scalar\n", filterNames[f], simd, scalar);
+	}
+
+	return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,469 @@
+// Compatibility and performance crawl over a directory of ROMs.
+//
+// Boots every .gb, .gbc and .zip under a directory and runs it for a number
+// of emulated seconds with random buttons, several ROMs at a time, each in a
+// process of its own so that one crashing or locking up the emulator only
+// costs its own row. Writes a CSV, in path order, to diff against the crawl
+// of an earlier release:
+//
+//   rom            path under the directory
+//   title, cgb     from the cartridge header, and whether it runs in CGB mode
+//   status         ok; hang, the PC and RAM stayed the same for the hang time;
+//                  lcd_off, the LCD stayed off that long; load_error; crash,
+//                  the emulator died of a signal; timeout, it ran past -t
+//   fps            emulated frames per second of CPU time, in runFor alone
+//   slow_reads, slow_writes
+//                  most slow path memory accesses (GB::slowAccessStats) in
+//                  any one emulated second; left empty unless libgambatte
+//                  was built with the profiler (make PROFILE=YES romcrawl),
+//                  which also lowers fps
+//   stuck_s, lcd_off_s
+//                  longest stretches with the PC and RAM unchanged, and with
+//                  the LCD off, in emulated seconds
+//
+// The buttons follow from the ROM's path, so all but fps come out the same
+// from one crawl to the next unless the emulator changed.
+//
+// usage: romcrawl [-s seconds] [-j jobs] [-w seconds] [-t seconds] dir > crawl.csv
+//
+//   -s  emulated seconds to run each ROM for (60)
+//   -j  ROMs to run at a time (one per CPU)
+//   -w  emulated seconds stuck or with the LCD off that count as hung (10)
+//   -t  wall clock seconds before a ROM is killed (60 + the -s seconds)
+
+#include <gambatte.h>
+#include <algorithm>
+#include <cctype>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+using gambatte::GB;
+using gambatte::InputGetter;
+using gambatte::LoadRes;
+using gambatte::uint_least32_t;
+
+enum { gb_width = 160, gb_height = 144 };
+enum { samples_per_frame = 35112, max_overproduction = 2064 };
+enum { samples_per_second = 2097152 };
+// how often the PC and RAM are looked at for a hang.
+enum { stuck_checks_per_second = 4 };
+
+struct Options {
+	unsigned long seconds;
+	unsigned long hangSeconds;
+	unsigned long timeout;
+	unsigned jobs;
+};
+
+// Holds a random set of buttons for a random number of frames.
+class RandomInput : public InputGetter {
+public:
+	explicit RandomInput(unsigned long seed) : rng_(seed), held_(0), left_(0) {}
+
+	virtual unsigned operator()() { return held_; }
+
+	void nextFrame() {
+		if (left_) {
+			--left_;
+			return;
+		}
+
+		held_ = random() & 0xFF;
+		// start and select together resets some games.
+		if ((held_ & (START | SELECT)) == (START | SELECT))
+			held_ &= ~SELECT;
+
+		left_ = random() % 30;
+	}
+
+private:
+	unsigned long rng_;
+	unsigned held_;
+	unsigned left_;
+
+	unsigned random() {
+		rng_ = (rng_ * 1103515245ul + 12345) & 0x7FFFFFFFul;
+		return rng_ >> 16;
+	}
+};
+
+unsigned long fnv(unsigned long h, unsigned char const *p, std::size_t n) {
+	while (n--)
+		h = ((h ^ *p++) * 16777619ul) & 0xFFFFFFFFul;
+
+	return h;
+}
+
+unsigned long ramHash(GB &gb) {
+	static GB::MemoryArea const areas[] = { GB::WRAM, GB::HRAM };
+	unsigned long h = 2166136261ul;
+	for (std::size_t a = 0; a < sizeof areas / sizeof *areas; ++a) {
+		std::size_t size = 0;
+		unsigned char const *const p = gb.memoryArea(areas[a], size);
+		h = fnv(h, p, size);
+	}
+
+	return h;
+}
+
+long long threadCpuUsecs() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+long long monotonicUsecs() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+std::string csvField(std::string const &s) {
+	std::string out = "\"";
+	for (std::size_t i = 0; i < s.size(); ++i) {
+		unsigned char const c = s[i];
+		if (c == '"')
+			out += "\"\"";
+		else
+			out += std::isprint(c) ? char(c) : '?';
+	}
+
+	return out + '"';
+}
+
+void writeAll(int fd, std::string const &s) {
+	for (std::size_t done = 0; done < s.size();) {
+		ssize_t const n = write(fd, s.data() + done, s.size() - done);
+		if (n <= 0)
+			return;
+
+		done += n;
+	}
+}
+
+/**
+  * Runs one ROM and writes its columns after the path to fd: the header
+  * ones as soon as it is loaded, so that they are there even if the run
+  * crashes, and the rest at the end, ending the row with a newline.
+  */
+void crawl(std::string const &path, unsigned long seed, Options const &opt, int fd) {
+	char buf[256];
+	GB gb;
+	RandomInput input(seed);
+	gb.setInputGetter(&input);
+	if (LoadRes const res = gb.load(path)) {
+		std::snprintf(buf, sizeof buf, ",,,load_error (%s),,,,,\n", to_string(res).c_str());
+		writeAll(fd, buf);
+		return;
+	}
+
+	writeAll(fd, "," + csvField(gb.romTitle()) + (gb.isCgb() ? ",1" : ",0"));
+
+	std::vector<uint_least32_t> video(gb_width * gb_height);
+	std::vector<uint_least32_t> audio(samples_per_frame + max_overproduction);
+	unsigned long long const end = (unsigned long long)opt.seconds * samples_per_second;
+	unsigned long long const hang = (unsigned long long)opt.hangSeconds * samples_per_second;
+	unsigned long long pos = 0;
+	long long usecs = 0;
+
+	unsigned long long nextSecond = samples_per_second;
+	unsigned long lastReads = 0, lastWrites = 0, peakReads = 0, peakWrites = 0;
+	bool const slowCounted = gb.slowAccessStats(lastReads, lastWrites);
+
+	unsigned long long nextStuckCheck = 0, stuckSince = 0, longestStuck = 0;
+	unsigned lastPc = ~0u;
+	unsigned long lastRam = 0;
+
+	unsigned long long lcdOffSince = 0, longestLcdOff = 0;
+	bool lcdOn = true;
+
+	while (pos < end) {
+		std::size_t samples = samples_per_frame;
+		long long const start = threadCpuUsecs();
+		std::ptrdiff_t const blit = gb.runFor(&video[0], gb_width, &audio[0], samples);
+		usecs += threadCpuUsecs() - start;
+		pos += samples;
+		if (blit >= 0)
+			input.nextFrame();
+
+		if (pos >= nextSecond) {
+			unsigned long reads = 0, writes = 0;
+			gb.slowAccessStats(reads, writes);
+			peakReads = std::max(peakReads, reads - lastReads);
+			peakWrites = std::max(peakWrites, writes - lastWrites);
+			lastReads = reads;
+			lastWrites = writes;
+			nextSecond += samples_per_second;
+		}
+
+		if (pos >= nextStuckCheck) {
+			unsigned const pc = gb.pc();
+			unsigned long const ram = ramHash(gb);
+			if (pc != lastPc || ram != lastRam)
+				stuckSince = pos;
+
+			longestStuck = std::max(longestStuck, pos - stuckSince);
+			lastPc = pc;
+			lastRam = ram;
+			nextStuckCheck += samples_per_second / stuck_checks_per_second;
+		}
+
+		if (gb.lcdEnabled() != lcdOn) {
+			lcdOn = !lcdOn;
+			lcdOffSince = pos;
+		}
+
+		if (!lcdOn)
+			longestLcdOff = std::max(longestLcdOff, pos - lcdOffSince);
+	}
+
+	char const *const status = longestStuck >= hang ? "hang"
+	                         : longestLcdOff >= hang ? "lcd_off"
+	                         : "ok";
+	double const frames = double(pos) / samples_per_frame;
+	std::snprintf(buf, sizeof buf, ",%s,%.0f", status, usecs ? frames * 1000000 / usecs : 0.0);
+	writeAll(fd, buf);
+	if (slowCounted)
+		std::snprintf(buf, sizeof buf, ",%lu,%lu", peakReads, peakWrites);
+	else
+		std::snprintf(buf, sizeof buf, ",,");
+
+	writeAll(fd, buf);
+	std::snprintf(buf, sizeof buf, ",%.2f,%.2f\n", double(longestStuck) / samples_per_second,
+	              double(longestLcdOff) / samples_per_second);
+	writeAll(fd, buf);
+}
+
+bool isRom(std::string const &name) {
+	std::size_t const dot = name.rfind('.');
+	if (dot == std::string::npos)
+		return false;
+
+	std::string ext = name.substr(dot + 1);
+	for (std::size_t i = 0; i < ext.size(); ++i)
+		ext[i] = std::tolower(static_cast<unsigned char>(ext[i]));
+
+	return ext == "gb" || ext == "gbc" || ext == "zip";
+}
+
+void findRoms(std::string const &dir, std::string const &rel, std::vector<std::string> &roms) {
+	DIR *const d = opendir(dir.c_str());
+	if (!d) {
+		std::perror(dir.c_str());
+		return;
+	}
+
+	while (dirent const *const e = readdir(d)) {
+		std::string const name = e->d_name;
+		if (name == "." || name == "..")
+			continue;
+
+		struct stat st;
+		std::string const full = dir + '/' + name;
+		if (stat(full.c_str(), &st))
+			continue;
+
+		if (S_ISDIR(st.st_mode))
+			findRoms(full, rel + name + '/', roms);
+		else if (S_ISREG(st.st_mode) && isRom(name))
+			roms.push_back(rel + name);
+	}
+
+	closedir(d);
+}
+
+struct Job {
+	pid_t pid;
+	int fd;
+	std::size_t rom;
+	long long deadline;
+	bool killed;
+	std::string out;
+};
+
+std::string drain(int fd) {
+	std::string out;
+	char buf[512];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof buf)) > 0)
+		out.append(buf, n);
+
+	return out;
+}
+
+bool start(Job &job, std::string const &dir, std::string const &rom, Options const &opt) {
+	int fds[2];
+	if (pipe(fds)) {
+		std::perror("pipe");
+		return false;
+	}
+
+	std::fflush(0);
+	job.pid = fork();
+	if (job.pid < 0) {
+		std::perror("fork");
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+
+	if (job.pid == 0) {
+		close(fds[0]);
+		// the core prints what it makes of the cartridge.
+		int const null = open("/dev/null", O_WRONLY);
+		if (null >= 0)
+			dup2(null, STDOUT_FILENO);
+
+		unsigned char const *const p = reinterpret_cast<unsigned char const *>(rom.data());
+		crawl(dir + '/' + rom, fnv(2166136261ul, p, rom.size()) | 1, opt, fds[1]);
+		_exit(0);
+	}
+
+	close(fds[1]);
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	job.fd = fds[0];
+	job.deadline = monotonicUsecs() + opt.timeout * 1000000ll;
+	job.killed = false;
+	job.out.clear();
+	return true;
+}
+
+/** The row for a job whose process has exited with status. */
+std::string finish(Job &job, std::string const &rom, int const status) {
+	job.out += drain(job.fd);
+	close(job.fd);
+
+	std::string row = csvField(rom) + job.out;
+	if (!row.empty() && row[row.size() - 1] == '\n') {
+		row.erase(row.size() - 1);
+		return row;
+	}
+
+	// the run died part way, after the header columns or before.
+	if (job.out.empty())
+		row += ",,";
+
+	char buf[64];
+	if (job.killed)
+		std::snprintf(buf, sizeof buf, ",timeout,,,,,");
+	else if (WIFSIGNALED(status))
+		std::snprintf(buf, sizeof buf, ",crash (%s),,,,,", strsignal(WTERMSIG(status)));
+	else
+		std::snprintf(buf, sizeof buf, ",crash (exit %d),,,,,", WEXITSTATUS(status));
+
+	return row + buf;
+}
+
+void usage() {
+	std::fputs("usage: romcrawl [-s seconds] [-j jobs] [-w seconds] [-t seconds] dir > crawl.csv\n", stderr);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	Options opt;
+	opt.seconds = 60;
+	opt.hangSeconds = 10;
+	opt.timeout = 0;
+	long const cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	opt.jobs = cpus > 0 ? cpus : 1;
+	char const *dir = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc) {
+			char const *const arg = argv[++i];
+			switch (argv[i - 1][1]) {
+			case 'j': opt.jobs = std::strtoul(arg, 0, 0); break;
+			case 's': opt.seconds = std::strtoul(arg, 0, 0); break;
+			case 't': opt.timeout = std::strtoul(arg, 0, 0); break;
+			case 'w': opt.hangSeconds = std::strtoul(arg, 0, 0); break;
+			default: opt.jobs = 0; break;
+			}
+		} else if (!dir) {
+			dir = argv[i];
+		} else
+			dir = 0;
+	}
+
+	if (!dir || !opt.jobs || !opt.seconds || !opt.hangSeconds) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	if (!opt.timeout)
+		opt.timeout = 60 + opt.seconds;
+
+	unsigned long reads = 0, writes = 0;
+	if (!GB().slowAccessStats(reads, writes))
+		std::fputs("romcrawl: built without the profiler, slow_reads and slow_writes stay empty\n", stderr);
+
+	std::vector<std::string> roms;
+	findRoms(dir, "", roms);
+	std::sort(roms.begin(), roms.end());
+	if (roms.empty()) {
+		std::fprintf(stderr, "no ROMs under %s\n", dir);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::string> rows(roms.size());
+	std::vector<Job> running;
+	std::size_t next = 0, done = 0;
+	while (done < roms.size()) {
+		while (running.size() < opt.jobs && next < roms.size()) {
+			Job job;
+			job.rom = next++;
+			if (start(job, dir, roms[job.rom], opt)) {
+				running.push_back(job);
+			} else {
+				rows[job.rom] = csvField(roms[job.rom]) + ",,,crash (could not start),,,,,";
+				++done;
+			}
+		}
+
+		bool reaped = false;
+		for (std::size_t i = 0; i < running.size();) {
+			Job &job = running[i];
+			// empty the pipe as it goes, a full one would stop the run.
+			job.out += drain(job.fd);
+
+			int status = 0;
+			if (waitpid(job.pid, &status, WNOHANG) != job.pid) {
+				if (!job.killed && monotonicUsecs() > job.deadline) {
+					kill(job.pid, SIGKILL);
+					job.killed = true;
+				}
+
+				++i;
+				continue;
+			}
+
+			rows[job.rom] = finish(job, roms[job.rom], status);
+			++done;
+			std::fprintf(stderr, "[%lu/%lu] %s\n", (unsigned long)done, (unsigned long)roms.size(),
+			             rows[job.rom].c_str());
+			running.erase(running.begin() + i);
+			reaped = true;
+		}
+
+		if (!reaped)
+			usleep(10000);
+	}
+
+	std::puts("rom,title,cgb,status,fps,slow_reads,slow_writes,stuck_s,lcd_off_s");
+	for (std::size_t i = 0; i < rows.size(); ++i)
+		std::puts(rows[i].c_str());
+
+	return 0;
+}
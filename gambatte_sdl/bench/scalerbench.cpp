@@ -0,0 +1,444 @@
+// Scaler throughput benchmark.
+//
+// Runs every scaler in scaler.h and legacyscalers.h, including the border
+// scalers, and every ScalerEngine entry over a few synthetic 160x144 RGB565
+// frames and over any captured frames given on the command line. For each it
+// prints the output size, ns per frame, bytes read and written, and, where
+// the kernel lets us use perf_event_open, the last level cache miss rate.
+//
+// Bytes written are counted, not assumed: the output buffer is filled with
+// two different canaries and every pixel that changed in either run counts.
+// Bytes read are the source rectangle the scaler is defined over.
+//
+// usage: scalerbench [-n frames] [capture.bmp...]
+//
+// Captures can be any BMP SDL can load. Anything larger than 160x144 is
+// cropped and anything smaller is tiled. Divide ns/frame by 16742706 (one
+// Game Boy frame in ns) to get the share of the frame budget.
+
+#include "legacyscalers.h"
+#include "../scalerengine.h"
+#include "array.h"
+#include <SDL/SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+enum { gb_width = 160, gb_height = 144 };
+// large enough for the widest pitch (640) times the tallest output (480),
+// plus a margin that catches writes past the end.
+enum { dst_pixels = 640 * 480 + 4096 };
+enum { src_pixels = 214 * 160 + 1024 };
+enum { grid_color = 0x000000 };
+
+typedef void (*ScaleFn)(uint32_t *dst, uint32_t *src);
+
+void s15xPseudobilinear(uint32_t *dst, uint32_t *src) { scale15x_pseudobilinear(dst, src, 320); }
+void s15xDotmatrix2(uint32_t *dst, uint32_t *src) { scale15x_dotmatrix2(dst, src, grid_color); }
+void s166xDotmatrix2(uint32_t *dst, uint32_t *src) { scale166x_dotmatrix2(dst, src, grid_color); }
+void fsDotmatrix2(uint32_t *dst, uint32_t *src) { fullscreen_dotmatrix2(dst, src, grid_color); }
+void s15xDotmatrix3(uint32_t *dst, uint32_t *src) { scale15x_dotmatrix3(dst, src, grid_color); }
+void s166xDotmatrix3(uint32_t *dst, uint32_t *src) { scale166x_dotmatrix3(dst, src, grid_color); }
+void fsDotmatrix3(uint32_t *dst, uint32_t *src) { fullscreen_dotmatrix3(dst, src, grid_color); }
+
+struct Entry {
+	char const *name;
+	ScaleFn fn;
+	// source rectangle and pitch in pixels
+	unsigned srcWidth, srcHeight, srcPitch;
+	// output pitch in pixels, which the scalers hardcode
+	unsigned dstPitch;
+};
+
+Entry const entries[] = {
+	{ "scale15x",                          scale15x,                 160, 144, 160, 320 },
+	{ "scale15x_fast",                     scale15x_fast,            160, 144, 160, 320 },
+	{ "scale15x_pseudobilinear",           s15xPseudobilinear,       160, 144, 160, 320 },
+	{ "scale166x_fast",                    scale166x_fast,           160, 144, 160, 320 },
+	{ "scale166x_pseudobilinear",          scale166x_pseudobilinear, 160, 144, 160, 320 },
+	{ "fullscreen_upscale",                fullscreen_upscale,       160, 144, 160, 320 },
+	{ "fullscreen_upscale_pseudobilinear", fullscreen_upscale_pseudobilinear, 160, 144, 160, 320 },
+	{ "scale15x_2",                        scale15x_2,               160, 144, 160, 428 },
+	{ "scale166x_2",                       scale166x_2,              160, 144, 160, 384 },
+	{ "fullscreen_2",                      fullscreen_2,             160, 144, 160, 320 },
+	{ "scale15x_dotmatrix2",               s15xDotmatrix2,           160, 144, 160, 428 },
+	{ "scale166x_dotmatrix2",              s166xDotmatrix2,          160, 144, 160, 384 },
+	{ "fullscreen_dotmatrix2",             fsDotmatrix2,             160, 144, 160, 320 },
+	{ "scale15x_crt2",                     scale15x_crt2,            160, 144, 160, 428 },
+	{ "scale166x_crt2",                    scale166x_crt2,           160, 144, 160, 384 },
+	{ "fullscreen_crt2",                   fullscreen_crt2,          160, 144, 160, 320 },
+	{ "scale15x_dotmatrix3",               s15xDotmatrix3,           160, 144, 160, 640 },
+	{ "scale166x_dotmatrix3",              s166xDotmatrix3,          160, 144, 160, 576 },
+	{ "fullscreen_dotmatrix3",             fsDotmatrix3,             160, 144, 160, 480 },
+	{ "scale15x_crt3",                     scale15x_crt3,            160, 144, 160, 640 },
+	{ "scale166x_crt3",                    scale166x_crt3,           160, 144, 160, 576 },
+	{ "fullscreen_crt3",                   fullscreen_crt3,          160, 144, 160, 480 },
+	{ "scaleborder15x",                    scaleborder15x,           212, 160, 212, 320 },
+	{ "scaleborder166x",                   scaleborder166x,          192, 144, 192, 320 },
+	{ "scaleborder15x_2",                  scaleborder15x_2,         214, 160, 214, 428 },
+	{ "scaleborder166x_2",                 scaleborder166x_2,        192, 144, 192, 384 },
+	{ "scaleborder15x_crt2",               scaleborder15x_crt2,      214, 160, 214, 428 },
+	{ "scaleborder166x_crt2",              scaleborder166x_crt2,     192, 144, 192, 384 },
+	{ "scaleborder15x_3",                  scaleborder15x_3,         212, 160, 212, 640 },
+	{ "scaleborder166x_3",                 scaleborder166x_3,        192, 144, 192, 576 },
+	{ "scaleborder15x_crt3",               scaleborder15x_crt3,      212, 160, 212, 640 },
+	{ "scaleborder166x_crt3",              scaleborder166x_crt3,     192, 144, 192, 576 }
+};
+
+std::size_t const num_entries = sizeof entries / sizeof entries[0];
+
+struct Frame {
+	std::string name;
+	Array<uint16_t> pixels;
+
+	explicit Frame(std::string const &name) : name(name), pixels(gb_width * gb_height) {}
+};
+
+unsigned long lcg(unsigned long &state) {
+	state = state * 1103515245 + 12345;
+	return state >> 16;
+}
+
+// The four DMG shades in a background of 8x8 tiles with a few sprites'
+// worth of detail, which is what most frames look like.
+void fillTiles(uint16_t *px) {
+	static uint16_t const shades[] = { 0xffff, 0xad55, 0x52aa, 0x0000 };
+	unsigned long state = 1;
+	Array<unsigned char> tiles(32 * 8 * 8);
+	for (std::size_t i = 0; i < tiles.size(); ++i)
+		tiles[i] = lcg(state) % 7 < 5 ? 0 : lcg(state) % 4;
+
+	for (unsigned y = 0; y < gb_height; ++y) {
+		for (unsigned x = 0; x < gb_width; ++x) {
+			unsigned const tile = (y / 8 * 20 + x / 8) % 32;
+			px[y * gb_width + x] = shades[tiles[tile * 64 + y % 8 * 8 + x % 8]];
+		}
+	}
+}
+
+// A smooth CGB style gradient. No two neighbours are equal.
+void fillGradient(uint16_t *px) {
+	for (unsigned y = 0; y < gb_height; ++y) {
+		for (unsigned x = 0; x < gb_width; ++x) {
+			unsigned const r = x * 31 / (gb_width - 1);
+			unsigned const g = y * 63 / (gb_height - 1);
+			unsigned const b = (x + y) * 31 / (gb_width + gb_height - 2);
+			px[y * gb_width + x] = r << 11 | g << 5 | b;
+		}
+	}
+}
+
+// Worst case for scalers with shortcuts for equal pixels.
+void fillNoise(uint16_t *px) {
+	unsigned long state = 12345;
+	for (std::size_t i = 0; i < std::size_t(gb_width) * gb_height; ++i)
+		px[i] = lcg(state);
+}
+
+bool loadCapture(char const *path, Frame &frame) {
+	SDL_Surface *const loaded = SDL_LoadBMP(path);
+	if (!loaded) {
+		std::fprintf(stderr, "%s: %s\n", path, SDL_GetError());
+		return false;
+	}
+
+	SDL_PixelFormat fmt;
+	std::memset(&fmt, 0, sizeof fmt);
+	fmt.BitsPerPixel = 16;
+	fmt.BytesPerPixel = 2;
+	fmt.Rmask = 0xf800;
+	fmt.Gmask = 0x07e0;
+	fmt.Bmask = 0x001f;
+	fmt.Rshift = 11;
+	fmt.Gshift = 5;
+	fmt.Rloss = 3;
+	fmt.Gloss = 2;
+	fmt.Bloss = 3;
+	fmt.Aloss = 8;
+	SDL_Surface *const s = SDL_ConvertSurface(loaded, &fmt, SDL_SWSURFACE);
+	SDL_FreeSurface(loaded);
+	if (!s) {
+		std::fprintf(stderr, "%s: %s\n", path, SDL_GetError());
+		return false;
+	}
+
+	SDL_LockSurface(s);
+	for (unsigned y = 0; y < gb_height; ++y) {
+		uint16_t const *const line = reinterpret_cast<uint16_t const *>(
+			static_cast<char const *>(s->pixels) + (y % s->h) * s->pitch);
+		for (unsigned x = 0; x < gb_width; ++x)
+			frame.pixels[y * gb_width + x] = line[x % s->w];
+	}
+
+	SDL_UnlockSurface(s);
+	SDL_FreeSurface(s);
+	return true;
+}
+
+// Lays the frame out in the source rectangle of an entry. Border scalers
+// get the frame tiled, since their input is bigger than a frame.
+void layoutSource(uint16_t *src, Entry const &e, uint16_t const *frame) {
+	for (unsigned y = 0; y < e.srcHeight; ++y) {
+		for (unsigned x = 0; x < e.srcPitch; ++x)
+			src[y * e.srcPitch + x] = frame[(y % gb_height) * gb_width + x % gb_width];
+	}
+}
+
+long long nsNow() {
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000000ll + t.tv_nsec;
+}
+
+// Last level cache references and misses for the calling thread. Counting
+// silently stays off when the kernel, the hardware or perf_event_paranoid
+// does not allow it.
+class CacheCounter {
+public:
+	CacheCounter() : refs_(-1), misses_(-1) {
+#ifdef __linux__
+		refs_ = open(PERF_COUNT_HW_CACHE_REFERENCES, -1);
+		if (refs_ >= 0)
+			misses_ = open(PERF_COUNT_HW_CACHE_MISSES, refs_);
+
+		if (misses_ < 0 && refs_ >= 0) {
+			close(refs_);
+			refs_ = -1;
+		}
+#endif
+	}
+
+	~CacheCounter() {
+#ifdef __linux__
+		if (misses_ >= 0)
+			close(misses_);
+		if (refs_ >= 0)
+			close(refs_);
+#endif
+	}
+
+	bool available() const { return misses_ >= 0; }
+
+	void start() {
+#ifdef __linux__
+		if (available()) {
+			ioctl(refs_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(refs_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+#endif
+	}
+
+	// Returns the miss rate since start(), or a negative value if unknown.
+	double stop() {
+#ifdef __linux__
+		if (available()) {
+			ioctl(refs_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+			unsigned long long refs = 0, misses = 0;
+			if (read(refs_, &refs, sizeof refs) == sizeof refs
+					&& read(misses_, &misses, sizeof misses) == sizeof misses
+					&& refs) {
+				return double(misses) / refs;
+			}
+		}
+#endif
+		return -1;
+	}
+
+private:
+	int refs_;
+	int misses_;
+
+#ifdef __linux__
+	static int open(unsigned long long config, int group) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof attr);
+		attr.size = sizeof attr;
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config;
+		attr.disabled = group < 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+	}
+#endif
+};
+
+struct Result {
+	unsigned outWidth, outHeight;
+	std::size_t bytesWritten;
+	bool overrun;
+	double nsPerFrame;
+	double missRate;
+};
+
+// Counts written pixels and their bounding box by running the scaler over
+// two canaries.
+void measureFootprint(Result &res, Array<uint16_t> &dst, unsigned dstPitch,
+                      void (*run)(void *ctx, uint16_t *dst, uint16_t *src), void *ctx,
+                      uint16_t *src)
+{
+	Array<unsigned char> written(dst.size());
+	std::memset(written, 0, written.size());
+	uint16_t const canaries[] = { 0x1234, 0xedcb };
+	for (std::size_t c = 0; c < sizeof canaries / sizeof canaries[0]; ++c) {
+		std::fill(dst.get(), dst.get() + dst.size(), canaries[c]);
+		run(ctx, dst, src);
+		for (std::size_t i = 0; i < dst.size(); ++i)
+			written[i] |= dst[i] != canaries[c];
+	}
+
+	unsigned minx = dstPitch, maxx = 0, miny = dst.size(), maxy = 0;
+	res.bytesWritten = 0;
+	res.overrun = false;
+	for (std::size_t i = 0; i < dst.size(); ++i) {
+		if (!written[i])
+			continue;
+
+		unsigned const x = i % dstPitch, y = i / dstPitch;
+		minx = std::min(minx, x);
+		maxx = std::max(maxx, x);
+		miny = std::min(miny, y);
+		maxy = std::max(maxy, y);
+		res.bytesWritten += sizeof dst[i];
+		res.overrun |= i >= std::size_t(640) * 480;
+	}
+
+	res.outWidth = res.bytesWritten ? maxx - minx + 1 : 0;
+	res.outHeight = res.bytesWritten ? maxy - miny + 1 : 0;
+}
+
+void timeRuns(Result &res, Array<uint16_t> &dst, unsigned iterations, CacheCounter &cache,
+              void (*run)(void *ctx, uint16_t *dst, uint16_t *src), void *ctx, uint16_t *src)
+{
+	run(ctx, dst, src);
+	cache.start();
+	long long const start = nsNow();
+	for (unsigned i = 0; i < iterations; ++i)
+		run(ctx, dst, src);
+
+	res.nsPerFrame = double(nsNow() - start) / iterations;
+	res.missRate = cache.stop();
+}
+
+void runLegacy(void *ctx, uint16_t *dst, uint16_t *src) {
+	static_cast<Entry const *>(ctx)->fn(reinterpret_cast<uint32_t *>(dst),
+	                                    reinterpret_cast<uint32_t *>(src));
+}
+
+struct EngineCtx {
+	ScalerEngine engine;
+	unsigned dstPitch;
+};
+
+void runEngine(void *ctx, uint16_t *dst, uint16_t *src) {
+	EngineCtx *const c = static_cast<EngineCtx *>(ctx);
+	c->engine.scale(dst, c->dstPitch, src, gb_width, 0x0000);
+}
+
+struct Row {
+	unsigned outPixels;
+	std::string line;
+};
+
+bool operator<(Row const &a, Row const &b) { return a.outPixels < b.outPixels; }
+
+Row makeRow(char const *kind, char const *name, std::size_t bytesRead, Result const &res) {
+	char size[24];
+	std::sprintf(size, "%ux%u", res.outWidth, res.outHeight);
+	char miss[16] = "-";
+	if (res.missRate >= 0)
+		std::sprintf(miss, "%.2f%%", res.missRate * 100);
+
+	char line[160];
+	std::snprintf(line, sizeof line, "%-9s %-6s %-34s %10.0f %8lu %8lu %8s%s\n",
+	              size, kind, name, res.nsPerFrame,
+	              static_cast<unsigned long>(bytesRead),
+	              static_cast<unsigned long>(res.bytesWritten),
+	              miss, res.overrun ? "  writes past 640x480" : "");
+	Row const row = { res.outWidth * res.outHeight, line };
+	return row;
+}
+
+} // anon namespace
+
+int main(int argc, char *argv[]) {
+	unsigned iterations = 300;
+	std::vector<Frame *> frames;
+	frames.push_back(new Frame("synthetic tiles"));
+	fillTiles(frames.back()->pixels);
+	frames.push_back(new Frame("synthetic gradient"));
+	fillGradient(frames.back()->pixels);
+	frames.push_back(new Frame("synthetic noise"));
+	fillNoise(frames.back()->pixels);
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+			iterations = std::max(1, std::atoi(argv[++i]));
+		} else if (argv[i][0] == '-') {
+			std::fprintf(stderr, "usage: %s [-n frames] [capture.bmp...]\n", argv[0]);
+			return 1;
+		} else {
+			Frame *const f = new Frame(argv[i]);
+			if (loadCapture(argv[i], *f))
+				frames.push_back(f);
+			else
+				delete f;
+		}
+	}
+
+	CacheCounter cache;
+	Array<uint16_t> dst(dst_pixels);
+	Array<uint16_t> src(src_pixels);
+	std::printf("%u frames per scaler, LLC miss rate %s, engine SIMD %s\n",
+	            iterations, cache.available() ? "from perf_event_open" : "not available",
+	            ScalerEngine::simd() ? "on" : "off");
+
+	for (std::size_t f = 0; f < frames.size(); ++f) {
+		std::vector<Row> rows;
+		for (std::size_t n = 0; n < num_entries; ++n) {
+			Entry const &e = entries[n];
+			void *const ctx = const_cast<Entry *>(&e);
+			Result res;
+			layoutSource(src, e, frames[f]->pixels);
+			measureFootprint(res, dst, e.dstPitch, runLegacy, ctx, src);
+			timeRuns(res, dst, iterations, cache, runLegacy, ctx, src);
+			rows.push_back(makeRow("legacy", e.name, std::size_t(e.srcWidth) * e.srcHeight * 2, res));
+		}
+
+		for (std::size_t n = 0; n < ScalerEngine::num(); ++n) {
+			ScalerEngine::Desc const &desc = ScalerEngine::get(n);
+			EngineCtx ctx;
+			ctx.engine.setup(desc);
+			ctx.dstPitch = desc.dstWidth;
+			Result res;
+			std::memcpy(src, frames[f]->pixels, std::size_t(gb_width) * gb_height * sizeof *src);
+			measureFootprint(res, dst, ctx.dstPitch, runEngine, &ctx, src);
+			timeRuns(res, dst, iterations, cache, runEngine, &ctx, src);
+			rows.push_back(makeRow("engine", desc.name, std::size_t(gb_width) * gb_height * 2, res));
+		}
+
+		std::stable_sort(rows.begin(), rows.end());
+		std::printf("\n%s\n%-9s %-6s %-34s %10s %8s %8s %8s\n", frames[f]->name.c_str(),
+		            "output", "kind", "scaler", "ns/frame", "read", "written", "LLC miss");
+		for (std::size_t i = 0; i < rows.size(); ++i)
+			std::fputs(rows[i].line.c_str(), stdout);
+	}
+
+	for (std::size_t f = 0; f < frames.size(); ++f)
+		delete frames[f];
+
+	return 0;
+}
@@ -0,0 +1,150 @@
+#include "bordercache.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+char const magic[] = "gambatte border\n";
+
+unsigned long fnv1a(std::string const &s) {
+	unsigned long h = 2166136261ul;
+	for (std::size_t i = 0; i < s.size(); ++i)
+		h = ((h ^ static_cast<unsigned char>(s[i])) * 16777619ul) & 0xFFFFFFFFul;
+
+	return h;
+}
+
+void copyRows(unsigned char *dst, std::ptrdiff_t dstPitch,
+              unsigned char const *src, std::ptrdiff_t srcPitch,
+              std::size_t rowBytes, unsigned height) {
+	for (unsigned y = 0; y < height; ++y)
+		std::memcpy(dst + y * dstPitch, src + y * srcPitch, rowBytes);
+}
+
+} // anon namespace
+
+BorderCache::BorderCache()
+: useCount_(0)
+, hits_(0)
+, misses_(0)
+{
+	for (int i = 0; i < max_entries; ++i) {
+		entries_[i].rowBytes = 0;
+		entries_[i].height = 0;
+		entries_[i].lastUse = 0;
+	}
+}
+
+BorderCache::Entry * BorderCache::find(std::string const &key, std::size_t rowBytes, unsigned height) {
+	for (int i = 0; i < max_entries; ++i) {
+		Entry &e = entries_[i];
+		if (e.pixels && e.rowBytes == rowBytes && e.height == height && e.key == key)
+			return &e;
+	}
+
+	return 0;
+}
+
+BorderCache::Entry & BorderCache::leastRecentlyUsed() {
+	Entry *lru = entries_;
+	for (int i = 1; i < max_entries; ++i) {
+		if (entries_[i].lastUse < lru->lastUse)
+			lru = entries_ + i;
+	}
+
+	return *lru;
+}
+
+bool BorderCache::restore(std::string const &key, void *pixels, std::ptrdiff_t pitch,
+                          std::size_t rowBytes, unsigned height) {
+	Entry *e = find(key, rowBytes, height);
+	if (!e && load(key, rowBytes, height))
+		e = find(key, rowBytes, height);
+	if (!e) {
+		++misses_;
+		return false;
+	}
+
+	++hits_;
+	e->lastUse = ++useCount_;
+	copyRows(static_cast<unsigned char *>(pixels), pitch,
+	         e->pixels, rowBytes, rowBytes, height);
+	return true;
+}
+
+void BorderCache::store(std::string const &key, void const *pixels, std::ptrdiff_t pitch,
+                        std::size_t rowBytes, unsigned height) {
+	Entry *e = find(key, rowBytes, height);
+	if (!e) {
+		e = &leastRecentlyUsed();
+		e->key = key;
+		e->pixels.reset(rowBytes * height);
+		e->rowBytes = rowBytes;
+		e->height = height;
+	}
+
+	e->lastUse = ++useCount_;
+	copyRows(e->pixels, rowBytes, static_cast<unsigned char const *>(pixels), pitch,
+	         rowBytes, height);
+	save(*e);
+}
+
+std::string BorderCache::path(std::string const &key) const {
+	char name[16];
+	std::sprintf(name, "%08lx.bin", fnv1a(key));
+	return dir_ + name;
+}
+
+// The file starts with the key, so that a name collision reads as a miss.
+bool BorderCache::load(std::string const &key, std::size_t const rowBytes, unsigned const height) {
+	if (dir_.empty())
+		return false;
+
+	std::FILE *const file = std::fopen(path(key).c_str(), "rb");
+	if (!file)
+		return false;
+
+	std::string const header = magic + key + '\n';
+	Array<char> fileHeader(header.size());
+	unsigned long fileRowBytes = 0, fileHeight = 0;
+	bool ok = std::fread(fileHeader, 1, header.size(), file) == header.size()
+	       && header.compare(0, header.size(), fileHeader, header.size()) == 0
+	       && std::fscanf(file, "%lu %lu", &fileRowBytes, &fileHeight) == 2
+	       && fileRowBytes == rowBytes && fileHeight == height
+	       && std::fgetc(file) == '\n';
+	if (ok) {
+		Entry &e = leastRecentlyUsed();
+		e.pixels.reset(rowBytes * height);
+		ok = std::fread(e.pixels, 1, e.pixels.size(), file) == e.pixels.size();
+		if (ok) {
+			e.key = key;
+			e.rowBytes = rowBytes;
+			e.height = height;
+		} else {
+			e.pixels.reset();
+		}
+	}
+
+	std::fclose(file);
+	return ok;
+}
+
+void BorderCache::save(Entry const &e) const {
+	if (dir_.empty())
+		return;
+
+	// written under a temporary name first, a file cut short must never be found
+	std::string const name = path(e.key);
+	std::string const tmpName = name + ".tmp";
+	std::FILE *const file = std::fopen(tmpName.c_str(), "wb");
+	if (!file)
+		return;
+
+	bool const ok = std::fprintf(file, "%s%s\n%lu %u\n", magic, e.key.c_str(),
+	                             static_cast<unsigned long>(e.rowBytes), e.height) > 0
+	             && std::fwrite(e.pixels, 1, e.pixels.size(), file) == e.pixels.size();
+	if (std::fclose(file) == 0 && ok)
+		std::rename(tmpName.c_str(), name.c_str());
+	else
+		std::remove(tmpName.c_str());
+}
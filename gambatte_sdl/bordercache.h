@@ -0,0 +1,62 @@
+#ifndef BORDERCACHE_H
+#define BORDERCACHE_H
+
+#include "array.h"
+#include "uncopyable.h"
+#include <cstddef>
+#include <string>
+
+/**
+  * Borders as they end up on screen, scaled and in the screen format.
+  *
+  * Painting a border means decoding a PNG and running one of the border
+  * scalers over it, while the result only depends on the border, the scaler
+  * and the screen format. The caller puts all of that in the key. The last
+  * max_entries borders are kept in memory, and when a directory is set they
+  * are also written there so that the next run finds them too.
+  */
+class BorderCache : Uncopyable {
+public:
+	enum { max_entries = 4 };
+
+	BorderCache();
+
+	/** Directory to keep borders in between runs, empty for memory only. */
+	void setDir(std::string const &dir) { dir_ = dir; }
+
+	/**
+	  * Copies the border stored under key into height rows of rowBytes bytes
+	  * at pixels. Returns false if there is none of that size.
+	  */
+	bool restore(std::string const &key, void *pixels, std::ptrdiff_t pitch,
+	             std::size_t rowBytes, unsigned height);
+
+	void store(std::string const &key, void const *pixels, std::ptrdiff_t pitch,
+	           std::size_t rowBytes, unsigned height);
+
+	unsigned long hits() const { return hits_; }
+	unsigned long misses() const { return misses_; }
+
+private:
+	struct Entry {
+		std::string key;
+		Array<unsigned char> pixels;
+		std::size_t rowBytes;
+		unsigned height;
+		unsigned long lastUse;
+	};
+
+	Entry entries_[max_entries];
+	std::string dir_;
+	unsigned long useCount_;
+	unsigned long hits_;
+	unsigned long misses_;
+
+	Entry * find(std::string const &key, std::size_t rowBytes, unsigned height);
+	Entry & leastRecentlyUsed();
+	bool load(std::string const &key, std::size_t rowBytes, unsigned height);
+	void save(Entry const &e) const;
+	std::string path(std::string const &key) const;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "ghostblend.h"
+#include <cstring>
+
+// Same build time selection as the scaler engine kernels.
+#ifndef SCALER_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GHOSTBLEND_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GHOSTBLEND_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace {
+
+// Moves channel h towards s by (256 - k) / 256 of the difference, rounding
+// towards s. k is at most 243 and differences at most 63, so the product
+// fits in 16 bits.
+inline unsigned decay(unsigned s, unsigned h, int k) {
+	return s + (int(h) - int(s)) * k / 256;
+}
+
+#if defined(GHOSTBLEND_SSE2)
+
+inline __m128i decay(__m128i s, __m128i h, __m128i k) {
+	__m128i t = _mm_mullo_epi16(_mm_sub_epi16(h, s), k);
+	t = _mm_add_epi16(t, _mm_and_si128(_mm_srai_epi16(t, 15), _mm_set1_epi16(255)));
+	return _mm_add_epi16(s, _mm_srai_epi16(t, 8));
+}
+
+#elif defined(GHOSTBLEND_NEON)
+
+inline int16x8_t decay(int16x8_t s, int16x8_t h, int16x8_t k) {
+	int16x8_t t = vmulq_s16(vsubq_s16(h, s), k);
+	t = vaddq_s16(t, vandq_s16(vshrq_n_s16(t, 15), vdupq_n_s16(255)));
+	return vsraq_n_s16(s, t, 8);
+}
+
+#endif
+
+void blendRowKernel(uint16_t *hist, uint16_t const *src, std::size_t n, int k) {
+	std::size_t i = 0;
+#if defined(GHOSTBLEND_SSE2)
+	__m128i const kv = _mm_set1_epi16(k);
+	__m128i const gmask = _mm_set1_epi16(0x3f);
+	__m128i const bmask = _mm_set1_epi16(0x1f);
+	for (; i + 8 <= n; i += 8) {
+		__m128i const s = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+		__m128i const h = _mm_loadu_si128(reinterpret_cast<__m128i const *>(hist + i));
+		__m128i const r = decay(_mm_srli_epi16(s, 11), _mm_srli_epi16(h, 11), kv);
+		__m128i const g = decay(_mm_and_si128(_mm_srli_epi16(s, 5), gmask),
+		                        _mm_and_si128(_mm_srli_epi16(h, 5), gmask), kv);
+		__m128i const b = decay(_mm_and_si128(s, bmask), _mm_and_si128(h, bmask), kv);
+		__m128i const p = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(hist + i), p);
+	}
+#elif defined(GHOSTBLEND_NEON)
+	int16x8_t const kv = vdupq_n_s16(k);
+	uint16x8_t const gmask = vdupq_n_u16(0x3f);
+	uint16x8_t const bmask = vdupq_n_u16(0x1f);
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t const s = vld1q_u16(src + i);
+		uint16x8_t const h = vld1q_u16(hist + i);
+		int16x8_t const r = decay(vreinterpretq_s16_u16(vshrq_n_u16(s, 11)),
+		                          vreinterpretq_s16_u16(vshrq_n_u16(h, 11)), kv);
+		int16x8_t const g = decay(vreinterpretq_s16_u16(vandq_u16(vshrq_n_u16(s, 5), gmask)),
+		                          vreinterpretq_s16_u16(vandq_u16(vshrq_n_u16(h, 5), gmask)), kv);
+		int16x8_t const b = decay(vreinterpretq_s16_u16(vandq_u16(s, bmask)),
+		                          vreinterpretq_s16_u16(vandq_u16(h, bmask)), kv);
+		uint16x8_t const p = vorrq_u16(vorrq_u16(vshlq_n_u16(vreinterpretq_u16_s16(r), 11),
+		                                         vshlq_n_u16(vreinterpretq_u16_s16(g), 5)),
+		                               vreinterpretq_u16_s16(b));
+		vst1q_u16(hist + i, p);
+	}
+#endif
+	for (; i < n; ++i) {
+		unsigned const s = src[i], h = hist[i];
+		hist[i] = decay(s >> 11, h >> 11, k) << 11
+		        | decay(s >> 5 & 0x3f, h >> 5 & 0x3f, k) << 5
+		        | decay(s & 0x1f, h & 0x1f, k);
+	}
+}
+
+} // anon namespace
+
+GhostBlend::GhostBlend(unsigned width, unsigned height)
+: history_(std::size_t(width) * height)
+, rowFrame_(height)
+, settled_(height)
+, frame_(1)
+, width_(width)
+, height_(height)
+, persistence_(0)
+, primed_(false)
+{
+	for (unsigned y = 0; y < height; ++y) {
+		rowFrame_[y] = 0;
+		settled_[y] = false;
+	}
+}
+
+void GhostBlend::setPersistence(int percent) {
+	if (percent < 0)
+		percent = 0;
+	if (percent > max_persistence)
+		percent = max_persistence;
+
+	persistence_ = percent * 256 / 100;
+}
+
+void GhostBlend::blendRow(uint16_t const *src, std::ptrdiff_t srcPitch, unsigned y) {
+	uint16_t *const hist = history_ + y * width_;
+	uint16_t const *const s = src + y * srcPitch;
+	rowFrame_[y] = frame_;
+	if (primed_ && persistence_) {
+		blendRowKernel(hist, s, width_, persistence_);
+		settled_[y] = std::memcmp(hist, s, width_ * sizeof *hist) == 0;
+	} else {
+		std::memcpy(hist, s, width_ * sizeof *hist);
+		settled_[y] = true;
+	}
+}
+
+void GhostBlend::blendFrame(uint16_t const *src, std::ptrdiff_t srcPitch) {
+	for (unsigned y = 0; y < height_; ++y) {
+		if (rowFrame_[y] != frame_)
+			blendRow(src, srcPitch, y);
+	}
+
+	primed_ = true;
+}
+
+bool GhostBlend::simd() {
+#if defined(GHOSTBLEND_SSE2) || defined(GHOSTBLEND_NEON)
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,73 @@
+#ifndef GHOSTBLEND_H
+#define GHOSTBLEND_H
+
+#include "array.h"
+#include "uncopyable.h"
+#include <stdint.h>
+#include <cstddef>
+
+/**
+  * LCD ghosting as an exponential decay towards the newest frame.
+  *
+  * Keeps one RGB565 history frame. Every frame each history pixel moves
+  * towards the new pixel by (1 - persistence) of the difference, per
+  * channel and rounded towards the new pixel, so a still image always
+  * settles exactly. The history is what gets displayed.
+  *
+  * Rows are blended on demand through row() so that a scaler can blend a
+  * source row while it is about to read it anyway; blendFrame() does the
+  * rows that were not asked for.
+  */
+class GhostBlend : Uncopyable {
+public:
+	enum { max_persistence = 95 };
+
+	GhostBlend(unsigned width, unsigned height);
+
+	/** Persistence in percent of the old frame kept per frame, 0 to max_persistence. */
+	void setPersistence(int percent);
+
+	/** Forgets the history, the next frame is shown as is. */
+	void reset() { primed_ = false; }
+
+	/** Starts a new frame. Must be called before row(). */
+	void beginFrame() { ++frame_; }
+
+	/** Blends source row y into the history unless already done this frame. Returns the history row. */
+	uint16_t const * row(uint16_t const *src, std::ptrdiff_t srcPitch, unsigned y) {
+		if (rowFrame_[y] != frame_)
+			blendRow(src, srcPitch, y);
+
+		return history_ + y * width_;
+	}
+
+	/** Blends the rows of the current frame that row() has not done yet. */
+	void blendFrame(uint16_t const *src, std::ptrdiff_t srcPitch);
+
+	/**
+	  * True if history row y came out equal to the source row last blended
+	  * into it, in which case blending that source row again changes nothing.
+	  */
+	bool settled(unsigned y) const { return settled_[y]; }
+
+	uint16_t const * history() const { return history_; }
+	unsigned width() const { return width_; }
+	unsigned height() const { return height_; }
+
+	/** True when the blend kernel was built with SSE2 or NEON. */
+	static bool simd();
+
+private:
+	Array<uint16_t> history_;
+	Array<unsigned long> rowFrame_;
+	Array<unsigned char> settled_;
+	unsigned long frame_;
+	unsigned width_;
+	unsigned height_;
+	unsigned persistence_;
+	bool primed_;
+
+	void blendRow(uint16_t const *src, std::ptrdiff_t srcPitch, unsigned y);
+};
+
+#endif
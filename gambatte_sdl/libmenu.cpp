@@ -17,12 +17,15 @@
 #include "SFont.h"
 #include "menu.h"
 #include "scaler.h"
+#include "bordercache.h"
 
 #include "src/audiosink.h"
 #include "menusounds.h"
 #include "defaultborders.h"
 
 #include <fstream>
+#include <map>
+#include <sys/stat.h>
 
 static void display_menu(SDL_Surface *surface, menu_t *menu);
 static void display_menu_cheat(SDL_Surface *surface, menu_t *menu);
@@ -33,9 +36,8 @@ static void invert_rect(SDL_Surface* surface, SDL_Rect *rect);
 static void put_pixel(SDL_Surface *surface, int x, int y, Uint32 pixel);
 static Uint32 get_pixel(SDL_Surface *surface, int x, int y);
 
-void load_border(std::string borderfilename);
-
 static SDL_Surface *screen = NULL;
+static BorderCache bordercache;
 static SFont_Font* font = NULL;
 static SDL_RWops *RWops;
 static SDL_RWops *RWops1;
@@ -55,8 +57,16 @@ Mix_Chunk *menusound_back = NULL;
 Mix_Chunk *menusound_move = NULL;
 Mix_Chunk *menusound_ok = NULL;
 
+// the menu font is decoded the first time something is written with it, so
+// starting a game straight from the command line never has to.
+static void require_font() {
+	if (!font) {
+		init_menu();
+	}
+}
+
 // Default config values
-int showfps = 0, ghosting = 1, biosenabled = 0, colorfilter = 0, gameiscgb = 0, buttonlayout = 0, stereosound = 1, prefercgb = 1, ffwhotkey = 1, stateautoload = 0, stateautosave = 0;
+int showfps = 0, ghosting = 1, ghostpersistence = 50, biosenabled = 0, colorfilter = 0, gameiscgb = 0, buttonlayout = 0, stereosound = 1, prefercgb = 1, ffwhotkey = 1, stateautoload = 0, stateautosave = 0;
 uint32_t menupalblack = 0x000000, menupaldark = 0x505450, menupallight = 0xA8A8A8, menupalwhite = 0xF8FCF8;
 int filtervalue[12] = {135, 20, 0, 25, 0, 125, 20, 25, 0, 20, 105, 30};
 #ifndef VERSION_FUNKEYS
@@ -196,11 +206,13 @@ void getSaveStatePreview(int statenum){
 			hlcolor = SDL_MapRGB(statepreview->format, 168, 168, 168);
 		}
 		SDL_FillRect(statepreview, NULL, hlcolor);
+		require_font();
 		SFont_WriteCenter(statepreview, font, 32, "No data");
 	}
 }
 
 void printSaveStatePreview(SDL_Surface *surface, int posx, int posy){
+	require_font();
 	SFont_Write(surface, font, posx + 13, posy, "Preview");
 	SDL_Rect rect;
 	rect.x = posx;
@@ -231,6 +243,7 @@ void apply_cfilter(SDL_Surface *surface) {
 }
 
 void printOverlay(const char *text){
+	require_font();
 	uint32_t hlcolor = SDL_MapRGB(textoverlay->format, 248, 252, 248);
 	SDL_FillRect(textoverlay, NULL, hlcolor);
 	SFont_WriteCenter(textoverlay, font, 0, text);
@@ -310,6 +323,7 @@ void freeMenuSounds(){
 	Mix_FreeChunk(menusound_back);
 	Mix_FreeChunk(menusound_move);
 	Mix_FreeChunk(menusound_ok);
+	menusound_in = menusound_back = menusound_move = menusound_ok = NULL;
 }
 
 void playMenuSound_in(){
@@ -332,12 +346,13 @@ int switchToMenuAudio(){
 	//SDL_PauseAudio(1);
     SDL_CloseAudio(); //disable emulator audio, otherwise menu audio wont work
     openMenuAudio(); //enable menu audio
-    loadMenuSounds();
+    if(!menusound_in){
+    	loadMenuSounds(); //decoded on first menu entry and kept, the mixer format never changes
+    }
     return 0;
 }
 
 void switchToEmulatorAudio(){
-	freeMenuSounds();
     closeMenuAudio();//disable menu audio, otherwise emulator audio wont work
     reopenAudio(); //re-enable emulator audio before resuming emulation, otherwise gambatte will freeze.
 }
@@ -531,6 +546,7 @@ int menu_main(menu_t *menu) {
 		while (SDL_PollEvent(&event)) {
 			switch (event.type) {
 				case SDL_QUIT:
+					finish_recording();
 					exit(0);
 					break;
 				case SDL_KEYDOWN:
@@ -748,6 +764,7 @@ int menu_cheat(menu_t *menu) {
 		while (SDL_PollEvent(&event)) {
 			switch (event.type) {
 				case SDL_QUIT:
+					finish_recording();
 					exit(0);
 					break;
 				case SDL_KEYDOWN:
@@ -909,6 +926,7 @@ int menu_cheat(menu_t *menu) {
 }
 
 static void display_menu(SDL_Surface *surface, menu_t *menu) {
+    require_font();
     int font_height = SFont_TextHeight(font);
     int i;
     int line =  0;
@@ -1077,6 +1095,7 @@ static void display_menu(SDL_Surface *surface, menu_t *menu) {
 }
 
 static void display_menu_cheat(SDL_Surface *surface, menu_t *menu) {
+    require_font();
     int font_height = SFont_TextHeight(font);
     int font_width = SFont_TextWidth(font, "F");
     int i, j, collimit, numcodes, currcode;
@@ -1509,8 +1528,55 @@ void createBorderSurface(){
 	}
 }	
 
-void load_border(std::string borderfilename){ //load border from menu
+// modification times of the border files, looked up once per rescan_borders()
+// rather than on every menu redraw.
+static std::map<std::string, long> bordermtimes;
+
+void rescan_borders(){
+	bordermtimes.clear();
+}
+
+static void append_mtime(std::string &key, std::string const &path){
+	std::map<std::string, long>::iterator it = bordermtimes.find(path);
+	if (it == bordermtimes.end()){
+		struct stat st;
+		it = bordermtimes.insert(std::make_pair(path,
+			stat(path.c_str(), &st) == 0 ? (long)st.st_mtime : 0L)).first;
+	}
+	char mtime[24];
+	sprintf(mtime, "|%ld", it->second);
+	key += mtime;
+}
+
+// Everything borderimg depends on. Border files are identified by modification
+// time as well, so that a cache never holds on to a border that was replaced.
+static std::string border_key(std::string const &borderfilename){
+	char state[24];
+	sprintf(state, "|%d|%06x|", gameiscgb, (unsigned)menupalwhite);
+	std::string key = borderfilename + state + selectedscaler;
+	std::string const borderdir = (homedir + "/.gambatte/borders/");
+	if (borderfilename == "AUTO"){
+		key += "|" + currgamename;
+		append_mtime(key, borderdir + currgamename + ".png");
+		append_mtime(key, borderdir + "default.png");
+	} else if (borderfilename != "DEFAULT" && borderfilename != "NONE"){
+		append_mtime(key, borderdir + borderfilename);
+	}
+	return key;
+}
+
+bool load_border(std::string borderfilename){ //load border from menu
+	// there is no need to decode and build borderimg again every time
+	// the video mode is set or a menu is closed.
+	static std::string loadedborder;
+	std::string const border = border_key(borderfilename);
+	if (borderimg && border == loadedborder){
+		return true;
+	}
+	loadedborder.clear();
+
 	SDL_FreeSurface(borderimg);
+	borderimg = NULL;
 	std::string fullimgpath = (homedir + "/.gambatte/borders/");
 
 	if (borderfilename == "DEFAULT"){
@@ -1551,11 +1617,14 @@ void load_border(std::string borderfilename){ //load border from menu
 	if(!temp){
     	if(borderfilename != "NONE"){
     		printf("error loading %s\n", fullimgpath.c_str());
+    		return false;
     	} else {
     		createBorderSurface();
+    		loadedborder = border;
     	}
     } else {
     	createBorderSurface();
+    	loadedborder = border;
     	SDL_Rect brect;
 		brect.x = (borderimg->w - temp->w) / 2;
 		brect.y = (borderimg->h - temp->h) / 2;
@@ -1592,6 +1661,40 @@ void load_border(std::string borderfilename){ //load border from menu
 		}		
 		SDL_FreeSurface(temp);
     }	
+    return true;
+}
+
+bool paint_border_cached(SDL_Surface *surface, std::string const &borderfilename, uint32_t background){
+	static bool cachedirchecked = false;
+	if (!cachedirchecked){
+		// borders are kept on disk too if the user has made a directory for it
+		std::string const cachedir = (homedir + "/.gambatte/borders/cache/");
+		struct stat st;
+		if (stat(cachedir.c_str(), &st) == 0 && S_ISDIR(st.st_mode)){
+			bordercache.setDir(cachedir);
+		}
+		cachedirchecked = true;
+	}
+
+	SDL_PixelFormat const *format = surface->format;
+	char state[64];
+	sprintf(state, "|%dx%d|%d|%08x|%08x", surface->w, surface->h, format->BitsPerPixel,
+		(unsigned)format->Rmask, (unsigned)background);
+	std::string const key = border_key(borderfilename) + state;
+	std::size_t const rowbytes = surface->w * format->BytesPerPixel;
+	if (bordercache.restore(key, surface->pixels, surface->pitch, rowbytes, surface->h)){
+		return true;
+	}
+
+	if (!load_border(borderfilename)){
+		// as if the border was disabled
+		clear_surface(surface, 0x000000);
+		return false;
+	}
+	clear_surface(surface, background);
+	paint_border(surface);
+	bordercache.store(key, surface->pixels, surface->pitch, rowbytes, surface->h);
+	return true;
 }
 
 void paint_border(SDL_Surface *surface){
@@ -1948,11 +2051,9 @@ static void redraw(menu_t *menu) {
 	if(forcemenuexit == 0){
 		clear_surface(menuscreen, 0xFFFFFF);
 		if((!gambatte_p->isCgb()) && (dmgbordername != "NONE")) { // if system is DMG
-			clear_surface(screen, convert_hexcolor(screen, menupalwhite));
-			paint_border(screen);
+			paint_border_cached(screen, dmgbordername, convert_hexcolor(screen, menupalwhite));
 		} else if((gambatte_p->isCgb()) && (gbcbordername != "NONE")) { // if system is GBC
-			clear_surface(screen, 0x000000);
-			paint_border(screen);
+			paint_border_cached(screen, gbcbordername, 0x000000);
 		} else { //if border image is disabled
 #ifndef VERSION_FUNKEYS
 			clear_surface(screen, 0x000000);
@@ -1973,13 +2074,11 @@ static void redraw_blank(menu_t *menu) {
 		rect.h = 120;
 		clear_surface(menuscreen, 0xFFFFFF);
 		if((!gambatte_p->isCgb()) && (dmgbordername != "NONE")) { // if system is DMG
-			clear_surface(screen, convert_hexcolor(screen, menupalwhite));
-			paint_border(screen);
+			paint_border_cached(screen, dmgbordername, convert_hexcolor(screen, menupalwhite));
 			display_menu(menuscreen, menu);
 			SDL_FillRect(menuscreen, &rect, convert_hexcolor(screen, 0xFFFFFF));
 		} else if((gambatte_p->isCgb()) && (gbcbordername != "NONE")) { // if system is GBC
-			clear_surface(screen, 0x000000);
-			paint_border(screen);
+			paint_border_cached(screen, gbcbordername, 0x000000);
 			display_menu(menuscreen, menu);
 			SDL_FillRect(menuscreen, &rect, convert_hexcolor(screen, 0xFFFFFF));
 		} else { //if border image is disabled
@@ -1998,11 +2097,9 @@ static void redraw_cheat(menu_t *menu) {
 	if(forcemenuexit == 0){
 		clear_surface(menuscreen, 0xFFFFFF);
 		if((!gambatte_p->isCgb()) && (dmgbordername != "NONE")) { // if system is DMG
-			clear_surface(screen, convert_hexcolor(screen, menupalwhite));
-			paint_border(screen);
+			paint_border_cached(screen, dmgbordername, convert_hexcolor(screen, menupalwhite));
 		} else if((gambatte_p->isCgb()) && (gbcbordername != "NONE")) { // if system is GBC
-			clear_surface(screen, 0x000000);
-			paint_border(screen);
+			paint_border_cached(screen, gbcbordername, 0x000000);
 		} else { //if border image is disabled
 #ifndef VERSION_FUNKEYS
 			clear_surface(screen, 0x000000);
@@ -2289,6 +2386,7 @@ void saveConfig(int pergame){
 		"STATEAUTOSAVE %d\n"
 		"BIOSENABLED %d\n"
 		"GHOSTING %d\n"
+		"GHOSTPERSISTENCE %d\n"
 		"BUTTONLAYOUT %d\n"
 		"FFWHOTKEY %d\n"
 		"STEREOSOUND %d\n",
@@ -2303,6 +2401,7 @@ void saveConfig(int pergame){
 		stateautosave,
 		biosenabled,
 		ghosting,
+		ghostpersistence,
 		buttonlayout,
 		ffwhotkey,
 		stereosound) < 0) {
@@ -2417,6 +2516,9 @@ void loadConfig(){
 		} else if (!strcmp(line, "GHOSTING")) {
 			sscanf(arg, "%d", &value);
 			ghosting = value;
+		} else if (!strcmp(line, "GHOSTPERSISTENCE")) {
+			sscanf(arg, "%d", &value);
+			ghostpersistence = value;
 		} else if (!strcmp(line, "BUTTONLAYOUT")) {
 			sscanf(arg, "%d", &value);
 			buttonlayout = value;
@@ -119,7 +119,7 @@ extern SDL_Surface *menuscreen;
 extern SDL_Surface *surface_menuinout;
 extern SDL_Surface *textoverlay;
 extern SDL_Surface *textoverlaycolored;
-extern int showfps, ghosting, biosenabled, colorfilter, gameiscgb, buttonlayout, stereosound, prefercgb, ffwhotkey, stateautoload, stateautosave;
+extern int showfps, ghosting, ghostpersistence, biosenabled, colorfilter, gameiscgb, buttonlayout, stereosound, prefercgb, ffwhotkey, stateautoload, stateautosave;
 extern uint32_t menupalblack, menupaldark, menupallight, menupalwhite;
 extern int filtervalue[12];
 extern std::string selectedscaler, dmgbordername, gbcbordername, palname, filtername, currgamename, homedir, ipuscaling;
@@ -162,8 +162,10 @@ void clean_menu_screen(menu_t *menu);
 void paint_titlebar(SDL_Surface *surface);
 void paint_titlebar_cheat();
 void convert_bw_surface_colors(SDL_Surface *surface, SDL_Surface *surface2, const uint32_t repl_col_black, const uint32_t repl_col_dark, const uint32_t repl_col_light, const uint32_t repl_col_white, int mode);
-void load_border(std::string borderfilename);
+bool load_border(std::string borderfilename);
 void paint_border(SDL_Surface *surface);
+bool paint_border_cached(SDL_Surface *surface, std::string const &borderfilename, uint32_t background);
+void rescan_borders();
 uint32_t convert_hexcolor(SDL_Surface *surface, const uint32_t color);
 int currentEntryInList(menu_t *menu, std::string fname, int isfile);
 void clear_surface(SDL_Surface *surface, Uint32 color);
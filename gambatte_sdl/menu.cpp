@@ -12,6 +12,7 @@
 
 #include <string.h>
 #include <string>
+#include <algorithm>
 #include <locale>
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,6 +20,10 @@
 #include <math.h>
 
 #include "src/audiosink.h"
+#include "framepacer.h"
+#include "perfhud.h"
+#include "src/recorder.h"
+#include "trace.h"
 
 static SDL_Surface *screen;
 static SFont_Font* font;
@@ -94,11 +99,118 @@ void menu_set_screen(SDL_Surface *set_screen) {
 	libmenu_set_screen(screen);
 }
 
+static FramePacer const *framepacer;
+
+void set_framepacer(FramePacer const *pacer) {
+    framepacer = pacer;
+}
+
+// Wake-up jitter of the frame pacer: mean in usecs, "s" when it has to spin,
+// and one bar per histogram bucket (<50us, <100us, ... >4ms).
+static void show_jitter(SDL_Surface *surface, int y) {
+    char buffer[16];
+    sprintf(buffer, "%luus%s", (unsigned long)framepacer->jitterMean(), framepacer->spinning() ? " s" : "");
+    SFont_Write(surface, fpsfont, 0, y, buffer);
+    y += SFont_TextHeight(fpsfont) + 1;
+
+    // the bars shrink as well as grow, so they need a background of their own.
+    SDL_Rect back = { 0, Sint16(y), FramePacer::num_jitter_buckets * 3, 16 };
+    SDL_FillRect(surface, &back, SDL_MapRGB(surface->format, 0, 0, 0));
+    Uint32 const color = SDL_MapRGB(surface->format, 255, 255, 255);
+    for (int i = 0; i < FramePacer::num_jitter_buckets; i++) {
+        int const h = (framepacer->jitterCount(i) * 16 + FramePacer::jitter_window - 1) / FramePacer::jitter_window;
+        SDL_Rect bar = { Sint16(i * 3), Sint16(y + 16 - h), 2, Uint16(h) };
+        SDL_FillRect(surface, &bar, color);
+    }
+}
+
+static PerfHud const *perfhud;
+
+void set_perfhud(PerfHud const *hud) {
+    perfhud = hud;
+}
+
+static Recorder *recorder;
+
+void set_recorder(Recorder *rec) {
+    recorder = rec;
+}
+
+// The quit paths exit() without returning to the main loop, so the recording
+// has to be closed here or the WAV header would be left with zero sizes.
+void finish_recording() {
+    if (recorder)
+        recorder->finish();
+}
+
+// Performance HUD, one column per frame: time spent emulating (green),
+// scaling (blue), presenting (yellow) and waiting on audio (red) stacked
+// against a line at one frame's worth of time, the audio buffer fill below
+// it, and a strip marking skipped (red) and fast forwarded (orange) frames.
+static void show_perfhud(SDL_Surface *surface, int y) {
+    enum { time_h = 32, budget_h = 24, fill_h = 12, mark_h = 2 };
+    usec_t const budget = 16743;
+    int const w = PerfHud::num_frames;
+
+    SDL_Rect back = { 0, Sint16(y), Uint16(w), time_h + 1 + fill_h + 1 + mark_h };
+    SDL_FillRect(surface, &back, SDL_MapRGB(surface->format, 0, 0, 0));
+    SDL_Rect line = { 0, Sint16(y + time_h - budget_h), Uint16(w), 1 };
+    SDL_FillRect(surface, &line, SDL_MapRGB(surface->format, 96, 96, 96));
+
+    Uint32 const colors[PerfHud::num_timings] = {
+        SDL_MapRGB(surface->format, 0, 200, 0),
+        SDL_MapRGB(surface->format, 64, 128, 255),
+        SDL_MapRGB(surface->format, 255, 220, 0),
+        SDL_MapRGB(surface->format, 255, 64, 64)
+    };
+    Uint32 const white = SDL_MapRGB(surface->format, 255, 255, 255);
+    Uint32 const red = SDL_MapRGB(surface->format, 255, 0, 0);
+    Uint32 const orange = SDL_MapRGB(surface->format, 255, 160, 0);
+    for (int n = 0; n < w; n++) {
+        int top = time_h;
+        for (int t = 0; t < PerfHud::num_timings && top > 0; t++) {
+            int h = (perfhud->timing(PerfHud::Timing(t), n) * budget_h + budget / 2) / budget;
+            h = std::min(h, top);
+            top -= h;
+            SDL_Rect bar = { Sint16(n), Sint16(y + top), 1, Uint16(h) };
+            SDL_FillRect(surface, &bar, colors[t]);
+        }
+
+        int const fh = (perfhud->fill(n) * fill_h + 50) / 100;
+        SDL_Rect fill = { Sint16(n), Sint16(y + time_h + 1 + fill_h - fh), 1, Uint16(fh) };
+        SDL_FillRect(surface, &fill, white);
+
+        if (perfhud->skipped(n) || perfhud->speed(n) > 1) {
+            SDL_Rect mark = { Sint16(n), Sint16(y + time_h + 1 + fill_h + 1), 1, mark_h };
+            SDL_FillRect(surface, &mark, perfhud->skipped(n) ? red : orange);
+        }
+    }
+
+    y += time_h + 1 + fill_h + 1 + mark_h + 1;
+    char buffer[48];
+    sprintf(buffer, "E%.1f S%.1f P%.1f A%.1f",
+            perfhud->mean(PerfHud::time_emulate) / 1000.0, perfhud->mean(PerfHud::time_scale) / 1000.0,
+            perfhud->mean(PerfHud::time_present) / 1000.0, perfhud->mean(PerfHud::time_audio) / 1000.0);
+    SFont_Write(surface, fpsfont, 0, y, buffer);
+    y += SFont_TextHeight(fpsfont) + 1;
+    sprintf(buffer, "F%u%% K%u X%u", perfhud->fill(w - 1), perfhud->numSkipped(), perfhud->speed(w - 1));
+    SFont_Write(surface, fpsfont, 0, y, buffer);
+}
+
 void show_fps(SDL_Surface *surface, int fps) {
     char buffer[8];
     sprintf(buffer, "%d", fps);
     if (showfps) {
+        if (!fpsfont)
+            init_fps_font(); // not needed until the counter is first shown
         SFont_Write(surface, fpsfont, 0, 0, buffer);
+        int y = SFont_TextHeight(fpsfont) + 1;
+        if (framepacer) {
+            show_jitter(surface, y);
+            y += SFont_TextHeight(fpsfont) + 1 + 16 + 1;
+        }
+        if (showfps == 2 && perfhud)
+            show_perfhud(surface, y);
     }
 }
 
@@ -262,6 +374,7 @@ void main_menu_with_anim() {//create a single menu frame to make the entry anima
 }
 
 void main_menu() {
+    TRACE_SCOPE("menu");
 
     //switchToMenuAudio();
 
@@ -346,6 +459,7 @@ static void callback_quit(menu_t *caller_menu) {
     printf("exiting...\n");
     forcemenuexit = 0;
     gambatte_p->saveSavedata();
+    finish_recording();
     caller_menu->quit = 1;
     SDL_Quit();
 #ifdef POWEROFF
@@ -700,6 +814,7 @@ static void callback_system(menu_t *caller_menu);
 static void callback_savestatesettings(menu_t *caller_menu);
 static void callback_usebios(menu_t *caller_menu);
 static void callback_ghosting(menu_t *caller_menu);
+static void callback_ghostpersistence(menu_t *caller_menu);
 static void callback_controls(menu_t *caller_menu);
 static void callback_sound(menu_t *caller_menu);
 
@@ -778,6 +893,11 @@ static void callback_settings(menu_t *caller_menu) {
     menu_add_entry(menu, menu_entry);
     menu_entry->callback = callback_ghosting;
 
+    menu_entry = new_menu_entry(0);
+    menu_entry_set_text(menu_entry, "Ghost Persistence");
+    menu_add_entry(menu, menu_entry);
+    menu_entry->callback = callback_ghostpersistence;
+
     menu_entry = new_menu_entry(0);
     menu_entry_set_text(menu_entry, "Controls");
     menu_add_entry(menu, menu_entry);
@@ -1048,11 +1168,9 @@ static void callback_deleteconfig_pergame_apply(menu_t *caller_menu) {
     loadConfig(); // load default config
     refreshkeys = 1;                  //
     if(gameiscgb == 0){               //
-        loadPalette(palname);         //
-        load_border(dmgbordername);   //
-    } else if(gameiscgb == 1){        // apply loaded default config
+        loadPalette(palname);         // apply loaded default config
+    } else if(gameiscgb == 1){        //
         loadFilter(filtername);       //
-        load_border(gbcbordername);   //
     }                                 //
     blitter_p->setScreenRes();        //
 
@@ -1111,6 +1229,11 @@ static void callback_showfps(menu_t *caller_menu) {
     menu_add_entry(menu, menu_entry);
     menu_entry->callback = callback_selectedshowfps;
 
+    menu_entry = new_menu_entry(0);
+    menu_entry_set_text(menu_entry, "ON + HUD");
+    menu_add_entry(menu, menu_entry);
+    menu_entry->callback = callback_selectedshowfps;
+
     menu->selected_entry = showfps; 
 
     playMenuSound_in();
@@ -1297,9 +1420,6 @@ static void callback_selectedscaler(menu_t *caller_menu) {
     selectedscaler = std::string(caller_menu->entries[caller_menu->selected_entry]->text);
     if(gameiscgb == 0){
         loadPalette(palname);
-        load_border(dmgbordername);
-    } else if(gameiscgb == 1){
-        load_border(gbcbordername);
     }
     blitter_p->setScreenRes(); /* switch to selected resolution */
     clean_menu_screen(caller_menu);
@@ -1374,10 +1494,8 @@ static void callback_nopalette(menu_t *caller_menu) {
     palname = "NONE";
     loadPalette(palname);
     if(gameiscgb == 1){
-        load_border(gbcbordername);
         caller_menu->quit = 1;
     } else {
-        load_border(dmgbordername);
         caller_menu->quit = 0;
     }
 }
@@ -1387,10 +1505,8 @@ static void callback_defaultpalette(menu_t *caller_menu) {
     palname = "DEFAULT";
     loadPalette(palname);
     if(gameiscgb == 1){
-        load_border(gbcbordername);
         caller_menu->quit = 1;
     } else {
-        load_border(dmgbordername);
         caller_menu->quit = 0;
     }
 }
@@ -1400,10 +1516,8 @@ static void callback_autopalette(menu_t *caller_menu) {
     palname = "AUTO";
     loadPalette(palname);
     if(gameiscgb == 1){
-        load_border(gbcbordername);
         caller_menu->quit = 1;
     } else {
-        load_border(dmgbordername);
         caller_menu->quit = 0;
     }
 }
@@ -1413,10 +1527,8 @@ static void callback_selectedpalette(menu_t *caller_menu) {
     palname = palettelist[caller_menu->selected_entry - 3]->d_name; // we added 3 extra entries before the list, so we do (-3).
     loadPalette(palname);
     if(gameiscgb == 1){
-        load_border(gbcbordername);
         caller_menu->quit = 1;
     } else {
-        load_border(dmgbordername);
         caller_menu->quit = 0;
     }
 }
@@ -1578,7 +1690,7 @@ static void callback_nodmgborder(menu_t *caller_menu) {
     if(gameiscgb == 1){
         caller_menu->quit = 1;
     } else {
-        load_border(dmgbordername);
+        rescan_borders();
         clean_menu_screen(caller_menu);
         caller_menu->quit = 0;
     }
@@ -1590,7 +1702,7 @@ static void callback_defaultdmgborder(menu_t *caller_menu) {
     if(gameiscgb == 1){
         caller_menu->quit = 1;
     } else {
-        load_border(dmgbordername);
+        rescan_borders();
         clean_menu_screen(caller_menu);
         caller_menu->quit = 0;
     }
@@ -1602,7 +1714,7 @@ static void callback_autodmgborder(menu_t *caller_menu) {
     if(gameiscgb == 1){
         caller_menu->quit = 1;
     } else {
-        load_border(dmgbordername);
+        rescan_borders();
         clean_menu_screen(caller_menu);
         caller_menu->quit = 0;
     }
@@ -1614,7 +1726,7 @@ static void callback_selecteddmgborder(menu_t *caller_menu) {
     if(gameiscgb == 1){
         caller_menu->quit = 1;
     } else {
-        load_border(dmgbordername);
+        rescan_borders();
         clean_menu_screen(caller_menu);
         caller_menu->quit = 0;
     }
@@ -1686,7 +1798,7 @@ static void callback_nogbcborder(menu_t *caller_menu) {
     playMenuSound_ok();
     gbcbordername = "NONE";
     if(gameiscgb == 1){
-        load_border(gbcbordername);
+        rescan_borders();
         clean_menu_screen(caller_menu);
         caller_menu->quit = 0;
     } else {
@@ -1698,7 +1810,7 @@ static void callback_defaultgbcborder(menu_t *caller_menu) {
     playMenuSound_ok();
     gbcbordername = "DEFAULT";
     if(gameiscgb == 1){
-        load_border(gbcbordername);
+        rescan_borders();
         clean_menu_screen(caller_menu);
         caller_menu->quit = 0;
     } else {
@@ -1710,7 +1822,7 @@ static void callback_autogbcborder(menu_t *caller_menu) {
     playMenuSound_ok();
     gbcbordername = "AUTO";
     if(gameiscgb == 1){
-        load_border(gbcbordername);
+        rescan_borders();
         clean_menu_screen(caller_menu);
         caller_menu->quit = 0;
     } else {
@@ -1722,7 +1834,7 @@ static void callback_selectedgbcborder(menu_t *caller_menu) {
     playMenuSound_ok();
     gbcbordername = gbcborderlist[caller_menu->selected_entry - 3]->d_name; // we added 3 extra entries before the list, so we do (-3).
     if(gameiscgb == 1){
-        load_border(gbcbordername);
+        rescan_borders();
         clean_menu_screen(caller_menu);
         caller_menu->quit = 0;
     } else {
@@ -1971,6 +2083,53 @@ static void callback_selectedghosting(menu_t *caller_menu) {
     caller_menu->quit = 1;
 }
 
+/* ==================== GHOST PERSISTENCE MENU =========================== */
+
+/* share of the previous frame kept each frame, in percent. */
+static const int ghostpersistencelevels[] = { 10, 20, 30, 40, 50, 60, 70, 80, 90, 95 };
+static const int numghostpersistencelevels = sizeof(ghostpersistencelevels) / sizeof(ghostpersistencelevels[0]);
+
+static void callback_selectedghostpersistence(menu_t *caller_menu);
+
+static void callback_ghostpersistence(menu_t *caller_menu) {
+
+    menu_t *menu;
+    menu_entry_t *menu_entry;
+    (void) caller_menu;
+    menu = new_menu();
+
+    menu_set_header(menu, menu_main_title.c_str());
+    menu_set_title(menu, "Ghost Persistence");
+    menu->back_callback = callback_back;
+
+    /* a value set in the config file that is not listed selects the closest level. */
+    int closest = 0;
+    for (int i = 0; i < numghostpersistencelevels; ++i) {
+        char text[8];
+        sprintf(text, "%d%%", ghostpersistencelevels[i]);
+        menu_entry = new_menu_entry(0);
+        menu_entry_set_text(menu_entry, text);
+        menu_add_entry(menu, menu_entry);
+        menu_entry->callback = callback_selectedghostpersistence;
+
+        if (abs(ghostpersistencelevels[i] - ghostpersistence) < abs(ghostpersistencelevels[closest] - ghostpersistence))
+            closest = i;
+    }
+
+    menu->selected_entry = closest;
+
+    playMenuSound_in();
+    menu_main(menu);
+
+    delete_menu(menu);
+}
+
+static void callback_selectedghostpersistence(menu_t *caller_menu) {
+    playMenuSound_ok();
+    ghostpersistence = ghostpersistencelevels[caller_menu->selected_entry];
+    caller_menu->quit = 1;
+}
+
 /* ==================== CONTROLS MENU ================================ */
 
 static void callback_buttonlayout(menu_t *caller_menu);
@@ -5,6 +5,10 @@
 #include "src/blitterwrapper.h"
 #include "libmenu.h"
 
+class FramePacer;
+class PerfHud;
+class Recorder;
+
 extern gambatte::GB *gambatte_p;
 extern BlitterWrapper *blitter_p;
 extern SDL_Surface *surface;
@@ -16,6 +20,10 @@ int init_menu();
 void main_menu();
 void main_menu_with_anim();
 void show_fps(SDL_Surface *surface, int fps);
+void set_framepacer(FramePacer const *pacer);
+void set_perfhud(PerfHud const *hud);
+void set_recorder(Recorder *rec);
+void finish_recording();
 
 
 #endif
@@ -0,0 +1,245 @@
+#include "ramsearch.h"
+#include <cstdio>
+#include <cstring>
+
+// Same build time selection as the scaler engine kernels.
+#ifndef SCALER_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAMSEARCH_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RAMSEARCH_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+using gambatte::GB;
+
+namespace {
+
+GB::MemoryArea const areaIds[] = { GB::WRAM, GB::HRAM, GB::SRAM };
+
+std::size_t roundUp32(std::size_t n) { return (n + 31) & ~std::size_t(31); }
+
+unsigned popCount(uint32_t x) {
+	x = x - (x >> 1 & 0x55555555);
+	x = (x & 0x33333333) + (x >> 2 & 0x33333333);
+	x = (x + (x >> 4)) & 0x0F0F0F0F;
+	return x * 0x01010101 >> 24;
+}
+
+uint32_t compare32Scalar(unsigned char const *cur, unsigned char const *prev,
+                         RamSearch::Filter f, unsigned char value) {
+	uint32_t mask = 0;
+	for (int i = 0; i < 32; ++i) {
+		bool pass = false;
+		switch (f) {
+		case RamSearch::filter_equal: pass = cur[i] == prev[i]; break;
+		case RamSearch::filter_changed: pass = cur[i] != prev[i]; break;
+		case RamSearch::filter_increased: pass = cur[i] > prev[i]; break;
+		case RamSearch::filter_decreased: pass = cur[i] < prev[i]; break;
+		case RamSearch::filter_value: pass = cur[i] == value; break;
+		}
+
+		mask |= uint32_t(pass) << i;
+	}
+
+	return mask;
+}
+
+#if defined(RAMSEARCH_SSE2)
+
+uint32_t compare16(__m128i cur, __m128i prev, RamSearch::Filter f, __m128i value) {
+	__m128i const eq = _mm_cmpeq_epi8(cur, prev);
+	switch (f) {
+	case RamSearch::filter_equal: return _mm_movemask_epi8(eq);
+	case RamSearch::filter_changed: return ~_mm_movemask_epi8(eq) & 0xFFFF;
+	case RamSearch::filter_increased:
+		return _mm_movemask_epi8(_mm_andnot_si128(eq, _mm_cmpeq_epi8(_mm_max_epu8(cur, prev), cur)));
+	case RamSearch::filter_decreased:
+		return _mm_movemask_epi8(_mm_andnot_si128(eq, _mm_cmpeq_epi8(_mm_min_epu8(cur, prev), cur)));
+	case RamSearch::filter_value: return _mm_movemask_epi8(_mm_cmpeq_epi8(cur, value));
+	}
+
+	return 0;
+}
+
+// One bit per byte of cur, set where it passes f.
+uint32_t compare32(unsigned char const *cur, unsigned char const *prev,
+                   RamSearch::Filter f, unsigned char value) {
+	__m128i const v = _mm_set1_epi8(value);
+	__m128i const *const c = reinterpret_cast<__m128i const *>(cur);
+	__m128i const *const p = reinterpret_cast<__m128i const *>(prev);
+	return compare16(_mm_loadu_si128(c), _mm_loadu_si128(p), f, v)
+	     | compare16(_mm_loadu_si128(c + 1), _mm_loadu_si128(p + 1), f, v) << 16;
+}
+
+#elif defined(RAMSEARCH_NEON)
+
+uint32_t movemask(uint8x16_t m) {
+	static uint8_t const weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	uint8x16_t const bits = vandq_u8(m, vld1q_u8(weights));
+	uint64x2_t const sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(bits)));
+	return vgetq_lane_u64(sums, 0) | vgetq_lane_u64(sums, 1) << 8;
+}
+
+uint32_t compare16(uint8x16_t cur, uint8x16_t prev, RamSearch::Filter f, uint8x16_t value) {
+	switch (f) {
+	case RamSearch::filter_equal: return movemask(vceqq_u8(cur, prev));
+	case RamSearch::filter_changed: return ~movemask(vceqq_u8(cur, prev)) & 0xFFFF;
+	case RamSearch::filter_increased: return movemask(vcgtq_u8(cur, prev));
+	case RamSearch::filter_decreased: return movemask(vcltq_u8(cur, prev));
+	case RamSearch::filter_value: return movemask(vceqq_u8(cur, value));
+	}
+
+	return 0;
+}
+
+uint32_t compare32(unsigned char const *cur, unsigned char const *prev,
+                   RamSearch::Filter f, unsigned char value) {
+	uint8x16_t const v = vdupq_n_u8(value);
+	return compare16(vld1q_u8(cur), vld1q_u8(prev), f, v)
+	     | compare16(vld1q_u8(cur + 16), vld1q_u8(prev + 16), f, v) << 16;
+}
+
+#else
+
+uint32_t compare32(unsigned char const *cur, unsigned char const *prev,
+                   RamSearch::Filter f, unsigned char value) {
+	return compare32Scalar(cur, prev, f, value);
+}
+
+#endif
+
+typedef uint32_t (*Compare32)(unsigned char const *cur, unsigned char const *prev,
+                              RamSearch::Filter f, unsigned char value);
+
+template<Compare32 compare>
+void filterWords(uint32_t *words, unsigned char const *ram, unsigned char const *prev,
+                 std::size_t length, RamSearch::Filter f, unsigned char value) {
+	std::size_t const full = length / 32;
+	for (std::size_t w = 0; w < full; ++w) {
+		if (words[w])
+			words[w] &= compare(ram + w * 32, prev + w * 32, f, value);
+	}
+
+	if (length % 32) {
+		// HRAM is 127 bytes, read the tail through a padded copy.
+		unsigned char tail[32] = { 0 };
+		std::memcpy(tail, ram + full * 32, length % 32);
+		words[full] &= compare(tail, prev + full * 32, f, value);
+	}
+}
+
+} // anon namespace
+
+RamSearch::RamSearch(bool const useSimd)
+: useSimd_(useSimd)
+{
+	for (int a = 0; a < num_areas; ++a) {
+		areas_[a].offset = 0;
+		areas_[a].length = 0;
+	}
+}
+
+void RamSearch::reset(GB &gb) {
+	std::size_t size = 0;
+	for (int a = 0; a < num_areas; ++a) {
+		gb.memoryArea(areaIds[a], areas_[a].length);
+		areas_[a].offset = size;
+		size += roundUp32(areas_[a].length);
+	}
+
+	snapshot_.reset(size);
+	candidates_.reset(size / 32);
+	std::memset(snapshot_, 0, size);
+	for (int a = 0; a < num_areas; ++a) {
+		Area const &area = areas_[a];
+		std::size_t length = 0;
+		std::memcpy(snapshot_ + area.offset, gb.memoryArea(areaIds[a], length), area.length);
+
+		// the padding up to the next multiple of 32 is never a candidate.
+		uint32_t *const words = candidates_ + area.offset / 32;
+		std::size_t const full = area.length / 32;
+		for (std::size_t w = 0; w < full; ++w)
+			words[w] = 0xFFFFFFFF;
+		if (area.length % 32)
+			words[full] = (uint32_t(1) << area.length % 32) - 1;
+	}
+}
+
+void RamSearch::filter(GB &gb, Filter const f, unsigned const value) {
+	for (int a = 0; a < num_areas; ++a) {
+		Area const &area = areas_[a];
+		std::size_t length = 0;
+		unsigned char const *const ram = gb.memoryArea(areaIds[a], length);
+		if (length != area.length)
+			continue;
+
+		unsigned char *const prev = snapshot_ + area.offset;
+		uint32_t *const words = candidates_ + area.offset / 32;
+		if (useSimd_)
+			filterWords<compare32>(words, ram, prev, length, f, value);
+		else
+			filterWords<compare32Scalar>(words, ram, prev, length, f, value);
+
+		std::memcpy(prev, ram, length);
+	}
+}
+
+std::size_t RamSearch::count() const {
+	std::size_t n = 0;
+	for (std::size_t w = 0; w < candidates_.size(); ++w)
+		n += popCount(candidates_[w]);
+
+	return n;
+}
+
+std::size_t RamSearch::matches(Match *const out, std::size_t const max) const {
+	std::size_t n = 0;
+	for (int a = 0; a < num_areas; ++a) {
+		Area const &area = areas_[a];
+		uint32_t const *const words = candidates_ + area.offset / 32;
+		for (std::size_t w = 0; w < roundUp32(area.length) / 32; ++w) {
+			for (uint32_t bits = words[w]; bits; bits &= bits - 1) {
+				if (n == max)
+					return n;
+
+				std::size_t const offset = w * 32 + popCount((bits & -bits) - 1);
+				Match &m = out[n++];
+				m.area = areaIds[a];
+				m.value = snapshot_[area.offset + offset];
+				switch (m.area) {
+				case GB::WRAM:
+					m.bank = offset >> 12;
+					m.address = (m.bank ? 0xD000 : 0xC000) | (offset & 0xFFF);
+					break;
+				case GB::HRAM:
+					m.bank = 0;
+					m.address = 0xFF80 + offset;
+					break;
+				case GB::SRAM:
+					m.bank = offset >> 13;
+					m.address = 0xA000 | (offset & 0x1FFF);
+					break;
+				}
+			}
+		}
+	}
+
+	return n;
+}
+
+std::string RamSearch::gameSharkCode(Match const &m, unsigned const value) {
+	char code[9];
+	std::sprintf(code, "01%02X%02X%02X", value & 0xFF, m.address & 0xFF, m.address >> 8 & 0xFF);
+	return code;
+}
+
+bool RamSearch::simd() {
+#if defined(RAMSEARCH_SSE2) || defined(RAMSEARCH_NEON)
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,81 @@
+#ifndef RAMSEARCH_H
+#define RAMSEARCH_H
+
+#include "array.h"
+#include "uncopyable.h"
+#include <gambatte.h>
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+/**
+  * Cheat finder: narrows WRAM, HRAM and SRAM down to the bytes that behave
+  * like a value in the game, e.g. one that decreased every time a life was
+  * lost.
+  *
+  * reset() makes every byte a candidate and takes a snapshot of RAM. Every
+  * filter() pass keeps the candidates whose byte compares to the last
+  * snapshot as asked, and takes a new snapshot. Candidates are a bitset
+  * with a bit per byte, filtered 32 bytes at a time, with SSE2 or NEON when
+  * built for it, so a pass is quick enough to run between two frames.
+  */
+class RamSearch : Uncopyable {
+public:
+	enum Filter {
+		filter_equal,     /**< unchanged since the last snapshot */
+		filter_changed,
+		filter_increased,
+		filter_decreased,
+		filter_value      /**< equal to the value given to filter() */
+	};
+
+	struct Match {
+		gambatte::GB::MemoryArea area;
+		unsigned address; /**< where the byte shows up in the memory map */
+		unsigned bank;    /**< WRAM or SRAM bank, 0 for HRAM */
+		unsigned value;   /**< as of the last snapshot */
+	};
+
+	/**
+	  * With useSimd false the comparisons are done by the plain C++ loop even
+	  * when built with SSE2 or NEON, for checking the two against each other.
+	  */
+	explicit RamSearch(bool useSimd = true);
+
+	/** Starts over with every byte a candidate. Needed after every ROM load. */
+	void reset(gambatte::GB &gb);
+
+	void filter(gambatte::GB &gb, Filter f, unsigned value = 0);
+
+	/** Number of candidates left. */
+	std::size_t count() const;
+
+	/** Writes up to max of the candidates to out in address order. Returns how many were written. */
+	std::size_t matches(Match *out, std::size_t max) const;
+
+	/**
+	  * GameShark code writing value to the address of m, in the 01VVAAAA format
+	  * GB::setGameShark takes. The code writes to whichever bank is mapped at
+	  * the address, so for WRAM banks other than 1 and SRAM banks other than
+	  * the one in use it only holds while the game has that bank mapped.
+	  */
+	static std::string gameSharkCode(Match const &m, unsigned value);
+
+	/** True when filtering was built with SSE2 or NEON. */
+	static bool simd();
+
+private:
+	enum { num_areas = 3 };
+
+	struct Area {
+		std::size_t offset; /**< of the first byte in snapshot_, multiple of 32 */
+		std::size_t length;
+	};
+
+	bool const useSimd_;
+	Area areas_[num_areas];
+	Array<unsigned char> snapshot_;
+	Array<uint32_t> candidates_;
+};
+
+#endif
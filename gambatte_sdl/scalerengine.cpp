@@ -0,0 +1,736 @@
+#include "scalerengine.h"
+#include "ghostblend.h"
+#include <cstring>
+
+// SIMD kernels are picked at build time from what the compiler targets.
+// Define SCALER_NO_SIMD to force the plain C++ loops.
+#ifndef SCALER_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCALER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SCALER_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace {
+
+// Amounts of grid or scanline colour per pixel of the effect cell.
+unsigned char const dotmatrix2_amount[] = {
+	2, 0,
+	3, 2
+};
+
+unsigned char const dotmatrix3_amount[] = {
+	2, 0, 0,
+	2, 0, 0,
+	3, 2, 2
+};
+
+unsigned char const scan2_amount[] = {
+	0, 0,
+	1, 1
+};
+
+unsigned char const scan3_amount[] = {
+	0, 0, 0,
+	2, 2, 2,
+	5, 5, 5
+};
+
+ScalerEngine::Effect const dotmatrix2 = { 2, 2, 6, dotmatrix2_amount };
+ScalerEngine::Effect const dotmatrix3 = { 3, 3, 5, dotmatrix3_amount };
+ScalerEngine::Effect const scan2 = { 2, 2, 3, scan2_amount };
+ScalerEngine::Effect const scan3 = { 3, 3, 10, scan3_amount };
+
+#define S ScalerEngine
+ScalerEngine::Desc const descs[] = {
+	{ "1.5x Smooth",         160, 144, 240, 216, 2, 3, 2, 3, S::filter_bilinear, S::combine_nested, 0, false },
+	{ "Aspect 1.66x Fast",   160, 144, 266, 240, 3, 5, 3, 5, S::filter_area,     S::combine_nested, 0, false },
+	{ "Aspect 1.66x Smooth", 160, 144, 266, 240, 3, 5, 3, 5, S::filter_bilinear, S::combine_nested, 0, false },
+	{ "FullScreen Smooth",   160, 144, 320, 240, 1, 2, 3, 5, S::filter_bilinear, S::combine_nested, 0, false },
+	{ "1.5x IPU-2x",         160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, 0, false },
+	{ "1.5x DMG-2x",         160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, &dotmatrix2, true },
+	{ "1.5x Scan-2x",        160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, &scan2, false },
+	{ "Aspect IPU-2x",       160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, 0, false },
+	{ "Aspect DMG-2x",       160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, &dotmatrix2, true },
+	{ "Aspect Scan-2x",      160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, &scan2, false },
+	{ "FullScreen IPU-2x",   160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, 0, false },
+	{ "FullScreen DMG-2x",   160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, &dotmatrix2, true },
+	{ "FullScreen Scan-2x",  160, 144, 320, 288, 1, 2, 1, 2, S::filter_area, S::combine_nested, &scan2, false },
+	{ "1.5x DMG-3x",         160, 144, 480, 432, 1, 3, 1, 3, S::filter_area, S::combine_nested, &dotmatrix3, true },
+	{ "1.5x Scan-3x",        160, 144, 480, 432, 1, 3, 1, 3, S::filter_area, S::combine_nested, &scan3, false },
+	{ "Aspect DMG-3x",       160, 144, 480, 432, 1, 3, 1, 3, S::filter_area, S::combine_nested, &dotmatrix3, true },
+	{ "Aspect Scan-3x",      160, 144, 480, 432, 1, 3, 1, 3, S::filter_area, S::combine_nested, &scan3, false },
+	{ "FullScreen DMG-3x",   160, 144, 480, 432, 1, 3, 1, 3, S::filter_area, S::combine_nested, &dotmatrix3, true },
+	{ "FullScreen Scan-3x",  160, 144, 480, 432, 1, 3, 1, 3, S::filter_area, S::combine_nested, &scan3, false }
+};
+#undef S
+
+std::size_t const num_descs = sizeof descs / sizeof descs[0];
+
+enum { max_component = 0x3f };
+
+// Fills one tap per output pixel along an axis and returns the weight
+// denominator, which is the same for every tap. An output pixel that only
+// covers one source pixel, or whose second source pixel would be past the
+// edge, is a copy of its first one.
+unsigned makeTaps(unsigned short *i0, unsigned short *i1, uint16_t *w0, uint16_t *w1,
+                  unsigned dstLen, unsigned srcLen, unsigned nsrc, unsigned ndst,
+                  ScalerEngine::Filter filter)
+{
+	// a denominator of one would need a special case in the division
+	unsigned const scale = filter == ScalerEngine::filter_area && nsrc == 1 ? 2 : 1;
+	unsigned const den = (filter == ScalerEngine::filter_area ? nsrc : ndst) * scale;
+
+	for (unsigned x = 0; x < dstLen; ++x) {
+		unsigned const pos = x * nsrc;
+		unsigned a = pos / ndst;
+		unsigned wa = den;
+		unsigned wb = 0;
+		if (filter == ScalerEngine::filter_area) {
+			// output pixel covers [pos, pos + nsrc) in units of 1/ndst source pixel
+			unsigned const boundary = (a + 1) * ndst;
+			if (boundary < pos + nsrc) {
+				wa = (boundary - pos) * scale;
+				wb = den - wa;
+			}
+		} else {
+			wb = pos % ndst;
+			wa = den - wb;
+		}
+
+		if (a >= srcLen)
+			a = srcLen - 1;
+
+		unsigned b = a + 1;
+		if (wb == 0 || b >= srcLen) {
+			b = a;
+			wa = den;
+			wb = 0;
+		}
+
+		i0[x] = a;
+		i1[x] = b;
+		w0[x] = wa;
+		w1[x] = wb;
+	}
+
+	return den;
+}
+
+// Finds mul and shift so that (v * mul) >> (16 + shift) == v / den for all v <= vmax.
+ScalerEngine::Div makeDiv(unsigned den, unsigned vmax) {
+	ScalerEngine::Div best = { 0, 0, static_cast<unsigned char>(den) };
+	for (unsigned shift = 0; shift < 16; ++shift) {
+		unsigned long const mul = ((1ul << (16 + shift)) + den - 1) / den;
+		if (mul > 0xffff)
+			break;
+
+		bool exact = true;
+		for (unsigned v = 0; v <= vmax && exact; ++v)
+			exact = ((v * mul) >> (16 + shift)) == v / den;
+
+		if (exact) {
+			best.mul = mul;
+			best.shift = shift;
+		}
+	}
+
+	return best;
+}
+
+inline unsigned divide(unsigned v, ScalerEngine::Div const &d) {
+	return d.mul ? (v * d.mul) >> (16 + d.shift) : v;
+}
+
+inline unsigned blend565(unsigned a, unsigned b, unsigned w0, unsigned w1, ScalerEngine::Div const &d) {
+	unsigned const r = divide((a >> 11) * w0 + (b >> 11) * w1, d);
+	unsigned const g = divide((a >> 5 & 0x3f) * w0 + (b >> 5 & 0x3f) * w1, d);
+	unsigned const bl = divide((a & 0x1f) * w0 + (b & 0x1f) * w1, d);
+	return r << 11 | g << 5 | bl;
+}
+
+enum { lut_r = 0, lut_g = 32, lut_b = 96, lut_size = 128 };
+
+inline unsigned applyLut(uint16_t const *lut, unsigned p) {
+	return lut[lut_r + (p >> 11)] | lut[lut_g + (p >> 5 & 0x3f)] | lut[lut_b + (p & 0x1f)];
+}
+
+inline uint16_t const * source(uint16_t const *src, std::ptrdiff_t srcPitch, unsigned y,
+                               GhostBlend *ghost)
+{
+	return ghost ? ghost->row(src, srcPitch, y) : src + y * srcPitch;
+}
+
+void applyLutRow(uint16_t *dst, uint16_t const *src, std::size_t n, uint16_t const *lut) {
+	for (std::size_t i = 0; i < n; ++i)
+		dst[i] = applyLut(lut, src[i]);
+}
+
+// Integer ratio pixel replication. Output pixel k of every source pixel
+// comes from rows[k], which is either the source row or the source row with
+// the effect level of that column applied. The fixed ratio lets the compiler
+// unroll the inner loop.
+template<unsigned n>
+void replicateRow(uint16_t *dst, uint16_t const *const *rows, unsigned srcWidth) {
+	uint16_t const *r[n];
+	for (unsigned k = 0; k < n; ++k)
+		r[k] = rows[k];
+
+	for (unsigned x = 0; x < srcWidth; ++x, dst += n) {
+		for (unsigned k = 0; k < n; ++k)
+			dst[k] = r[k][x];
+	}
+}
+
+// Kernels. Lengths are multiples of 8 except for split, which reads
+// source rows, and pack, which writes output rows.
+
+#if defined(SCALER_SSE2)
+
+inline __m128i divide(__m128i v, ScalerEngine::Div const &d) {
+	return d.mul
+	     ? _mm_srl_epi16(_mm_mulhi_epu16(v, _mm_set1_epi16(d.mul)), _mm_cvtsi32_si128(d.shift))
+	     : v;
+}
+
+void split(uint16_t *r, uint16_t *g, uint16_t *b, uint16_t const *px, std::size_t n) {
+	__m128i const gmask = _mm_set1_epi16(0x3f);
+	__m128i const bmask = _mm_set1_epi16(0x1f);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i const p = _mm_loadu_si128(reinterpret_cast<__m128i const *>(px + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(r + i), _mm_srli_epi16(p, 11));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(g + i), _mm_and_si128(_mm_srli_epi16(p, 5), gmask));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(b + i), _mm_and_si128(p, bmask));
+	}
+
+	for (; i < n; ++i) {
+		r[i] = px[i] >> 11;
+		g[i] = px[i] >> 5 & 0x3f;
+		b[i] = px[i] & 0x1f;
+	}
+}
+
+void pack(uint16_t *px, uint16_t const *r, uint16_t const *g, uint16_t const *b, std::size_t n) {
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i const rv = _mm_loadu_si128(reinterpret_cast<__m128i const *>(r + i));
+		__m128i const gv = _mm_loadu_si128(reinterpret_cast<__m128i const *>(g + i));
+		__m128i const bv = _mm_loadu_si128(reinterpret_cast<__m128i const *>(b + i));
+		__m128i const p = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(rv, 11), _mm_slli_epi16(gv, 5)), bv);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(px + i), p);
+	}
+
+	for (; i < n; ++i)
+		px[i] = r[i] << 11 | g[i] << 5 | b[i];
+}
+
+// out = (a * w0 + b * w1) / den, per element weights
+void blendv(uint16_t *out, uint16_t const *a, uint16_t const *b,
+            uint16_t const *w0, uint16_t const *w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	for (std::size_t i = 0; i < n; i += 8) {
+		__m128i const av = _mm_loadu_si128(reinterpret_cast<__m128i const *>(a + i));
+		__m128i const bv = _mm_loadu_si128(reinterpret_cast<__m128i const *>(b + i));
+		__m128i const w0v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(w0 + i));
+		__m128i const w1v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(w1 + i));
+		__m128i const v = _mm_add_epi16(_mm_mullo_epi16(av, w0v), _mm_mullo_epi16(bv, w1v));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), divide(v, d));
+	}
+}
+
+// out = (a * w0 + b * w1) / den, same weights for every element
+void blendu(uint16_t *out, uint16_t const *a, uint16_t const *b,
+            unsigned w0, unsigned w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	__m128i const w0v = _mm_set1_epi16(w0);
+	__m128i const w1v = _mm_set1_epi16(w1);
+	for (std::size_t i = 0; i < n; i += 8) {
+		__m128i const av = _mm_loadu_si128(reinterpret_cast<__m128i const *>(a + i));
+		__m128i const bv = _mm_loadu_si128(reinterpret_cast<__m128i const *>(b + i));
+		__m128i const v = _mm_add_epi16(_mm_mullo_epi16(av, w0v), _mm_mullo_epi16(bv, w1v));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), divide(v, d));
+	}
+}
+
+// out = (a * w0 + c * w1) / den, per element weights, constant c
+void blendc(uint16_t *out, uint16_t const *a, unsigned c,
+            uint16_t const *w0, uint16_t const *w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	__m128i const cv = _mm_set1_epi16(c);
+	for (std::size_t i = 0; i < n; i += 8) {
+		__m128i const av = _mm_loadu_si128(reinterpret_cast<__m128i const *>(a + i));
+		__m128i const w0v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(w0 + i));
+		__m128i const w1v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(w1 + i));
+		__m128i const v = _mm_add_epi16(_mm_mullo_epi16(av, w0v), _mm_mullo_epi16(cv, w1v));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), divide(v, d));
+	}
+}
+
+#elif defined(SCALER_NEON)
+
+inline uint16x8_t divide(uint16x8_t v, ScalerEngine::Div const &d) {
+	if (!d.mul)
+		return v;
+
+	uint16x4_t const mul = vdup_n_u16(d.mul);
+	int32x4_t const shift = vdupq_n_s32(-(16 + d.shift));
+	uint32x4_t const lo = vshlq_u32(vmull_u16(vget_low_u16(v), mul), shift);
+	uint32x4_t const hi = vshlq_u32(vmull_u16(vget_high_u16(v), mul), shift);
+	return vcombine_u16(vmovn_u32(lo), vmovn_u32(hi));
+}
+
+void split(uint16_t *r, uint16_t *g, uint16_t *b, uint16_t const *px, std::size_t n) {
+	uint16x8_t const gmask = vdupq_n_u16(0x3f);
+	uint16x8_t const bmask = vdupq_n_u16(0x1f);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t const p = vld1q_u16(px + i);
+		vst1q_u16(r + i, vshrq_n_u16(p, 11));
+		vst1q_u16(g + i, vandq_u16(vshrq_n_u16(p, 5), gmask));
+		vst1q_u16(b + i, vandq_u16(p, bmask));
+	}
+
+	for (; i < n; ++i) {
+		r[i] = px[i] >> 11;
+		g[i] = px[i] >> 5 & 0x3f;
+		b[i] = px[i] & 0x1f;
+	}
+}
+
+void pack(uint16_t *px, uint16_t const *r, uint16_t const *g, uint16_t const *b, std::size_t n) {
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t const p = vorrq_u16(vorrq_u16(vshlq_n_u16(vld1q_u16(r + i), 11),
+		                                         vshlq_n_u16(vld1q_u16(g + i), 5)),
+		                               vld1q_u16(b + i));
+		vst1q_u16(px + i, p);
+	}
+
+	for (; i < n; ++i)
+		px[i] = r[i] << 11 | g[i] << 5 | b[i];
+}
+
+void blendv(uint16_t *out, uint16_t const *a, uint16_t const *b,
+            uint16_t const *w0, uint16_t const *w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	for (std::size_t i = 0; i < n; i += 8) {
+		uint16x8_t const v = vmlaq_u16(vmulq_u16(vld1q_u16(a + i), vld1q_u16(w0 + i)),
+		                               vld1q_u16(b + i), vld1q_u16(w1 + i));
+		vst1q_u16(out + i, divide(v, d));
+	}
+}
+
+void blendu(uint16_t *out, uint16_t const *a, uint16_t const *b,
+            unsigned w0, unsigned w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	uint16x8_t const w0v = vdupq_n_u16(w0);
+	uint16x8_t const w1v = vdupq_n_u16(w1);
+	for (std::size_t i = 0; i < n; i += 8) {
+		uint16x8_t const v = vmlaq_u16(vmulq_u16(vld1q_u16(a + i), w0v), vld1q_u16(b + i), w1v);
+		vst1q_u16(out + i, divide(v, d));
+	}
+}
+
+void blendc(uint16_t *out, uint16_t const *a, unsigned c,
+            uint16_t const *w0, uint16_t const *w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	uint16x8_t const cv = vdupq_n_u16(c);
+	for (std::size_t i = 0; i < n; i += 8) {
+		uint16x8_t const v = vmlaq_u16(vmulq_u16(vld1q_u16(a + i), vld1q_u16(w0 + i)),
+		                               cv, vld1q_u16(w1 + i));
+		vst1q_u16(out + i, divide(v, d));
+	}
+}
+
+#else
+
+void split(uint16_t *r, uint16_t *g, uint16_t *b, uint16_t const *px, std::size_t n) {
+	for (std::size_t i = 0; i < n; ++i) {
+		r[i] = px[i] >> 11;
+		g[i] = px[i] >> 5 & 0x3f;
+		b[i] = px[i] & 0x1f;
+	}
+}
+
+void pack(uint16_t *px, uint16_t const *r, uint16_t const *g, uint16_t const *b, std::size_t n) {
+	for (std::size_t i = 0; i < n; ++i)
+		px[i] = r[i] << 11 | g[i] << 5 | b[i];
+}
+
+void blendv(uint16_t *out, uint16_t const *a, uint16_t const *b,
+            uint16_t const *w0, uint16_t const *w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		out[i] = divide(a[i] * w0[i] + b[i] * w1[i], d);
+}
+
+void blendu(uint16_t *out, uint16_t const *a, uint16_t const *b,
+            unsigned w0, unsigned w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		out[i] = divide(a[i] * w0 + b[i] * w1, d);
+}
+
+void blendc(uint16_t *out, uint16_t const *a, unsigned c,
+            uint16_t const *w0, uint16_t const *w1, std::size_t n, ScalerEngine::Div const &d)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		out[i] = divide(a[i] * w0[i] + c * w1[i], d);
+}
+
+#endif
+
+} // anon namespace
+
+ScalerEngine::Desc const * ScalerEngine::find(char const *name) {
+	for (std::size_t i = 0; i < num_descs; ++i) {
+		if (!std::strcmp(descs[i].name, name))
+			return descs + i;
+	}
+
+	return 0;
+}
+
+std::size_t ScalerEngine::num() {
+	return num_descs;
+}
+
+ScalerEngine::Desc const & ScalerEngine::get(std::size_t n) {
+	return descs[n];
+}
+
+bool ScalerEngine::simd() {
+#if defined(SCALER_SSE2) || defined(SCALER_NEON)
+	return true;
+#else
+	return false;
+#endif
+}
+
+ScalerEngine::ScalerEngine()
+: desc_(0)
+, stride_(0)
+, xden_(0)
+, yden_(0)
+, effLutColor_(0)
+, effLutValid_(false)
+, xcopy_(false)
+{
+	hrowKey_[0] = hrowKey_[1] = -1;
+	hdiv_.mul = vdiv_.mul = ediv_.mul = 0;
+	hdiv_.shift = vdiv_.shift = ediv_.shift = 0;
+	hdiv_.den = vdiv_.den = ediv_.den = 0;
+}
+
+void ScalerEngine::setup(Desc const &d) {
+	unsigned const w = d.dstWidth;
+	unsigned const h = d.dstHeight;
+	desc_ = &d;
+	stride_ = (w + 7) & ~7u;
+
+	coli0_.reset(stride_);
+	coli1_.reset(stride_);
+	colw0_.reset(stride_);
+	colw1_.reset(stride_);
+	xden_ = makeTaps(coli0_, coli1_, colw0_, colw1_, w, d.srcWidth, d.xsrc, d.xdst, d.filter);
+	xcopy_ = true;
+	for (unsigned x = 0; x < w; ++x)
+		xcopy_ &= colw1_[x] == 0;
+
+	for (std::size_t x = w; x < stride_; ++x) {
+		coli0_[x] = coli1_[x] = 0;
+		colw0_[x] = xden_;
+		colw1_[x] = 0;
+	}
+
+	Array<unsigned short> i0(h), i1(h);
+	Array<uint16_t> w0(h), w1(h);
+	yden_ = makeTaps(i0, i1, w0, w1, h, d.srcHeight, d.ysrc, d.ydst, d.filter);
+	rowTaps_.reset(h);
+	for (unsigned y = 0; y < h; ++y) {
+		rowTaps_[y].i0 = i0[y];
+		rowTaps_[y].i1 = i1[y];
+		rowTaps_[y].w0 = w0[y];
+		rowTaps_[y].w1 = w1[y];
+	}
+
+	if (d.combine == combine_nested) {
+		hdiv_ = makeDiv(xden_, max_component * xden_);
+		vdiv_ = makeDiv(yden_, max_component * yden_);
+	} else {
+		hdiv_.mul = 0;
+		vdiv_ = makeDiv(xden_ * yden_, max_component * xden_ * yden_);
+	}
+
+	Effect const *const e = d.effect;
+	effLutValid_ = false;
+	if (e) {
+		unsigned const scale = e->den == 1 ? 2 : 1;
+		unsigned const den = e->den * scale;
+		// level 0 is always no effect, so that those pixels can skip the lookup
+		unsigned numLevels = 1;
+		effw0_.reset(stride_ * e->height);
+		effw1_.reset(stride_ * e->height);
+		effLevel_.reset(stride_ * e->height);
+		effLevelAmount_.reset(e->width * e->height + 1);
+		effLevelAmount_[0] = 0;
+		effPhaseActive_.reset(e->height);
+		for (unsigned p = 0; p < e->height; ++p) {
+			effPhaseActive_[p] = false;
+			for (std::size_t x = 0; x < stride_; ++x) {
+				unsigned const amount = e->amount[p * e->width + x % e->width] * scale;
+				unsigned level = 0;
+				while (level < numLevels && effLevelAmount_[level] != amount)
+					++level;
+				if (level == numLevels)
+					effLevelAmount_[numLevels++] = amount;
+
+				effw0_[p * stride_ + x] = den - amount;
+				effw1_[p * stride_ + x] = amount;
+				effLevel_[p * stride_ + x] = level;
+				if (x < w && amount)
+					effPhaseActive_[p] = true;
+			}
+		}
+
+		ediv_ = makeDiv(den, max_component * den);
+		effLut_.reset(numLevels * lut_size);
+	}
+
+	sameAsPrev_.reset(h);
+	for (unsigned y = 0; y < h; ++y) {
+		bool same = y > 0
+		         && rowTaps_[y].i0 == rowTaps_[y - 1].i0 && rowTaps_[y].i1 == rowTaps_[y - 1].i1
+		         && rowTaps_[y].w0 == rowTaps_[y - 1].w0 && rowTaps_[y].w1 == rowTaps_[y - 1].w1;
+		if (same && e) {
+			unsigned const p = y % e->height;
+			unsigned const pp = (y - 1) % e->height;
+			same = std::memcmp(e->amount + p * e->width, e->amount + pp * e->width, e->width) == 0;
+		}
+
+		sameAsPrev_[y] = same;
+	}
+
+	gatherA_.reset(stride_);
+	gatherB_.reset(stride_);
+	planesA_.reset(stride_ * 3);
+	planesB_.reset(stride_ * 3);
+	hrows_.reset(stride_ * 3 * num_hrows);
+	out_.reset(stride_ * 3);
+}
+
+// Per effect level, one table per channel mapping the channel value to the
+// blended and shifted channel value, so that an effect costs three lookups.
+void ScalerEngine::updateEffectLut(uint16_t const color) {
+	if (effLutValid_ && effLutColor_ == color)
+		return;
+
+	unsigned const den = ediv_.den;
+	unsigned const cr = color >> 11, cg = color >> 5 & 0x3f, cb = color & 0x1f;
+	for (std::size_t l = 0; l < effLut_.size() / lut_size; ++l) {
+		unsigned const amount = effLevelAmount_[l];
+		uint16_t *const lut = effLut_ + l * lut_size;
+		for (unsigned v = 0; v < 32; ++v) {
+			lut[lut_r + v] = divide(v * (den - amount) + cr * amount, ediv_) << 11;
+			lut[lut_b + v] = divide(v * (den - amount) + cb * amount, ediv_);
+		}
+		for (unsigned v = 0; v < 64; ++v)
+			lut[lut_g + v] = divide(v * (den - amount) + cg * amount, ediv_) << 5;
+	}
+
+	effLutColor_ = color;
+	effLutValid_ = true;
+}
+
+int ScalerEngine::hrowSlot(int const y, int const keep) {
+	for (int i = 0; i < num_hrows; ++i) {
+		if (hrowKey_[i] == y)
+			return i;
+	}
+
+	int const slot = hrowKey_[0] == keep ? 1 : 0;
+	hrowKey_[slot] = -1 - slot;
+	return slot;
+}
+
+// Returns the horizontally filtered R, G and B planes of source row y,
+// filtering it into whichever cache slot does not hold row keep.
+uint16_t const * ScalerEngine::hrowPlanar(uint16_t const *srcRow, int const y, int const keep) {
+	int const slot = hrowSlot(y, keep);
+	uint16_t *const r = hrows_ + slot * stride_ * 3;
+	if (hrowKey_[slot] == y)
+		return r;
+
+	uint16_t *const g = r + stride_;
+	uint16_t *const b = g + stride_;
+	hrowKey_[slot] = y;
+
+	for (std::size_t x = 0; x < stride_; ++x)
+		gatherA_[x] = srcRow[coli0_[x]];
+
+	if (xcopy_ && desc_->combine == combine_nested) {
+		split(r, g, b, gatherA_, stride_);
+		return r;
+	}
+
+	for (std::size_t x = 0; x < stride_; ++x)
+		gatherB_[x] = srcRow[coli1_[x]];
+
+	split(planesA_, planesA_ + stride_, planesA_ + stride_ * 2, gatherA_, stride_);
+	split(planesB_, planesB_ + stride_, planesB_ + stride_ * 2, gatherB_, stride_);
+	for (int c = 0; c < 3; ++c) {
+		blendv(r + c * stride_, planesA_ + c * stride_, planesB_ + c * stride_,
+		       colw0_, colw1_, stride_, hdiv_);
+	}
+
+	return r;
+}
+
+// Returns source row y horizontally filtered to packed pixels. Nested only.
+uint16_t const * ScalerEngine::hrowPacked(uint16_t const *srcRow, int const y, int const keep) {
+	int const slot = hrowSlot(y, keep);
+	uint16_t *const row = hrows_ + slot * stride_ * 3;
+	if (hrowKey_[slot] == y)
+		return row;
+
+	hrowKey_[slot] = y;
+	unsigned const width = desc_->dstWidth;
+	unsigned short const *const i0 = coli0_, *const i1 = coli1_;
+	uint16_t const *const w0 = colw0_, *const w1 = colw1_;
+	Div const hdiv = hdiv_;
+	for (unsigned x = 0; x < width; ++x) {
+		unsigned const a = srcRow[i0[x]];
+		row[x] = w1[x] ? blend565(a, srcRow[i1[x]], w0[x], w1[x], hdiv) : a;
+	}
+
+	return row;
+}
+
+void ScalerEngine::scale(uint16_t *dst, std::ptrdiff_t dstPitch,
+                         uint16_t const *src, std::ptrdiff_t srcPitch, uint16_t gridColor,
+                         GhostBlend *ghost, unsigned char const *const srcRowsChanged)
+{
+	if (!desc_)
+		return;
+
+	if (ghost && (ghost->width() != desc_->srcWidth || ghost->height() != desc_->srcHeight))
+		ghost = 0;
+	if (ghost)
+		ghost->beginFrame();
+
+	Desc const &d = *desc_;
+	Effect const *const e = d.effect;
+	uint16_t const color = d.gridColor ? gridColor : 0;
+	unsigned const ecolor[3] = { unsigned(color >> 11), unsigned(color >> 5 & 0x3f), unsigned(color & 0x1f) };
+	bool const nested = d.combine == combine_nested;
+	hrowKey_[0] = hrowKey_[1] = -1;
+	if (e)
+		updateEffectLut(color);
+
+	// locals, since stores through dst could alias the tables as far as the
+	// compiler knows.
+	unsigned const width = d.dstWidth;
+	unsigned short const *const coli0 = coli0_;
+	uint16_t const *const lut = effLut_;
+	for (unsigned y = 0; y < d.dstHeight; ++y, dst += dstPitch) {
+		RowTap const t = rowTaps_[y];
+		if (srcRowsChanged && !srcRowsChanged[t.i0] && !(t.w1 && srcRowsChanged[t.i1]))
+			continue;
+
+		if (sameAsPrev_[y]) {
+			std::memcpy(dst, dst - dstPitch, width * sizeof *dst);
+			continue;
+		}
+
+		std::size_t const phase = e ? y % e->height : 0;
+		bool const effect = e && effPhaseActive_[phase];
+		unsigned char const *const level = effect ? effLevel_ + phase * stride_ : 0;
+		if (nested && xcopy_ && !t.w1) {
+			// pixel replication, plus effect
+			uint16_t const *const s = source(src, srcPitch, t.i0, ghost);
+			bool const whole = d.xsrc == 1 && width == d.srcWidth * d.xdst
+			                && (d.xdst == 2 || d.xdst == 3)
+			                && (!effect || e->width == d.xdst);
+			if (whole) {
+				// apply each level in the effect cell once per source pixel
+				uint16_t const *rows[3] = { s, s, s };
+				for (unsigned k = 0; effect && k < d.xdst; ++k) {
+					if (level[k] && k > 0 && level[k] == level[k - 1]) {
+						rows[k] = rows[k - 1];
+					} else if (level[k]) {
+						uint16_t *const tmp = planesA_ + k * stride_;
+						applyLutRow(tmp, s, d.srcWidth, lut + level[k] * lut_size);
+						rows[k] = tmp;
+					}
+				}
+
+				if (d.xdst == 2)
+					replicateRow<2>(dst, rows, d.srcWidth);
+				else
+					replicateRow<3>(dst, rows, d.srcWidth);
+			} else if (effect) {
+				for (unsigned x = 0; x < width; ++x) {
+					unsigned const px = s[coli0[x]];
+					unsigned const l = level[x];
+					dst[x] = l ? applyLut(lut + l * lut_size, px) : px;
+				}
+			} else {
+				for (unsigned x = 0; x < width; ++x)
+					dst[x] = s[coli0[x]];
+			}
+
+			continue;
+		}
+
+#if !defined(SCALER_SSE2) && !defined(SCALER_NEON)
+		if (nested) {
+			// without SIMD, keeping the pixels packed is cheaper than splitting
+			// them into planes.
+			uint16_t const *const h0 = hrowPacked(source(src, srcPitch, t.i0, ghost), t.i0, t.i1);
+			if (t.w1) {
+				uint16_t const *const h1 = hrowPacked(source(src, srcPitch, t.i1, ghost), t.i1, t.i0);
+				Div const vdiv = vdiv_;
+				for (unsigned x = 0; x < width; ++x)
+					dst[x] = blend565(h0[x], h1[x], t.w0, t.w1, vdiv);
+			} else
+				std::memcpy(dst, h0, width * sizeof *dst);
+
+			if (effect) {
+				for (unsigned x = 0; x < width; ++x) {
+					if (unsigned const l = level[x])
+						dst[x] = applyLut(lut + l * lut_size, dst[x]);
+				}
+			}
+
+			continue;
+		}
+#endif
+
+		uint16_t const *planes = hrowPlanar(source(src, srcPitch, t.i0, ghost), t.i0, t.i1);
+		if (t.w1 || !nested) {
+			uint16_t const *const h1 = t.w1
+			                         ? hrowPlanar(source(src, srcPitch, t.i1, ghost), t.i1, t.i0)
+			                         : planes;
+			blendu(out_, planes, h1, t.w0, t.w1, stride_ * 3, vdiv_);
+			planes = out_;
+		}
+
+		if (effect) {
+			for (int c = 0; c < 3; ++c) {
+				blendc(out_ + c * stride_, planes + c * stride_, ecolor[c],
+				       effw0_ + phase * stride_, effw1_ + phase * stride_, stride_, ediv_);
+			}
+
+			planes = out_;
+		}
+
+		pack(dst, planes, planes + stride_, planes + stride_ * 2, d.dstWidth);
+	}
+
+	if (ghost)
+		ghost->blendFrame(src, srcPitch);
+}
@@ -0,0 +1,130 @@
+#ifndef SCALERENGINE_H
+#define SCALERENGINE_H
+
+#include "array.h"
+#include "uncopyable.h"
+#include <stdint.h>
+#include <cstddef>
+
+class GhostBlend;
+
+/**
+  * Table driven RGB565 upscaler.
+  *
+  * setup() works out everything that depends on the scale ratio, filter and
+  * effect once: which one or two source pixels every output column and row
+  * is made of and with which weights, and how much of the effect colour goes
+  * into every pixel of the effect cell. scale() then only walks the tables.
+  * Horizontally filtered source rows are cached, so each source row is
+  * filtered once per frame however many output rows use it, and output rows
+  * that would come out identical to the previous one are copied.
+  *
+  * Blending is done per channel with truncating integer division, the same
+  * arithmetic as the WeightN_M macros in scaler.c, so a Desc that describes
+  * one of the hand written scalers there reproduces its output exactly.
+  */
+class ScalerEngine : Uncopyable {
+public:
+	enum Filter {
+		/** Box filter. Replicates pixels at integer ratios ("Fast" scalers). */
+		filter_area,
+		/** Linear interpolation ("Smooth" scalers). */
+		filter_bilinear
+	};
+
+	enum Combine {
+		/** Vertical blend of horizontally blended and truncated pixels. */
+		combine_nested,
+		/** One truncation over all four source pixels. */
+		combine_joint
+	};
+
+	struct Effect {
+		/** Cell size in output pixels. The cell repeats over the whole image. */
+		unsigned char width, height;
+		unsigned char den;
+		/** width * height amounts of effect colour, out of den, row by row. */
+		unsigned char const *amount;
+	};
+
+	struct Desc {
+		char const *name;
+		unsigned short srcWidth, srcHeight;
+		unsigned short dstWidth, dstHeight;
+		/** Scale ratio per axis as source pixels : output pixels. */
+		unsigned char xsrc, xdst, ysrc, ydst;
+		Filter filter;
+		Combine combine;
+		Effect const *effect;
+		/** Effect colour is the grid colour passed to scale() rather than black. */
+		bool gridColor;
+	};
+
+	/** Looks up one of the scalers offered in the menu by name. Returns 0 if not table driven. */
+	static Desc const * find(char const *name);
+	static std::size_t num();
+	static Desc const & get(std::size_t n);
+
+	ScalerEngine();
+	void setup(Desc const &desc);
+	Desc const * desc() const { return desc_; }
+
+	/**
+	  * Scales a srcWidth x srcHeight image to dstWidth x dstHeight.
+	  * Pitches are in pixels. With a ghost of the source size, each source
+	  * row is blended into its history right before it is first read and
+	  * the history is scaled instead. With srcRowsChanged, one flag per
+	  * source row, only the output rows made of a flagged source row are
+	  * written and the rest of dst is left as it is.
+	  */
+	void scale(uint16_t *dst, std::ptrdiff_t dstPitch,
+	           uint16_t const *src, std::ptrdiff_t srcPitch, uint16_t gridColor,
+	           GhostBlend *ghost = 0, unsigned char const *srcRowsChanged = 0);
+
+	/** True when the blend kernels were built with SSE2 or NEON. */
+	static bool simd();
+
+	/** Magic number division, exact for every dividend the tables can produce. */
+	struct Div {
+		uint16_t mul;
+		unsigned char shift;
+		unsigned char den;
+	};
+
+private:
+	struct RowTap {
+		unsigned short i0, i1;
+		unsigned short w0, w1;
+	};
+
+	enum { num_hrows = 2 };
+
+	Desc const *desc_;
+	std::size_t stride_;
+	Array<unsigned short> coli0_, coli1_;
+	Array<uint16_t> colw0_, colw1_;
+	Array<RowTap> rowTaps_;
+	Array<unsigned char> sameAsPrev_;
+	Array<uint16_t> effw0_, effw1_;
+	Array<unsigned char> effLevel_;
+	Array<unsigned char> effPhaseActive_;
+	Array<uint16_t> effLut_;
+	Array<unsigned char> effLevelAmount_;
+	Array<uint16_t> gatherA_, gatherB_;
+	Array<uint16_t> planesA_, planesB_;
+	Array<uint16_t> hrows_;
+	Array<uint16_t> out_;
+	int hrowKey_[num_hrows];
+	unsigned xden_, yden_;
+	Div hdiv_, vdiv_, ediv_;
+	uint16_t effLutColor_;
+	bool effLutValid_;
+	bool xcopy_;
+
+	int hrowSlot(int y, int keep);
+	uint16_t const * hrowPlanar(uint16_t const *srcRow, int y, int keep);
+	uint16_t const * hrowPacked(uint16_t const *srcRow, int y, int keep);
+	void updateEffectLut(uint16_t color);
+};
+
+#endif
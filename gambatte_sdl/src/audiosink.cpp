@@ -17,6 +17,7 @@
 //
 
 #include "audiosink.h"
+#include "trace.h"
 #include <SDL_thread.h>
 #include <cstdio>
 #include "../menu.h"
@@ -100,26 +101,19 @@ static int openAudio(long srate, std::size_t samples,
     return 0;
 }
 
-class LockGuard {
-public:
-	explicit LockGuard(SDL_mutex *m) : m_(m) { SDL_mutexP(m); }
-private:
-	struct LockDeleter { static void del(SDL_mutex *m) { SDL_mutexV(m); } };
-	scoped_ptr<SDL_mutex, LockDeleter> const m_;
-};
-
 } // anon ns
 
 struct AudioSink::SdlDeleter {
-	static void del(SDL_mutex *m) { SDL_DestroyMutex(m); }
-	static void del(SDL_cond *c) { SDL_DestroyCond(c); }
+	static void del(SDL_sem *s) { SDL_DestroySemaphore(s); }
 };
 
 AudioSink::AudioSink(long const srate, int const latency, int const periods)
 : rbuf_(nearestPowerOf2(srate * latency / ((periods + 1) * 1000)) * periods * 2)
 , rateEst_(srate, rbuf_.size() / periods)
-, mut_(SDL_CreateMutex())
-, bufReadyCond_(SDL_CreateCond())
+, rate_(rateEst_.result())
+, underruns_(0)
+, overruns_(0)
+, bufReadySem_(SDL_CreateSemaphore(0))
 , failed_(openAudio(srate, rbuf_.size() / 2 / periods, fillBuffer, this) < 0)
 {
 	rbuf_.fill(0);
@@ -132,23 +126,33 @@ AudioSink::~AudioSink() {
 
 AudioSink::Status AudioSink::write(Sint16 const *inBuf, std::size_t samples) {
 	if (failed_)
-		return Status(rbuf_.size() / 2, 0, rateEst_.result());
-
-
-	LockGuard lock(mut_.get());
-	Status const status(rbuf_.used() / 2, rbuf_.avail() / 2, rateEst_.result());
-
-	for (std::size_t avail; (avail = rbuf_.avail() / 2) < samples;) {
-		rbuf_.write(inBuf, avail * 2);
-		inBuf += avail * 2;
-		samples -= avail;
-		SDL_CondWait(bufReadyCond_.get(), mut_.get());
+		return Status(rbuf_.size() / 2, 0, rate_.load(std::memory_order_relaxed));
+
+	Status const status(rbuf_.used() / 2, rbuf_.avail() / 2, rate_.load(std::memory_order_relaxed));
+
+	std::size_t avail = rbuf_.avail() / 2;
+	if (avail < samples) {
+		overruns_.fetch_add(1, std::memory_order_relaxed);
+
+		do {
+			rbuf_.write(inBuf, avail * 2);
+			inBuf += avail * 2;
+			samples -= avail;
+			// posted by read() after it has consumed data. a stale post only
+			// costs an extra lap around this loop.
+			TRACE_BEGIN("audio wait");
+			SDL_SemWait(bufReadySem_.get());
+			TRACE_END("audio wait");
+		} while ((avail = rbuf_.avail() / 2) < samples);
 	}
 
 	rbuf_.write(inBuf, samples * 2);
 
 	if((menuin < -1) || (menuin >= 128)){ //Mute the sound of the last 3 frames before entering the menu, so the sound buffer is always clean when exiting the menu.
+		// fill() moves the read position too, so keep the callback out while it runs.
+		SDL_LockAudio();
 		rbuf_.fill(0);
+		SDL_UnlockAudio();
 	}
 	return status;
 }
@@ -157,8 +161,14 @@ void AudioSink::read(Uint8 *const stream, std::size_t const len) {
 	if (failed_)
 		return;
 
-	LockGuard lock(mut_.get());
-	rbuf_.read(reinterpret_cast<Sint16 *>(stream), std::min(len / 2, rbuf_.used()));
+	std::size_t const used = rbuf_.used();
+	if (used < len / 2)
+		underruns_.fetch_add(1, std::memory_order_relaxed);
+
+	rbuf_.read(reinterpret_cast<Sint16 *>(stream), std::min(len / 2, used));
 	rateEst_.feed(len / 4);
-	SDL_CondSignal(bufReadyCond_.get());
+	rate_.store(rateEst_.result(), std::memory_order_relaxed);
+
+	if (SDL_SemValue(bufReadySem_.get()) == 0)
+		SDL_SemPost(bufReadySem_.get());
 }
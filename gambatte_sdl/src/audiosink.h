@@ -19,10 +19,11 @@
 #ifndef AUDIOSINK_H
 #define AUDIOSINK_H
 
-#include "ringbuffer.h"
 #include "rateest.h"
 #include "scoped_ptr.h"
+#include "spscringbuffer.h"
 #include <SDL.h>
+#include <atomic>
 #include <cstddef>
 
 class AudioSink {
@@ -42,13 +43,21 @@ public:
 	~AudioSink();
 	Status write(Sint16 const *inBuf, std::size_t samples);
 
+	/** Number of SDL callbacks that found less data than requested. */
+	unsigned long underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+	/** Number of writes that found the buffer full and had to wait. */
+	unsigned long overruns() const { return overruns_.load(std::memory_order_relaxed); }
+
 private:
 	struct SdlDeleter;
 
-	RingBuffer<Sint16> rbuf_;
-	RateEst rateEst_;
-	scoped_ptr<SDL_mutex, SdlDeleter> const mut_;
-	scoped_ptr<SDL_cond, SdlDeleter> const bufReadyCond_;
+	SpscRingBuffer<Sint16> rbuf_;
+	RateEst rateEst_; // only touched by the audio thread
+	std::atomic<long> rate_;
+	std::atomic<unsigned long> underruns_;
+	std::atomic<unsigned long> overruns_;
+	scoped_ptr<SDL_sem, SdlDeleter> const bufReadySem_;
 	bool const failed_;
 
 	static void fillBuffer(void *data, Uint8 *stream, int len) {
@@ -20,21 +20,54 @@
 #include "videolink/rgb32conv.h"
 #include "videolink/vfilterinfo.h"
 #include "videolink/videolink.h"
+#include <SDL_thread.h>
+#include <cstdio>
+#include <cstring>
 
 BlitterWrapper::BlitterWrapper(VfilterInfo const &vfinfo, int scale, bool yuv, bool full)
 : blitter_(vfinfo.outWidth, vfinfo.outHeight, scale, yuv, full)
 , cconvert_(Rgb32Conv::create(static_cast<Rgb32Conv::PixelFormat>(blitter_.inBuffer().format),
                               vfinfo.outWidth, vfinfo.outHeight))
 , vfilter_(vfinfo.create())
+, back_(0)
+, front_(1)
+, middle_(2)
+, handedOver_(0)
+, presented_(0)
+, quit_(false)
+, frameReady_(0)
+, presentReady_(0)
+, presentThread_(0)
 {
+	for (int i = 0; i < num_frame_bufs; ++i)
+		hashed_[i] = false;
 }
 
 BlitterWrapper::~BlitterWrapper() {
+	if (presentThread_) {
+		quit_ = true;
+		SDL_SemPost(frameReady_);
+		SDL_SemPost(presentReady_);
+		SDL_WaitThread(presentThread_, 0);
+		SDL_DestroySemaphore(frameReady_);
+		SDL_DestroySemaphore(presentReady_);
+	}
+}
+
+gambatte::uint_least32_t * BlitterWrapper::frameBuf(int const i) const {
+	return frameBufs_ + std::size_t(i) * VfilterInfo::in_width * VfilterInfo::in_height;
+}
+
+gambatte::uint_least64_t * BlitterWrapper::frameHashes(int const i) const {
+	return frameHashes_ + std::size_t(i) * VfilterInfo::in_height;
 }
 
 BlitterWrapper::Buf BlitterWrapper::inBuf() const {
 	Buf buf;
-	if (VideoLink *const gblink = vfilter_ ? vfilter_.get() : cconvert_.get()) {
+	if (presentThread_) {
+		buf.pixels = frameBuf(back_);
+		buf.pitch = VfilterInfo::in_width;
+	} else if (VideoLink *const gblink = vfilter_ ? vfilter_.get() : cconvert_.get()) {
 		buf.pixels = static_cast<gambatte::uint_least32_t *>(gblink->inBuf());
 		buf.pitch  = gblink->inPitch();
 	} else {
@@ -46,7 +79,7 @@ BlitterWrapper::Buf BlitterWrapper::inBuf() const {
 	return buf;
 }
 
-void BlitterWrapper::draw() {
+void BlitterWrapper::convert() {
 	SdlBlitter::PixelBuffer const &pb = blitter_.inBuffer();
 	if (pb.pixels) {
 		if (vfilter_) {
@@ -56,6 +89,113 @@ void BlitterWrapper::draw() {
 		if (cconvert_)
 			cconvert_->draw(pb.pixels, pb.pitch);
 	}
+}
+
+void BlitterWrapper::drawNow(gambatte::uint_least64_t const *const lineHashes) {
+	// a vfilter resizes the picture, so its lines are not the frame's lines.
+	if (blitter_.setLineHashes(vfilter_ ? 0 : lineHashes))
+		convert();
 
 	blitter_.draw();
 }
+
+void BlitterWrapper::draw(gambatte::uint_least64_t const *const lineHashes) {
+	if (!presentThread_)
+		return drawNow(lineHashes);
+
+	hashed_[back_] = lineHashes;
+	if (lineHashes)
+		std::memcpy(frameHashes(back_), lineHashes, VfilterInfo::in_height * sizeof *lineHashes);
+
+	back_ = middle_.exchange(back_ | frame_buf_fresh) & ~frame_buf_fresh;
+	++handedOver_;
+	SDL_SemPost(frameReady_);
+}
+
+void BlitterWrapper::present() {
+	if (presentThread_)
+		SDL_SemPost(presentReady_);
+	else
+		blitter_.present();
+}
+
+void BlitterWrapper::startPresentThread() {
+	if (presentThread_)
+		return;
+
+	// the emulator may be in the middle of a frame in the current buffer.
+	Buf const cur = inBuf();
+	frameBufs_.reset(std::size_t(num_frame_bufs) * VfilterInfo::in_width * VfilterInfo::in_height);
+	frameHashes_.reset(std::size_t(num_frame_bufs) * VfilterInfo::in_height);
+	for (int i = 0; i < num_frame_bufs; ++i) {
+		for (int y = 0; y < VfilterInfo::in_height; ++y) {
+			std::memcpy(frameBuf(i) + y * VfilterInfo::in_width, cur.pixels + y * cur.pitch,
+			            VfilterInfo::in_width * sizeof *cur.pixels);
+		}
+	}
+
+	frameReady_ = SDL_CreateSemaphore(0);
+	presentReady_ = SDL_CreateSemaphore(0);
+	presentThread_ = SDL_CreateThread(runPresentThread, this);
+	if (!presentThread_) {
+		std::fprintf(stderr, "Could not start presentation thread: %s\n", SDL_GetError());
+		SDL_DestroySemaphore(frameReady_);
+		SDL_DestroySemaphore(presentReady_);
+		frameReady_ = presentReady_ = 0;
+	}
+}
+
+void BlitterWrapper::sync() {
+	while (presentThread_ && presented_ != handedOver_)
+		SDL_Delay(1);
+}
+
+int BlitterWrapper::runPresentThread(void *data) {
+	static_cast<BlitterWrapper *>(data)->presentLoop();
+	return 0;
+}
+
+void BlitterWrapper::presentLoop() {
+	for (;;) {
+		SDL_SemWait(frameReady_);
+		if (quit_)
+			return;
+
+		// nothing new if the emulation thread handed over several frames while
+		// we were busy; we already took the latest one of them.
+		bool const fresh = middle_.load() & frame_buf_fresh;
+		if (fresh) {
+			front_ = middle_.exchange(front_) & ~frame_buf_fresh;
+
+			gambatte::uint_least64_t const *const lineHashes =
+				hashed_[front_] && !vfilter_ ? frameHashes(front_) : 0;
+			if (blitter_.setLineHashes(lineHashes)) {
+				Buf dst;
+				if (VideoLink *const gblink = vfilter_ ? vfilter_.get() : cconvert_.get()) {
+					dst.pixels = static_cast<gambatte::uint_least32_t *>(gblink->inBuf());
+					dst.pitch  = gblink->inPitch();
+				} else {
+					SdlBlitter::PixelBuffer const &pxbuf = blitter_.inBuffer();
+					dst.pixels = static_cast<gambatte::uint_least32_t *>(pxbuf.pixels);
+					dst.pitch = pxbuf.pitch;
+				}
+
+				gambatte::uint_least32_t const *const src = frameBuf(front_);
+				for (int y = 0; y < VfilterInfo::in_height; ++y) {
+					std::memcpy(dst.pixels + y * dst.pitch, src + y * VfilterInfo::in_width,
+					            VfilterInfo::in_width * sizeof *src);
+				}
+
+				convert();
+			}
+
+			blitter_.draw();
+		}
+
+		SDL_SemWait(presentReady_);
+		if (fresh)
+			blitter_.present();
+
+		++presented_;
+	}
+}
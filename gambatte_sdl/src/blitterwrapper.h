@@ -19,9 +19,11 @@
 #ifndef BLITTERWRAPPER_H
 #define BLITTERWRAPPER_H
 
+#include "array.h"
 #include "gbint.h"
 #include "scoped_ptr.h"
 #include "sdlblitter.h"
+#include <atomic>
 
 class VideoLink;
 struct VfilterInfo;
@@ -33,8 +35,30 @@ public:
 	BlitterWrapper(VfilterInfo const &, int scale, bool yuv, bool full);
 	~BlitterWrapper();
 	Buf inBuf() const;
-	void draw();
-	void present() { blitter_.present(); }
+
+	/**
+	  * Draws the frame in inBuf(). With the frame's line hashes
+	  * (GB::lineHashes) only the lines that changed are scaled, and a frame
+	  * that did not change at all is neither converted nor flipped.
+	  */
+	void draw(gambatte::uint_least64_t const *lineHashes = 0);
+	void present();
+
+	/**
+	  * Moves draw (conversion, ghosting, scaling, overlays) and present to a
+	  * separate thread. inBuf() then rotates through three buffers: draw()
+	  * hands the finished frame over without waiting and the emulator goes on
+	  * rendering the next one while the presentation thread scales and flips.
+	  */
+	void startPresentThread();
+
+	/**
+	  * Waits until every frame handed over by draw() has been presented, so
+	  * that the calling thread can use the screen. Call before entering the menu.
+	  */
+	void sync();
+
+	void setPerfHud(PerfHud *hud) { blitter_.setPerfHud(hud); }
 	void toggleFullScreen() { blitter_.toggleFullScreen(); }
 	void CheckIPU() { blitter_.CheckIPU(); }
 	void setBufferDimensions() { blitter_.setBufferDimensions(); }
@@ -44,9 +68,34 @@ public:
 	SdlBlitter blitter_;
 
 private:
-	
+	enum { num_frame_bufs = 3 };
+	enum { frame_buf_fresh = 4 };
+
 	scoped_ptr<VideoLink> const cconvert_;
 	scoped_ptr<VideoLink> const vfilter_;
+
+	// Triple buffer handoff. back_ belongs to the emulation thread, front_ to
+	// the presentation thread, and they swap with middle_ atomically.
+	// frame_buf_fresh is set in middle_ while it holds a frame not yet taken.
+	Array<gambatte::uint_least32_t> frameBufs_;
+	Array<gambatte::uint_least64_t> frameHashes_;
+	bool hashed_[num_frame_bufs];
+	int back_;
+	int front_;
+	std::atomic<int> middle_;
+	std::atomic<unsigned long> handedOver_;
+	std::atomic<unsigned long> presented_;
+	std::atomic<bool> quit_;
+	SDL_sem *frameReady_;
+	SDL_sem *presentReady_;
+	SDL_Thread *presentThread_;
+
+	gambatte::uint_least32_t * frameBuf(int i) const;
+	gambatte::uint_least64_t * frameHashes(int i) const;
+	static int runPresentThread(void *data);
+	void presentLoop();
+	void convert();
+	void drawNow(gambatte::uint_least64_t const *lineHashes);
 };
 
 #endif
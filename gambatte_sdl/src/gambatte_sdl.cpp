@@ -16,14 +16,17 @@
 //   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 //
 
-#include "adaptivesleep.h"
 #include "audiosink.h"
 #include "blitterwrapper.h"
+#include "framepacer.h"
 #include "parser.h"
+#include "perfhud.h"
+#include "recorder.h"
 #include "resample/resampler.h"
 #include "resample/resamplerinfo.h"
 #include "skipsched.h"
 #include "str_to_sdlkey.h"
+#include "trace.h"
 #include "videolink/vfilterinfo.h"
 #include <gambatte.h>
 #include <pakinfo.h>
@@ -35,6 +38,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <map>
 #include <set>
 #include <sstream>
 #include <string>
@@ -290,6 +294,68 @@ private:
 	std::size_t resamplerNo_;
 };
 
+class RecordOption : public DescOption {
+public:
+	RecordOption() : DescOption("record", 0, 1) {}
+
+	virtual void exec(char const *const *argv, int index) {
+		path_ = argv[index + 1];
+	}
+
+	virtual std::string const desc() const {
+		return " PATH		Record every frame and the sound to PATH.y4m\n"
+		       "\t\t\t\tand PATH.wav, leaving out fast-forward\n";
+	}
+
+	std::string const & path() const { return path_; }
+
+private:
+	std::string path_;
+};
+
+#ifdef ENABLE_CPU_TRACE
+class CpuTraceOption : public DescOption {
+public:
+	CpuTraceOption()
+	: DescOption("cpu-trace-on", 0, 1)
+	, pc_(-1)
+	, write_(-1)
+	, rst38_(false)
+	{
+	}
+
+	virtual void exec(char const *const *argv, int index) {
+		std::stringstream ss(argv[index + 1]);
+		std::string trigger;
+		while (std::getline(ss, trigger, ',')) {
+			if (trigger.compare(0, 3, "pc=") == 0)
+				pc_ = std::strtol(trigger.c_str() + 3, 0, 16);
+			else if (trigger.compare(0, 6, "write=") == 0)
+				write_ = std::strtol(trigger.c_str() + 6, 0, 16);
+			else if (trigger == "rst38")
+				rst38_ = true;
+		}
+	}
+
+	virtual std::string const desc() const {
+		return " pc=ADDR,write=ADDR,rst38\n"
+		       "\t\t\t\tWrite the CPU trace to ~/.gambatte/cputrace.txt\n"
+		       "\t\t\t\twhen the CPU runs the instruction at ADDR,\n"
+		       "\t\t\t\twrites to ADDR or runs opcode 0xFF (hex ADDR)\n";
+	}
+
+	void apply(GB &gb, std::string const &path) const {
+		if (pc_ >= 0 || write_ >= 0 || rst38_)
+			gb.setCpuTraceTriggers(path, pc_, write_, rst38_);
+	}
+
+private:
+	long pc_;
+	long write_;
+	bool rst38_;
+};
+#endif
+
 struct JoyData {
 	enum { dir_centered = SDL_HAT_CENTERED,
 	       dir_left     = SDL_HAT_LEFT,
@@ -499,71 +565,217 @@ public:
 	struct Status {
 		long rate;
 		bool low;
+		float fill;
 
-		Status(long rate, bool low) : rate(rate), low(low) {}
+		Status(long rate, bool low, float fill) : rate(rate), low(low), fill(fill) {}
 	};
 
 	AudioOut(long sampleRate, int latency, int periods,
-	         ResamplerInfo const &resamplerInfo, std::size_t maxInSamplesPerWrite)
+	         ResamplerInfo const &resamplerInfo, std::size_t maxInSamplesPerWrite,
+	         bool dynamicRate, PerfHud &perfHud, Recorder *recorder, bool verbose)
 	: resampler_(resamplerInfo.create(2097152, sampleRate, maxInSamplesPerWrite))
-	, resampleBuf_(resampler_->maxOut(maxInSamplesPerWrite) * 2)
+	// leave room for adjustRate raising the output rate by max_rate_deviation_ppm.
+	, resampleBuf_((resampler_->maxOut(maxInSamplesPerWrite) * 129 / 128 + 1) * 2)
+	// the recording is resampled at the nominal rate, so that it keeps in step
+	// with the video whatever adjustRate does to the output rate.
+	, recordResampler_(recorder && dynamicRate
+	                   ? resamplerInfo.create(2097152, sampleRate, maxInSamplesPerWrite)
+	                   : 0)
+	, recordBuf_(recordResampler_ ? recordResampler_->maxOut(maxInSamplesPerWrite) * 2 : 0)
 	, sink_(sampleRate, latency, periods)
+	, sampleRate_(sampleRate)
+	, adjustedRate_(sampleRate)
+	, dynamicRate_(dynamicRate)
+	, perfHud_(perfHud)
+	, recorder_(recorder)
+	, verbose_(verbose)
 	{
 	}
 
+	~AudioOut() {
+		if (verbose_)
+			std::printf("audio: %lu underruns, %lu overruns\n", sink_.underruns(), sink_.overruns());
+	}
+
 	Status write(Uint32 const *data, std::size_t samples) {
+		TRACE_SCOPE("audio write");
 		long const outsamples = resampler_->resample(
 			resampleBuf_, reinterpret_cast<Sint16 const *>(data), samples);
+		if (recordResampler_) {
+			recorder_->audio(recordBuf_, recordResampler_->resample(
+				recordBuf_, reinterpret_cast<Sint16 const *>(data), samples));
+		} else if (recorder_) {
+			recorder_->audio(resampleBuf_, outsamples);
+		}
+
+		usec_t const start = perfHud_.start();
 		AudioSink::Status const &stat = sink_.write(resampleBuf_, outsamples);
+		perfHud_.stop(PerfHud::time_audio, start);
 		bool low = stat.fromUnderrun + outsamples < (stat.fromOverflow - outsamples) * 2;
-		return Status(stat.rate, low);
+		float const fill = stat.fromUnderrun + stat.fromOverflow
+		                 ? float(stat.fromUnderrun) / (stat.fromUnderrun + stat.fromOverflow)
+		                 : 0;
+		if (dynamicRate_)
+			adjustRate(fill);
+
+		return Status(stat.rate, low, fill);
 	}
 
 private:
+	// Dynamic rate control: steer the buffer towards half full by producing
+	// slightly fewer samples when it is fuller than that and slightly more
+	// when it is emptier, so that neither blocking writes nor frame skipping
+	// is needed to keep audio and video in step.
+	enum { max_rate_deviation_ppm = 5000 };
+
 	scoped_ptr<Resampler> const resampler_;
 	Array<Sint16> const resampleBuf_;
+	scoped_ptr<Resampler> const recordResampler_;
+	Array<Sint16> const recordBuf_;
 	AudioSink sink_;
+	long const sampleRate_;
+	long adjustedRate_;
+	bool const dynamicRate_;
+	PerfHud &perfHud_;
+	Recorder *const recorder_;
+	bool const verbose_;
+
+	void adjustRate(float fill) {
+		long const rate = sampleRate_
+		                + long((0.5f - fill) * 2 * max_rate_deviation_ppm * sampleRate_ / 1000000);
+		if (rate != adjustedRate_) {
+			resampler_->adjustRate(2097152, rate);
+			adjustedRate_ = rate;
+		}
+	}
 };
 
-class FrameWait {
+// Audio buffer fill and frame skip statistics of the sync scheme in use,
+// printed on exit with --verbose so that the schemes can be compared.
+class SyncStats : Uncopyable {
 public:
-	FrameWait() : last_() {}
+	SyncStats(char const *scheme, bool verbose)
+	: scheme_(scheme), start_(getusecs()), frames_(0), skipped_(0), fillSum_(0), fillSqSum_(0)
+	, verbose_(verbose)
+	{
+	}
 
-	void waitForNextFrameTime(usec_t frametime) {
-		last_ += asleep_.sleepUntil(last_, frametime);
-		last_ += frametime;
+	~SyncStats() {
+		if (!verbose_ || !frames_)
+			return;
+
+		double const minutes = (getusecs() - start_) / 60000000.0;
+		double const mean = fillSum_ / frames_;
+		std::printf("sync (%s): buffer fill mean %.3f variance %.5f, %.1f skipped frames/min\n",
+		            scheme_, mean, fillSqSum_ / frames_ - mean * mean,
+		            minutes > 0 ? skipped_ / minutes : 0.0);
+	}
+
+	void frame(float fill, bool skipped) {
+		++frames_;
+		skipped_ += skipped;
+		fillSum_ += fill;
+		fillSqSum_ += double(fill) * fill;
 	}
 
 private:
-	AdaptiveSleep asleep_;
-	usec_t last_;
+	char const *const scheme_;
+	usec_t const start_;
+	unsigned long frames_;
+	unsigned long skipped_;
+	double fillSum_;
+	double fillSqSum_;
+	bool const verbose_;
 };
 
-class GetInput : public InputGetter {
+// What the emulation core reports about its fast paths, printed on exit
+// with --verbose.
+class CoreStats : Uncopyable {
 public:
-	unsigned is;
+	CoreStats(GB const &gb, bool verbose) : gb_(gb), verbose_(verbose) {}
+
+	~CoreStats() {
+		unsigned long transfers = 0, batched = 0;
+		gb_.oamDmaStats(transfers, batched);
+		if (verbose_ && transfers) {
+			std::printf("core: %lu OAM DMA transfers, %.1f%% copied in one go\n",
+			            transfers, 100.0 * batched / transfers);
+		}
 
-	GetInput() : is(0) {}
-	virtual unsigned operator()() { return is; }
+		unsigned long drawn = 0, decoded = 0;
+		gb_.tileCacheStats(drawn, decoded);
+		if (verbose_ && drawn) {
+			std::printf("core: tile cache hit rate %.2f%%, %lu rows drawn, %lu decoded\n",
+			            decoded < drawn ? 100.0 - 100.0 * decoded / drawn : 0.0, drawn, decoded);
+		}
+
+#ifdef ENABLE_PROFILER
+		std::string const profilePath = homedir + "/.gambatte/profile.txt";
+		if (gb_.writeProfile(profilePath))
+			std::printf("core: profile written to %s\n", profilePath.c_str());
+#endif
+	}
+
+private:
+	GB const &gb_;
+	bool const verbose_;
 };
 
-class SdlIniter : Uncopyable {
+// How long each phase of startup took, printed with --verbose. Phases are
+// timed from the end of the previous one; the last ends with the first frame
+// on screen.
+class StartupTimer : Uncopyable {
 public:
-	SdlIniter()
-	: failed_(SDL_Init(SDL_INIT_AUDIO | SDL_INIT_VIDEO) < 0)
-	{
-		if (failed_)
-			std::fprintf(stderr, "Unable to init SDL: %s\n", SDL_GetError());
+	StartupTimer() : start_(getusecs()), last_(start_), paused_(0), verbose_(false) {}
+
+	void setVerbose(bool verbose) { verbose_ = verbose; }
+
+	void phase(char const *name) {
+		if (!verbose_)
+			return;
+
+		usec_t const now = getusecs();
+		std::printf("startup: %-12s %7.1f ms\n", name, (now - last_) / 1000.0);
+		last_ = now;
 	}
 
-	~SdlIniter() {
-		SDL_Quit();
+	// Leaves out the time until the next phase, e.g. spent waiting in a menu.
+	void pause() {
+		if (!verbose_)
+			return;
+
+		usec_t const now = getusecs();
+		paused_ += now - last_;
+		last_ = now;
 	}
 
-	bool isFailed() const { return failed_; }
+	void firstFrame() {
+		if (!verbose_)
+			return;
+
+		phase("first frame");
+		std::printf("startup: %-12s %7.1f ms\n", "total", (last_ - start_ - paused_) / 1000.0);
+		verbose_ = false;
+	}
 
 private:
-	bool const failed_;
+	usec_t const start_;
+	usec_t last_;
+	usec_t paused_;
+	bool verbose_;
+};
+
+class FrameWait : Uncopyable {
+public:
+	FrameWait() { set_framepacer(&pacer_); }
+	~FrameWait() { set_framepacer(0); }
+
+	void waitForNextFrameTime(usec_t frametime) {
+		pacer_.waitForNextFrameTime(frametime);
+	}
+
+private:
+	FramePacer pacer_;
 };
 
 class JsOpen : Uncopyable {
@@ -578,29 +790,142 @@ public:
 
 	~JsOpen() { std::for_each(opened_.begin(), opened_.end(), SDL_JoystickClose); }
 
+	/** The opened joystick with device index devNum, or 0. */
+	SDL_Joystick * joystick(int devNum) const {
+		for (std::size_t i = 0; i < opened_.size(); ++i) {
+			if (SDL_JoystickIndex(opened_[i]) == devNum)
+				return opened_[i];
+		}
+
+		return 0;
+	}
+
 private:
 	std::vector<SDL_Joystick *> opened_;
 };
 
+class GetInput : public InputGetter {
+public:
+	typedef std::multimap<SDLKey, Button> keymap_t;
+	typedef std::multimap<JoyData, Button> jmap_t;
+
+	unsigned is;
+
+	GetInput() : is(0), keyMap_(0), jbMap_(0), jaMap_(0), jhMap_(0), joysticks_(0) {}
+
+	/**
+	  * Also checks the keys in keyMap, and the joystick buttons, axes and hats
+	  * in jbMap, jaMap and jhMap, when called, for the late input latch, so a
+	  * button pressed since the last event loop is seen when the game reads
+	  * P1 rather than a frame later. Releases still wait for the event loop.
+	  */
+	void poll(keymap_t const *keyMap, jmap_t const *jbMap, jmap_t const *jaMap, jmap_t const *jhMap) {
+		keyMap_ = keyMap;
+		jbMap_ = jbMap;
+		jaMap_ = jaMap;
+		jhMap_ = jhMap;
+	}
+
+	/** The joysticks the joystick maps refer to. Without them only keys are polled. */
+	void setJoysticks(JsOpen const *joysticks) { joysticks_ = joysticks; }
+
+	virtual unsigned operator()() {
+		if (!keyMap_)
+			return is;
+
+		// with joystick events enabled this also updates the joystick state.
+		SDL_PumpEvents();
+		Uint8 const *const keys = SDL_GetKeyState(0);
+		unsigned held = is;
+		for (keymap_t::const_iterator it = keyMap_->begin(); it != keyMap_->end(); ++it) {
+			if (keys[it->first])
+				held |= it->second;
+		}
+
+		if (joysticks_)
+			held |= heldJoystickButtons();
+
+		return held;
+	}
+
+private:
+	keymap_t const *keyMap_;
+	jmap_t const *jbMap_;
+	jmap_t const *jaMap_;
+	jmap_t const *jhMap_;
+	JsOpen const *joysticks_;
+
+	unsigned heldJoystickButtons() const {
+		unsigned held = 0;
+		for (jmap_t::const_iterator it = jbMap_->begin(); it != jbMap_->end(); ++it) {
+			SDL_Joystick *const j = joysticks_->joystick(it->first.dev_num);
+			if (j && SDL_JoystickGetButton(j, it->first.num))
+				held |= it->second;
+		}
+
+		// same thresholds as the SDL_JOYAXISMOTION handling in the event loop.
+		for (jmap_t::const_iterator it = jaMap_->begin(); it != jaMap_->end(); ++it) {
+			if (SDL_Joystick *const j = joysticks_->joystick(it->first.dev_num)) {
+				Sint16 const value = SDL_JoystickGetAxis(j, it->first.num);
+				Sint16 const dir = value < -8192 ? JoyData::dir_down
+				                 : (value > 8192 ? JoyData::dir_up : JoyData::dir_centered);
+				if (dir == it->first.dir)
+					held |= it->second;
+			}
+		}
+
+		for (jmap_t::const_iterator it = jhMap_->begin(); it != jhMap_->end(); ++it) {
+			SDL_Joystick *const j = joysticks_->joystick(it->first.dev_num);
+			if (j && (SDL_JoystickGetHat(j, it->first.num) & it->first.dir))
+				held |= it->second;
+		}
+
+		return held;
+	}
+};
+
+class SdlIniter : Uncopyable {
+public:
+	SdlIniter()
+	: failed_(SDL_Init(SDL_INIT_AUDIO | SDL_INIT_VIDEO) < 0)
+	{
+		if (failed_)
+			std::fprintf(stderr, "Unable to init SDL: %s\n", SDL_GetError());
+	}
+
+	~SdlIniter() {
+		SDL_Quit();
+	}
+
+	bool isFailed() const { return failed_; }
+
+private:
+	bool const failed_;
+};
+
 class GambatteSdl {
 public:
-	GambatteSdl() { gambatte.setInputGetter(&inputGetter); }
+	GambatteSdl() : verbose(false) { gambatte.setInputGetter(&inputGetter); }
 	int exec(int argc, char const *const argv[]);
 
 private:
-	typedef std::multimap<SDLKey,  InputGetter::Button> keymap_t;
-	typedef std::multimap<JoyData, InputGetter::Button> jmap_t;
+	typedef GetInput::keymap_t keymap_t;
+	typedef GetInput::jmap_t jmap_t;
 
 	GetInput inputGetter;
+	StartupTimer startupTimer;
 	GB gambatte;
+	PerfHud perfHud;
 	keymap_t keyMap;
 	jmap_t jbMap;
 	jmap_t jaMap;
 	jmap_t jhMap;
+	bool verbose;
 
 	bool handleEvents(BlitterWrapper &blitter);
 	int run(long sampleRate, int latency, int periods,
-	        ResamplerInfo const &resamplerInfo, BlitterWrapper &blitter);
+	        ResamplerInfo const &resamplerInfo, bool dynamicRate,
+	        BlitterWrapper &blitter, Recorder *recorder);
 	void refreshKeymaps();
 };
 
@@ -701,12 +1026,28 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 	VfOption vfOption;
 	BoolOption yuvOption("\t\tUse YUV overlay for (usually faster) scaling\n",
 	                     "yuv-overlay", 'y');
+	BoolOption drcOption("\tKeep audio in sync by adjusting the resampling\n"
+	                     "\t\t\t\tratio slightly instead of skipping frames\n",
+	                     "dynamic-rate-control");
+	BoolOption threadedPresentOption("\t\tScale and flip on a separate thread\n",
+	                                 "threaded-present");
+	BoolOption verboseOption("\t\t\tPrint how long each startup phase took,\n"
+	                         "\t\t\t\tand audio, sync and core statistics on exit\n",
+	                         "verbose");
 	BoolOption gbaCgbOption("\t\t\tGBA CGB mode\n", "gba-cgb");
 	BoolOption forceDmgOption("\t\tForce DMG mode\n", "force-dmg");
 	BoolOption multicartCompatOption(
 		"\tSupport certain multicart ROM images by\n"
 		"\t\t\t\tnot strictly respecting ROM header MBC type\n", "multicart-compat");
 	InputOption inputOption;
+	BoolOption lateInputOption("\t\tRead the buttons when the game reads them,\n"
+	                           "\t\t\t\tup to a frame sooner\n", "late-input");
+	RecordOption recordOption;
+	BoolOption recordRawOption("\t\tRecord raw RGB32 to PATH.rgb and 16-bit\n"
+	                           "\t\t\t\tPCM to PATH.pcm instead\n", "record-raw");
+#ifdef ENABLE_CPU_TRACE
+	CpuTraceOption cpuTraceOption;
+#endif
 	int loadIndex = 0;
 
 	{
@@ -714,17 +1055,26 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		BoolOption lkOption("\t\tList valid input KEYS\n", "list-keys");
 		std::vector<DescOption *> v;
 		v.push_back(&controlsOption);
+#ifdef ENABLE_CPU_TRACE
+		v.push_back(&cpuTraceOption);
+#endif
+		v.push_back(&drcOption);
 		v.push_back(&gbaCgbOption);
 		v.push_back(&forceDmgOption);
 		v.push_back(&multicartCompatOption);
 		v.push_back(&fsOption);
 		v.push_back(&inputOption);
+		v.push_back(&lateInputOption);
 		v.push_back(&latencyOption);
 		v.push_back(&lkOption);
 		v.push_back(&periodsOption);
 		v.push_back(&rateOption);
+		v.push_back(&recordOption);
+		v.push_back(&recordRawOption);
 		v.push_back(&resamplerOption);
 		v.push_back(&scaleOption);
+		v.push_back(&threadedPresentOption);
+		v.push_back(&verboseOption);
 		v.push_back(&vfOption);
 		v.push_back(&yuvOption);
 
@@ -772,6 +1122,17 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 
 	std::string savedir = (homedir + "/.gambatte/saves/");
 	gambatte.setSaveDir(savedir);
+	if (lateInputOption.isSet()) {
+		gambatte.setLateInputLatch(true);
+		inputGetter.poll(&keyMap, &jbMap, &jaMap, &jhMap);
+	}
+#ifdef ENABLE_CPU_TRACE
+	cpuTraceOption.apply(gambatte, homedir + "/.gambatte/cputrace.txt");
+#endif
+
+	verbose = verboseOption.isSet();
+	startupTimer.setVerbose(verbose);
+	startupTimer.phase("config");
 
 	SdlIniter sdlIniter;
 	if (sdlIniter.isFailed())
@@ -784,7 +1145,9 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 	}
 
 	JsOpen jsOpen(jdevnums.begin(), jdevnums.end());
+	inputGetter.setJoysticks(&jsOpen);
 	SDL_JoystickEventState(SDL_ENABLE);
+	startupTimer.phase("sdl init");
 	BlitterWrapper blitter(vfOption.filter(),
 	                       scaleOption.scale(), yuvOption.isSet(),
 	                       fsOption.isSet());
@@ -796,23 +1159,34 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 
 	SDL_ShowCursor(SDL_DISABLE);
 	SDL_WM_SetCaption("Gambatte SDL", 0);
+	startupTimer.phase("video init");
 
-	init_fps_font(); // load fps font on startup
-	init_menu(); //load menu font on startup
+	// the fonts are loaded when first needed, menu sounds on first menu entry.
 	init_menusurfaces(); //init menu surfaces on startup
 
 	gameiscgb = 0;
 	loadPalette(palname); //load palette for initial menu on startup
 	load_border(dmgbordername); //load DMG border for initial menu on startup
+	startupTimer.phase("menu assets");
 
 	//gb/gbc bootloader support
 	gambatte.setBootloaderGetter(get_bootloader_from_file);
 
 	main_menu();
+	startupTimer.pause();
 	inputGetter.is = 0;
 
+	if (threadedPresentOption.isSet())
+		blitter.startPresentThread();
+
+	scoped_ptr<Recorder> const recorder(recordOption.path().empty()
+		? 0
+		: new Recorder(recordOption.path(), rateOption.rate(), recordRawOption.isSet()));
+	if (recorder && !recorder->isOk())
+		return EXIT_FAILURE;
+
 	return run(rateOption.rate(), latencyOption.latency(), periodsOption.periods(),
-	           resamplerOption.resampler(), blitter);
+	           resamplerOption.resampler(), drcOption.isSet(), blitter, recorder.get());
 }
 
 #else //ROM_BROWSER
@@ -858,12 +1232,28 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 	VfOption vfOption;
 	BoolOption yuvOption("\t\tUse YUV overlay for (usually faster) scaling\n",
 	                     "yuv-overlay", 'y');
+	BoolOption drcOption("\tKeep audio in sync by adjusting the resampling\n"
+	                     "\t\t\t\tratio slightly instead of skipping frames\n",
+	                     "dynamic-rate-control");
+	BoolOption threadedPresentOption("\t\tScale and flip on a separate thread\n",
+	                                 "threaded-present");
+	BoolOption verboseOption("\t\t\tPrint how long each startup phase took,\n"
+	                         "\t\t\t\tand audio, sync and core statistics on exit\n",
+	                         "verbose");
 	BoolOption gbaCgbOption("\t\t\tGBA CGB mode\n", "gba-cgb");
 	BoolOption forceDmgOption("\t\tForce DMG mode\n", "force-dmg");
 	BoolOption multicartCompatOption(
 		"\tSupport certain multicart ROM images by\n"
 		"\t\t\t\tnot strictly respecting ROM header MBC type\n", "multicart-compat");
 	InputOption inputOption;
+	BoolOption lateInputOption("\t\tRead the buttons when the game reads them,\n"
+	                           "\t\t\t\tup to a frame sooner\n", "late-input");
+	RecordOption recordOption;
+	BoolOption recordRawOption("\t\tRecord raw RGB32 to PATH.rgb and 16-bit\n"
+	                           "\t\t\t\tPCM to PATH.pcm instead\n", "record-raw");
+#ifdef ENABLE_CPU_TRACE
+	CpuTraceOption cpuTraceOption;
+#endif
 	int loadIndex = 0;
 
 	{
@@ -871,17 +1261,26 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		BoolOption lkOption("\t\tList valid input KEYS\n", "list-keys");
 		std::vector<DescOption *> v;
 		v.push_back(&controlsOption);
+#ifdef ENABLE_CPU_TRACE
+		v.push_back(&cpuTraceOption);
+#endif
+		v.push_back(&drcOption);
 		v.push_back(&gbaCgbOption);
 		v.push_back(&forceDmgOption);
 		v.push_back(&multicartCompatOption);
 		v.push_back(&fsOption);
 		v.push_back(&inputOption);
+		v.push_back(&lateInputOption);
 		v.push_back(&latencyOption);
 		v.push_back(&lkOption);
 		v.push_back(&periodsOption);
 		v.push_back(&rateOption);
+		v.push_back(&recordOption);
+		v.push_back(&recordRawOption);
 		v.push_back(&resamplerOption);
 		v.push_back(&scaleOption);
+		v.push_back(&threadedPresentOption);
+		v.push_back(&verboseOption);
 		v.push_back(&vfOption);
 		v.push_back(&yuvOption);
 
@@ -913,6 +1312,9 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		}
 	}
 
+	verbose = verboseOption.isSet();
+	startupTimer.setVerbose(verbose);
+
 	std::string romflnm(argv[loadIndex]);
 	currgamename = strip_Dir(strip_Extension(romflnm));
 
@@ -944,6 +1346,14 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 
 	std::string savedir = (homedir + "/.gambatte/saves/");
 	gambatte.setSaveDir(savedir);
+	if (lateInputOption.isSet()) {
+		gambatte.setLateInputLatch(true);
+		inputGetter.poll(&keyMap, &jbMap, &jaMap, &jhMap);
+	}
+#ifdef ENABLE_CPU_TRACE
+	cpuTraceOption.apply(gambatte, homedir + "/.gambatte/cputrace.txt");
+#endif
+	startupTimer.phase("config");
 
 	//gb/gbc bootloader support
 	gambatte.setBootloaderGetter(get_bootloader_from_file);
@@ -957,6 +1367,7 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		std::printf("failed to load ROM %s: %s\n", argv[loadIndex], to_string(error).c_str());
 		return EXIT_FAILURE;
 	}
+	startupTimer.phase("rom load");
 
 	{
 		PakInfo const &pak = gambatte.pakInfo();
@@ -978,7 +1389,9 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 	}
 
 	JsOpen jsOpen(jdevnums.begin(), jdevnums.end());
+	inputGetter.setJoysticks(&jsOpen);
 	SDL_JoystickEventState(SDL_ENABLE);
+	startupTimer.phase("sdl init");
 	BlitterWrapper blitter(vfOption.filter(),
 	                       scaleOption.scale(), yuvOption.isSet(),
 	                       fsOption.isSet());
@@ -990,9 +1403,9 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 
 	SDL_ShowCursor(SDL_DISABLE);
 	SDL_WM_SetCaption("Gambatte SDL", 0);
+	startupTimer.phase("video init");
 
-	init_fps_font(); // load fps font on startup
-	init_menu(); //load menu font on startup
+	// the fonts are loaded when first needed, menu sounds on first menu entry.
 	init_menusurfaces(); //init menu surfaces on startup
 
 	if(gambatte.isCgb()){
@@ -1002,13 +1415,24 @@ int GambatteSdl::exec(int const argc, char const *const argv[]) {
 		gameiscgb = 0;
 		loadPalette(palname); //load palette on startup
 	}
+	startupTimer.phase("palette");
 
 	if (stateautoload == 1) {
         stateload_dms(0); //autoload state 0
+        startupTimer.phase("state load");
     }
 
+	if (threadedPresentOption.isSet())
+		blitter.startPresentThread();
+
+	scoped_ptr<Recorder> const recorder(recordOption.path().empty()
+		? 0
+		: new Recorder(recordOption.path(), rateOption.rate(), recordRawOption.isSet()));
+	if (recorder && !recorder->isOk())
+		return EXIT_FAILURE;
+
 	return run(rateOption.rate(), latencyOption.latency(), periodsOption.periods(),
-	           resamplerOption.resampler(), blitter);
+	           resamplerOption.resampler(), drcOption.isSet(), blitter, recorder.get());
 }
 
 #endif //ROM_BROWSER
@@ -1086,6 +1510,12 @@ bool GambatteSdl::handleEvents(BlitterWrapper &blitter) {
 					switch (e.key.keysym.sym) {
 					//case SDLK_f: blitter.toggleFullScreen(); break;
 					//case SDLK_r: gambatte.reset(); break;
+#ifdef ENABLE_TRACE
+					case SDLK_t: TRACE_DUMP((homedir + "/.gambatte/trace.json").c_str()); break;
+#endif
+#ifdef ENABLE_CPU_TRACE
+					case SDLK_i: gambatte.writeCpuTrace(homedir + "/.gambatte/cputrace.txt"); break;
+#endif
 					default: break;
 					}
 				} else {
@@ -1097,6 +1527,7 @@ bool GambatteSdl::handleEvents(BlitterWrapper &blitter) {
 					case SDLK_q: // Power button in Funkey-S devices
 						if((menuout == -1) && (menuin == -1)){
 							ffwdtoggle = 0;
+							blitter.sync();
 							main_menu_with_anim();
 							inputGetter.is = 0;
 						}
@@ -1175,23 +1606,38 @@ static bool isFastForward(Uint8 const *keys) {
 }
 
 int GambatteSdl::run(long const sampleRate, int const latency, int const periods,
-                     ResamplerInfo const &resamplerInfo, BlitterWrapper &blitter) {
+                     ResamplerInfo const &resamplerInfo, bool const dynamicRate,
+                     BlitterWrapper &blitter, Recorder *const recorder) {
 	Array<Uint32> const audioBuf(gb_samples_per_frame + gambatte_max_overproduction);
-	AudioOut aout(sampleRate, latency, periods, resamplerInfo, audioBuf.size());
+	AudioOut aout(sampleRate, latency, periods, resamplerInfo, audioBuf.size(), dynamicRate,
+	              perfHud, recorder, verbose);
 	FrameWait frameWait;
 	SkipSched skipSched;
+	SyncStats syncStats(dynamicRate ? "dynamic rate control" : "frame skipping", verbose);
+	CoreStats coreStats(gambatte, verbose);
 	Uint8 const *const keys = SDL_GetKeyState(0);
 	std::size_t bufsamples = 0;
 	bool audioOutBufLow = false;
+	float audioFill = 0;
 	int ffwd = 0;
 	int ffwd_speed = 6;
-
+	gambatte::uint_least64_t lineHashes[VfilterInfo::in_height];
+
+	blitter.setPerfHud(&perfHud);
+	set_perfhud(&perfHud);
+	set_recorder(recorder);
+#ifdef ENABLE_TRACE
+	std::string const tracePath = homedir + "/.gambatte/trace.json";
+	TRACE_DUMP_AT_EXIT(tracePath.c_str());
+#endif
 	SDL_PauseAudio(0);
 
 	for (;;) {
 
-		if (handleEvents(blitter))
+		if (handleEvents(blitter)) {
+			set_recorder(0);
 			return 0;
+		}
 
 #ifdef MIYOO_BATTERY_WARNING
 		checkBatt();
@@ -1202,13 +1648,18 @@ int GambatteSdl::run(long const sampleRate, int const latency, int const periods
 		if (isFastForward(keys)) {
 			runsamples = runsamples / ffwd_speed; //in ffwd mode: attempt to decrease the amount of used resources by lowering the number of samples per frame.
 		}
+		perfHud.setVisible(showfps == 2);
+		usec_t const emulateStart = perfHud.start();
 		std::ptrdiff_t const vidFrameDoneSampleCnt = gambatte.runFor(
 			vbuf.pixels, vbuf.pitch, audioBuf + bufsamples, runsamples);
+		perfHud.stop(PerfHud::time_emulate, emulateStart);
 		std::size_t const outsamples = vidFrameDoneSampleCnt >= 0
 		                             ? bufsamples + vidFrameDoneSampleCnt
 		                             : bufsamples + runsamples;
 		bufsamples += runsamples;
 		bufsamples -= outsamples;
+		if (vidFrameDoneSampleCnt >= 0)
+			gambatte.lineHashes(lineHashes);
 
 		if (isFastForward(keys)) { // in ffwd mode: dont wait for frame time, dont write sound into the buffer and only draw one of every <ffwd_speed> frames.
 			if(ffwd < ffwd_speed) {
@@ -1216,28 +1667,47 @@ int GambatteSdl::run(long const sampleRate, int const latency, int const periods
 			} else {
 				ffwd = 0;
 				if (vidFrameDoneSampleCnt >= 0) {
-					blitter.draw();
+					blitter.draw(lineHashes);
 					blitter.present();
+					startupTimer.firstFrame();
 				}
 			}
+			if (vidFrameDoneSampleCnt >= 0)
+				perfHud.endFrame(audioFill, false, ffwd_speed);
 		} else {
+			// with dynamic rate control the audio rate follows the video rate,
+			// so there is nothing to catch up on by skipping frames.
 			bool const blit = vidFrameDoneSampleCnt >= 0
-			               && !skipSched.skipNext(audioOutBufLow);
+			               && (dynamicRate || !skipSched.skipNext(audioOutBufLow));
+			// before draw, which hands the buffer over to the present thread.
+			if (recorder && vidFrameDoneSampleCnt >= 0)
+				recorder->frame(vbuf.pixels, vbuf.pitch);
+
 			if (blit)
-				blitter.draw();
+				blitter.draw(lineHashes);
 
 			AudioOut::Status const &astatus = aout.write(audioBuf, outsamples);
 			audioOutBufLow = astatus.low;
+			audioFill = astatus.fill;
+			if (vidFrameDoneSampleCnt >= 0)
+				syncStats.frame(astatus.fill, !blit);
+
 			if (blit) {
-				usec_t ft = (16743ul - 16743 / 1024) * sampleRate / astatus.rate;
+				usec_t ft = dynamicRate
+				          ? 16743ul
+				          : (16743ul - 16743 / 1024) * sampleRate / astatus.rate;
 				frameWait.waitForNextFrameTime(ft);
 				blitter.present();
+				startupTimer.firstFrame();
 			}
+			if (vidFrameDoneSampleCnt >= 0)
+				perfHud.endFrame(astatus.fill, !blit, 1);
 			std::memmove(audioBuf, audioBuf + outsamples, bufsamples * sizeof *audioBuf);
 		}
 
 		if(menuin == -2){
 			menuin = -1;
+			blitter.sync();
 			main_menu();
 		}
 	}
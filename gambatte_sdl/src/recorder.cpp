@@ -0,0 +1,298 @@
+#include "recorder.h"
+#include <SDL_thread.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+void put16(unsigned char *p, unsigned long v) {
+	p[0] = v & 0xFF;
+	p[1] = v >> 8 & 0xFF;
+}
+
+void put32(unsigned char *p, unsigned long v) {
+	put16(p, v & 0xFFFF);
+	put16(p + 2, v >> 16);
+}
+
+enum { stereo = 2 };
+
+char const y4m_header[] = "YUV4MPEG2 W160 H144 F4194304:70224 Ip A1:1 C420jpeg\n";
+char const y4m_frame[] = "FRAME\n";
+enum { y4m_frame_size = sizeof y4m_frame - 1 + 160 * 144 * 3 / 2 };
+
+// BT.601 studio swing, which is what players assume when a Y4M does not say.
+void rgb32ToYuv420(gambatte::uint_least32_t const *rgb, unsigned char *out, int w, int h) {
+	unsigned char *y = out;
+	unsigned char *u = y + w * h;
+	unsigned char *v = u + w / 2 * (h / 2);
+
+	for (int i = 0; i < w * h; ++i) {
+		unsigned long const r = rgb[i] >> 16 & 0xFF, g = rgb[i] >> 8 & 0xFF, b = rgb[i] & 0xFF;
+		y[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+	}
+
+	for (int cy = 0; cy < h; cy += 2) {
+		for (int cx = 0; cx < w; cx += 2) {
+			gambatte::uint_least32_t const *const p = rgb + cy * w + cx;
+			long r = 0, g = 0, b = 0;
+			for (int i = 0; i < 4; ++i) {
+				gambatte::uint_least32_t const c = p[(i >> 1) * w + (i & 1)];
+				r += c >> 16 & 0xFF;
+				g += c >> 8 & 0xFF;
+				b += c & 0xFF;
+			}
+
+			// the sums are 4 times the average; 131584 = 4 * (128 << 8) + 4 * 128.
+			*u++ = (-38 * r - 74 * g + 112 * b + 131584) >> 10;
+			*v++ = (112 * r - 94 * g - 18 * b + 131584) >> 10;
+		}
+	}
+}
+
+}
+
+struct Recorder::SdlDeleter {
+	static void del(SDL_sem *s) { if (s) SDL_DestroySemaphore(s); }
+};
+
+Recorder::Recorder(std::string const &path, long const sampleRate, bool const raw)
+: video_(std::size_t(video_ring_frames) * frame_words)
+, audio_(std::size_t(sampleRate) * stereo * audio_ring_seconds)
+, gaps_(std::size_t(max_gaps) * gap_words)
+, frameBuf_(width * height)
+, yuvBuf_(raw ? 0 : y4m_frame_size)
+, audioBuf_(4096)
+, videoFile_(std::fopen((path + (raw ? ".rgb" : ".y4m")).c_str(), "wb"))
+, audioFile_(std::fopen((path + (raw ? ".pcm" : ".wav")).c_str(), "wb"))
+, sampleRate_(sampleRate)
+, raw_(raw)
+, haveFrame_(false)
+, writeFailed_(false)
+, audioBytes_(0)
+, samplesDrained_(0)
+, haveGap_(false)
+, framesSeen_(0)
+, framesDropped_(0)
+, dropsPending_(0)
+, samplesDropped_(0)
+, samplesQueued_(0)
+, silencePending_(0)
+, quit_(false)
+, dataReady_(SDL_CreateSemaphore(0))
+, writer_(0)
+{
+	if (!videoFile_ || !audioFile_) {
+		std::perror(("record: " + path).c_str());
+		return;
+	}
+
+	if (!raw_) {
+		std::fputs(y4m_header, videoFile_);
+		std::memcpy(yuvBuf_, y4m_frame, sizeof y4m_frame - 1);
+		// sizes are filled in on close.
+		writeWavHeader();
+	}
+
+	if (dataReady_)
+		writer_ = SDL_CreateThread(runWriter, this);
+}
+
+Recorder::~Recorder() {
+	finish();
+}
+
+void Recorder::finish() {
+	if (writer_) {
+		quit_ = true;
+		SDL_SemPost(dataReady_.get());
+		SDL_WaitThread(writer_, 0);
+
+		// the writer is done, so what was dropped at the very end can be
+		// made up for here.
+		if (haveFrame_) {
+			for (; dropsPending_; --dropsPending_)
+				writeFrame();
+		}
+
+		writeSilence(silencePending_);
+		std::printf("record: %lu frames, %lu dropped, %lu audio samples dropped\n",
+		            framesSeen_, framesDropped_, samplesDropped_);
+		writer_ = 0;
+	}
+
+	if (audioFile_) {
+		if (!raw_ && std::fseek(audioFile_, 0, SEEK_SET) == 0)
+			writeWavHeader();
+
+		std::fclose(audioFile_);
+		audioFile_ = 0;
+	}
+
+	if (videoFile_) {
+		std::fclose(videoFile_);
+		videoFile_ = 0;
+	}
+}
+
+void Recorder::frame(gambatte::uint_least32_t const *const pixels, std::ptrdiff_t const pitch) {
+	if (!writer_)
+		return;
+
+	++framesSeen_;
+	if (video_.avail() < std::size_t(frame_words)) {
+		++framesDropped_;
+		++dropsPending_;
+		return;
+	}
+
+	gambatte::uint_least32_t const drops = dropsPending_;
+	dropsPending_ = 0;
+	video_.write(&drops, 1);
+	for (int y = 0; y < height; ++y)
+		video_.write(pixels + y * pitch, width);
+
+	SDL_SemPost(dataReady_.get());
+}
+
+void Recorder::audio(Sint16 const *const samples, std::size_t const num) {
+	if (!writer_)
+		return;
+
+	if (audio_.avail() < num * stereo) {
+		samplesDropped_ += num;
+		silencePending_ += num;
+		return;
+	}
+
+	// tell the writer where the silence goes. The gap is written before the
+	// samples that follow it, so the writer sees it by the time it gets there.
+	// Should the gap ring be full, the silence moves on to a later gap.
+	if (silencePending_ && gaps_.avail() >= std::size_t(gap_words)) {
+		unsigned long const gap[gap_words] = { samplesQueued_, silencePending_ };
+		gaps_.write(gap, gap_words);
+		silencePending_ = 0;
+	}
+
+	audio_.write(samples, num * stereo);
+	samplesQueued_ += num;
+	SDL_SemPost(dataReady_.get());
+}
+
+int Recorder::runWriter(void *const data) {
+	static_cast<Recorder *>(data)->writeLoop();
+	return 0;
+}
+
+void Recorder::writeLoop() {
+	for (;;) {
+		SDL_SemWait(dataReady_.get());
+		// whatever was handed over before quit_ was set is written first.
+		bool const quit = quit_;
+		drain();
+		if (quit)
+			return;
+	}
+}
+
+void Recorder::drain() {
+	while (video_.used() >= std::size_t(frame_words)) {
+		gambatte::uint_least32_t drops = 0;
+		video_.read(&drops, 1);
+		if (haveFrame_) {
+			for (; drops; --drops)
+				writeFrame();
+		}
+
+		video_.read(frameBuf_, width * height);
+		if (!raw_)
+			rgb32ToYuv420(frameBuf_, yuvBuf_ + sizeof y4m_frame - 1, width, height);
+
+		writeFrame();
+		haveFrame_ = true;
+	}
+
+	for (;;) {
+		std::size_t n = audio_.used() / stereo;
+		if (!haveGap_ && gaps_.used() >= std::size_t(gap_words)) {
+			gaps_.read(gap_, gap_words);
+			haveGap_ = true;
+		}
+
+		if (haveGap_) {
+			if (samplesDrained_ == gap_[0]) {
+				writeSilence(gap_[1]);
+				haveGap_ = false;
+				continue;
+			}
+
+			n = std::min<unsigned long>(n, gap_[0] - samplesDrained_);
+		}
+
+		if (n == 0)
+			return;
+
+		n = std::min(n, audioBuf_.size() / stereo);
+		audio_.read(audioBuf_, n * stereo);
+		writeAudio(audioBuf_, n);
+		// gaps are placed by the samples queued, so silence is not counted.
+		samplesDrained_ += n;
+	}
+}
+
+void Recorder::writeFrame() {
+	if (writeFailed_)
+		return;
+
+	if (raw_) {
+		std::size_t const size = frameBuf_.size() * sizeof *frameBuf_;
+		checkWrite(std::fwrite(frameBuf_, 1, size, videoFile_), size);
+	} else
+		checkWrite(std::fwrite(yuvBuf_, 1, yuvBuf_.size(), videoFile_), yuvBuf_.size());
+}
+
+void Recorder::writeSilence(unsigned long num) {
+	std::memset(audioBuf_, 0, audioBuf_.size() * sizeof *audioBuf_);
+	while (num) {
+		std::size_t const n = std::min<unsigned long>(num, audioBuf_.size() / stereo);
+		writeAudio(audioBuf_, n);
+		num -= n;
+	}
+}
+
+void Recorder::writeAudio(Sint16 const *const samples, std::size_t const num) {
+	if (writeFailed_)
+		return;
+
+	// WAV wants little endian, which every target this builds for is.
+	std::size_t const size = num * stereo * sizeof *samples;
+	std::size_t const written = std::fwrite(samples, 1, size, audioFile_);
+	audioBytes_ += written;
+	checkWrite(written, size);
+}
+
+void Recorder::checkWrite(std::size_t const written, std::size_t const size) {
+	if (written != size && !writeFailed_) {
+		std::perror("record");
+		writeFailed_ = true;
+	}
+}
+
+void Recorder::writeWavHeader() {
+	// a short write may have left part of a sample.
+	unsigned long const dataBytes = audioBytes_ / 4 * 4;
+	unsigned char h[44];
+	std::memcpy(h, "RIFF", 4);
+	put32(h + 4, 36 + dataBytes);
+	std::memcpy(h + 8, "WAVEfmt ", 8);
+	put32(h + 16, 16);
+	put16(h + 20, 1);
+	put16(h + 22, 2);
+	put32(h + 24, sampleRate_);
+	put32(h + 28, sampleRate_ * 4);
+	put16(h + 32, 4);
+	put16(h + 34, 16);
+	std::memcpy(h + 36, "data", 4);
+	put32(h + 40, dataBytes);
+	std::fwrite(h, 1, sizeof h, audioFile_);
+}
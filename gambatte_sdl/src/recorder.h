@@ -0,0 +1,100 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "array.h"
+#include "gbint.h"
+#include "scoped_ptr.h"
+#include "spscringbuffer.h"
+#include "uncopyable.h"
+#include <SDL.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Records gameplay to path.y4m and path.wav, or with raw set to path.rgb
+// (160x144 native endian RGB32 frames back to back) and path.pcm (native
+// endian 16-bit stereo), which costs the writer no conversion:
+//
+//   ffmpeg -f rawvideo -pixel_format bgr0 -video_size 160x144 -framerate 59.7275 -i path.rgb
+//          -f s16le -ar RATE -ac 2 -i path.pcm out.mkv
+//
+// frame() and audio() are called by the emulation thread and only copy into
+// ring buffers allocated up front; a writer thread converts and writes to
+// disk. When the disk cannot keep up and the rings are full, frames and
+// audio are dropped and counted rather than the emulator waiting. A dropped
+// frame is made up for by repeating the one before it, and dropped audio by
+// as much silence, so the picture stays in step with the sound. If the disk
+// fills up, recording stops and the files are closed with what was written.
+class Recorder : Uncopyable {
+public:
+	Recorder(std::string const &path, long sampleRate, bool raw);
+	~Recorder();
+
+	/** False if the files could not be opened or the writer thread started. */
+	bool isOk() const { return writer_ != 0; }
+
+	/** Records a finished 160x144 frame. */
+	void frame(gambatte::uint_least32_t const *pixels, std::ptrdiff_t pitch);
+
+	/** Records samples stereo samples at the output rate. */
+	void audio(Sint16 const *samples, std::size_t num);
+
+	/**
+	  * Waits for the writer to write out what is queued, makes up for what
+	  * was dropped and closes the files. Called by the destructor, and by
+	  * paths that exit() without unwinding. Nothing is recorded after it.
+	  */
+	void finish();
+
+private:
+	enum { width = 160, height = 144 };
+	// a word telling how many frames were dropped before it, then the pixels.
+	enum { frame_words = 1 + width * height };
+	enum { video_ring_frames = 32 };
+	enum { audio_ring_seconds = 2 };
+	// a position in the audio stream, in samples, then the samples dropped there.
+	enum { gap_words = 2 };
+	enum { max_gaps = 64 };
+
+	struct SdlDeleter;
+
+	SpscRingBuffer<gambatte::uint_least32_t> video_;
+	SpscRingBuffer<Sint16> audio_;
+	SpscRingBuffer<unsigned long> gaps_;
+	// the writer thread's own.
+	Array<gambatte::uint_least32_t> frameBuf_;
+	Array<unsigned char> yuvBuf_;
+	Array<Sint16> audioBuf_;
+	std::FILE *videoFile_;
+	std::FILE *audioFile_;
+	long const sampleRate_;
+	bool const raw_;
+	bool haveFrame_;
+	bool writeFailed_;
+	unsigned long audioBytes_;
+	unsigned long samplesDrained_;
+	unsigned long gap_[gap_words];
+	bool haveGap_;
+	// the emulation thread's own.
+	unsigned long framesSeen_;
+	unsigned long framesDropped_;
+	unsigned long dropsPending_;
+	unsigned long samplesDropped_;
+	unsigned long samplesQueued_;
+	unsigned long silencePending_;
+	std::atomic<bool> quit_;
+	scoped_ptr<SDL_sem, SdlDeleter> const dataReady_;
+	SDL_Thread *writer_;
+
+	static int runWriter(void *data);
+	void writeLoop();
+	void drain();
+	void writeFrame();
+	void writeSilence(unsigned long num);
+	void writeAudio(Sint16 const *samples, std::size_t num);
+	void checkWrite(std::size_t written, std::size_t size);
+	void writeWavHeader();
+};
+
+#endif
@@ -21,6 +21,8 @@
 #include "scalebuffer.h"
 #include "../menu.h"
 #include "../scaler.h"
+#include "perfhud.h"
+#include "trace.h"
 
 #include <string.h>
 #include <string>
@@ -29,7 +31,6 @@
 #include <cmath>
 #include <dirent.h>
 
-SDL_Surface *lastframe;
 SDL_Surface *currframe;
 SDL_Surface *borderimg;
 
@@ -50,6 +51,20 @@ SdlBlitter::SdlBlitter(unsigned inwidth, unsigned inheight,
 , overlay_(screen && scale > 1 && yuv
            ? SDL_CreateYUVOverlay(inwidth * 2, inheight, SDL_UYVY_OVERLAY, screen)
            : 0)
+, ghost_(160, 144)
+, scaleFn_(&SdlBlitter::scaleCentered)
+, lineHash_(144)
+, lineStale_(144)
+, rowsChanged_(144)
+, trackedScreen_(0)
+, hashesValid_(false)
+, ghosted_(false)
+, tracked_(false)
+, shown_(false)
+, partial_(false)
+, skipDraw_(false)
+, skipPresent_(false)
+, perfHud_(0)
 {
 	if (overlay_)
 		SDL_LockYUVOverlay(overlay_.get());
@@ -61,9 +76,7 @@ SdlBlitter::~SdlBlitter() {
 }
 
 void init_ghostframes() {
-	lastframe = SDL_CreateRGBSurface(SDL_SWSURFACE, 160, 144, 16, 0, 0, 0, 0);
 	currframe = SDL_CreateRGBSurface(SDL_SWSURFACE, 160, 144, 16, 0, 0, 0, 0);
-	SDL_SetAlpha(lastframe, SDL_SRCALPHA, 128);
 }
 
 void init_border(SDL_Surface *dst){
@@ -71,20 +84,19 @@ void init_border(SDL_Surface *dst){
 		printf("init_border: screen is not initialized");
 		return;
 	}
+	rescan_borders();
 	if(gameiscgb == 0){
-		load_border(dmgbordername);
-		if((borderimg) && (dmgbordername != "NONE")) {
-			clear_surface(dst, convert_hexcolor(dst, menupalwhite));
-			paint_border(dst);
+		if(dmgbordername != "NONE") {
+			paint_border_cached(dst, dmgbordername, convert_hexcolor(dst, menupalwhite));
 		} else { //if border image is disabled
+			load_border(dmgbordername);
 			clear_surface(dst, 0x000000);
 		}
 	} else if(gameiscgb == 1){
-		load_border(gbcbordername);
-		if((borderimg) && (gbcbordername != "NONE")) {
-			clear_surface(dst, 0x000000);
-			paint_border(dst);
+		if(gbcbordername != "NONE") {
+			paint_border_cached(dst, gbcbordername, 0x000000);
 		} else { //if border image is disabled
+			load_border(gbcbordername);
 			clear_surface(dst, 0x000000);
 		}
 	}
@@ -140,6 +152,7 @@ void SdlBlitter::SetVid(int w, int h, int bpp){
 #else
 	screen = SDL_SetVideoMode(w, h, bpp, SDL_HWSURFACE | SDL_DOUBLEBUF);
 #endif
+	invalidateLines();
 }
 
 void SdlBlitter::SetIPUAspectRatio(const char *ratiovalue){
@@ -415,15 +428,6 @@ inline void SdlBlitter::swScale() {
 	            screen->pitch / screen->format->BytesPerPixel, screen->h / surface->h);
 }
 
-void blend_frames(SDL_Surface *surface) {
-	SDL_BlitSurface(surface, NULL, currframe, NULL);
-	SDL_BlitSurface(lastframe, NULL, currframe, NULL);
-}
-
-void store_lastframe(SDL_Surface *surface) {
-	SDL_BlitSurface(surface, NULL, lastframe, NULL);
-}
-
 void anim_menuin(SDL_Surface *surface) { 
 	
 	if(menuin == 0){
@@ -516,168 +520,174 @@ void anim_textoverlay(SDL_Surface *surface) {
 	}	
 }
 
-void SdlBlitter::applyScalerToSurface(SDL_Surface *sourcesurface) {
-	size_t offset;
-	if (selectedscaler == "No Scaling")
-	{
-		SDL_Rect dst;
-		dst.x = (screen->w - sourcesurface->w) / 2;
-		dst.y = (screen->h - sourcesurface->h) / 2;
-		dst.w = sourcesurface->w;
-		dst.h = sourcesurface->h;
-		SDL_BlitSurface(sourcesurface, NULL, screen, &dst);
-	}
-	else if (selectedscaler == "1.5x Fast")
-	{
-		offset = (2 * (320 - 240) / 2) + ((240 - 216) / 2) * screen->pitch;
-		scale15x((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "1.5x Smooth")
-	{
-#if defined VERSION_FUNKEYS
-		offset = (2 * (240 - 240) / 2) + ((240 - 216) / 2) * screen->pitch;
-		scale15x_pseudobilinear((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, 240);
-#else
-		offset = (2 * (320 - 240) / 2) + ((240 - 216) / 2) * screen->pitch;
-		scale15x_pseudobilinear((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, 320);
-#endif
-	}
-	else if (selectedscaler == "Aspect 1.66x Fast")
-	{
-		offset = (2 * (320 - 266) / 2) + ((240 - 240) / 2) * screen->pitch;
-		scale166x_fast((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "Aspect 1.66x Smooth")
-	{
-		offset = (2 * (320 - 266) / 2) + ((240 - 240) / 2) * screen->pitch;
-		scale166x_pseudobilinear((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "FullScreen Fast")
-	{
-		fullscreen_upscale((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "FullScreen Smooth")
-	{
-		fullscreen_upscale_pseudobilinear((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "1.5x IPU-2x")
-	{
-		offset = (2 * (428 - 320) / 2) + ((320 - 288) / 2) * screen->pitch;
-		scale15x_2((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "1.5x DMG-2x")
-	{
-		offset = (2 * (428 - 320) / 2) + ((320 - 288) / 2) * screen->pitch;
-		if (gameiscgb == 1){
-			scale15x_dotmatrix2((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, menupalblack);
-		} else {
-			scale15x_dotmatrix2((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, menupalwhite);
-		}
-	}
-	else if (selectedscaler == "1.5x Scan-2x")
-	{
-		offset = (2 * (428 - 320) / 2) + ((320 - 288) / 2) * screen->pitch;
-		scale15x_crt2((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "Aspect IPU-2x")
-	{
-		offset = (2 * (384 - 320) / 2) + ((288 - 288) / 2) * screen->pitch;
-		scale166x_2((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "Aspect DMG-2x")
-	{
-		offset = (2 * (384 - 320) / 2) + ((288 - 288) / 2) * screen->pitch;
-		if (gameiscgb == 1){
-			scale166x_dotmatrix2((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, menupalblack);
-		} else {
-			scale166x_dotmatrix2((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, menupalwhite);
-		}
-	}
-	else if (selectedscaler == "Aspect Scan-2x")
-	{
-		offset = (2 * (384 - 320) / 2) + ((288 - 288) / 2) * screen->pitch;
-		scale166x_crt2((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "1.5x DMG-3x")
-	{
-		offset = (2 * (640 - 480) / 2) + ((480 - 432) / 2) * screen->pitch;
-		if (gameiscgb == 1){
-			scale15x_dotmatrix3((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, menupalblack);
-		} else {
-			scale15x_dotmatrix3((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, menupalwhite);
-		}
-	}
-	else if (selectedscaler == "1.5x Scan-3x")
-	{
-		offset = (2 * (640 - 480) / 2) + ((480 - 432) / 2) * screen->pitch;
-		scale15x_crt3((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "Aspect DMG-3x")
-	{
-		offset = (2 * (576 - 480) / 2) + ((432 - 432) / 2) * screen->pitch;
-		if (gameiscgb == 1){
-			scale166x_dotmatrix3((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, menupalblack);
-		} else {
-			scale166x_dotmatrix3((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels, menupalwhite);
-		}
+// Scalers that can be described by a ScalerEngine::Desc go through the
+// engine. The rest are either not a fixed ratio filter or are copies.
+void SdlBlitter::selectScaler() {
+	scalerName_ = selectedscaler;
+	if (ScalerEngine::Desc const *desc = ScalerEngine::find(selectedscaler.c_str())) {
+		engine_.setup(*desc);
+		scaleFn_ = &SdlBlitter::scaleEngine;
+	} else if (selectedscaler == "No Scaling") {
+		scaleFn_ = &SdlBlitter::scaleNone;
+	} else if (selectedscaler == "1.5x Fast") {
+		scaleFn_ = &SdlBlitter::scale15xFast;
+	} else if (selectedscaler == "FullScreen Fast") {
+		scaleFn_ = &SdlBlitter::scaleFullScreenFast;
+	} else {
+		// "1.5x IPU", "Aspect IPU", "FullScreen IPU" and anything unknown
+		scaleFn_ = &SdlBlitter::scaleCentered;
 	}
-	else if (selectedscaler == "Aspect Scan-3x")
+}
+
+void SdlBlitter::scaleNone(SDL_Surface *sourcesurface) {
+	SDL_Rect dst;
+	dst.x = (screen->w - sourcesurface->w) / 2;
+	dst.y = (screen->h - sourcesurface->h) / 2;
+	dst.w = sourcesurface->w;
+	dst.h = sourcesurface->h;
+	SDL_BlitSurface(sourcesurface, NULL, screen, &dst);
+}
+
+void SdlBlitter::scaleCentered(SDL_Surface *sourcesurface) {
+	uint16_t *d = (uint16_t*)screen->pixels + (screen->w - sourcesurface->w) / 2 + (screen->h - sourcesurface->h) * screen->pitch / 4;
+	uint16_t *s = (uint16_t*)sourcesurface->pixels;
+	for (int y = 0; y < sourcesurface->h; y++)
 	{
-		offset = (2 * (576 - 480) / 2) + ((432 - 432) / 2) * screen->pitch;
-		scale166x_crt3((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
+		memmove(d, s, sourcesurface->w * sizeof(uint16_t));
+		s += sourcesurface->w;
+		d += screen->w;
 	}
-	else if (selectedscaler == "FullScreen IPU-2x")
-	{
-		fullscreen_2((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels);
+}
+
+void SdlBlitter::scale15xFast(SDL_Surface *sourcesurface) {
+	size_t offset = (2 * (320 - 240) / 2) + ((240 - 216) / 2) * screen->pitch;
+	scale15x((uint32_t*)((uint8_t *)screen->pixels + offset), (uint32_t*)sourcesurface->pixels);
+}
+
+void SdlBlitter::scaleFullScreenFast(SDL_Surface *sourcesurface) {
+	fullscreen_upscale((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels);
+}
+
+void SdlBlitter::scaleEngine(SDL_Surface *sourcesurface) {
+	scaleEngineWith(sourcesurface, 0);
+}
+
+void SdlBlitter::scaleEngineWith(SDL_Surface *sourcesurface, GhostBlend *ghost) {
+	ScalerEngine::Desc const &desc = *engine_.desc();
+	if (screen->w < desc.dstWidth || screen->h < desc.dstHeight)
+		return;
+
+	std::ptrdiff_t const pitch = screen->pitch / 2;
+	uint16_t *d = (uint16_t*)screen->pixels
+	            + (screen->w - desc.dstWidth) / 2 + (screen->h - desc.dstHeight) / 2 * pitch;
+	uint16_t const grid = hexcolor_to_rgb565(gameiscgb == 1 ? menupalblack : menupalwhite);
+	engine_.scale(d, pitch, (uint16_t const*)sourcesurface->pixels, sourcesurface->pitch / 2, grid, ghost,
+	              partial_ ? static_cast<unsigned char const *>(rowsChanged_) : 0);
+}
+
+// Blends the whole frame into the ghosting history and copies the history
+// to dst, for the scalers and menu animations that need a surface.
+void SdlBlitter::ghostToSurface(SDL_Surface *sourcesurface, SDL_Surface *dst) {
+	ghost_.beginFrame();
+	ghost_.blendFrame((uint16_t const*)sourcesurface->pixels, sourcesurface->pitch / 2);
+	for (unsigned y = 0; y < ghost_.height(); ++y) {
+		memcpy((uint8_t *)dst->pixels + y * dst->pitch, ghost_.history() + y * ghost_.width(),
+		       ghost_.width() * sizeof(uint16_t));
 	}
-	else if (selectedscaler == "FullScreen DMG-2x")
-	{
-		if (gameiscgb == 1){
-			fullscreen_dotmatrix2((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels, menupalblack);
-		} else {
-			fullscreen_dotmatrix2((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels, menupalwhite);
-		}
+}
+
+// The table driven scalers blend each source row right before scaling it,
+// so the frame is read and the history is read and written once.
+void SdlBlitter::applyGhostedScalerToSurface(SDL_Surface *sourcesurface) {
+	if (scalerName_ != selectedscaler)
+		selectScaler();
+
+	ghost_.setPersistence(ghostpersistence);
+	if (scaleFn_ == &SdlBlitter::scaleEngine) {
+		scaleEngineWith(sourcesurface, &ghost_);
+	} else {
+		ghostToSurface(sourcesurface, currframe);
+		(this->*scaleFn_)(currframe);
 	}
-	else if (selectedscaler == "FullScreen Scan-2x")
-	{
-		fullscreen_crt2((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels);
+}
+
+void SdlBlitter::applyScalerToSurface(SDL_Surface *sourcesurface) {
+	// selectedscaler can change from the menu or a per game config at any
+	// time, so look it up again when it does rather than on every frame.
+	if (scalerName_ != selectedscaler)
+		selectScaler();
+
+	(this->*scaleFn_)(sourcesurface);
+}
+
+// SDL_Flip goes round one, two or three screen buffers, so a changed line
+// has to be scaled into each of them before it can be left alone.
+int SdlBlitter::screenBuffers() const {
+	if (!screen || !(screen->flags & SDL_HWSURFACE) || !(screen->flags & SDL_DOUBLEBUF))
+		return 1;
+#ifdef SDL_TRIPLEBUF
+	if ((screen->flags & SDL_TRIPLEBUF) == SDL_TRIPLEBUF)
+		return 3;
+#endif
+	return 2;
+}
+
+void SdlBlitter::invalidateLines() {
+	int const bufs = screenBuffers();
+	for (int y = 0; y < 144; ++y)
+		lineStale_[y] = bufs;
+
+	shown_ = false;
+}
+
+static bool ghostingOff() {
+	return (ghosting == 0) || ((ghosting == 1) && (gameiscgb == 1)) || ((ghosting == 2) && (gameiscgb == 0));
+}
+
+bool SdlBlitter::setLineHashes(gambatte::uint_least64_t const *lineHashes) {
+	tracked_ = true;
+	skipDraw_ = partial_ = false;
+
+	// anything drawn over the game picture, and turning ghosting on or off,
+	// change the screen without the frame changing.
+	bool const ghosted = !ghostingOff();
+	bool const plain = screen && screen == trackedScreen_ && !overlay_
+	                && scalerName_ == selectedscaler
+	                && !((firstframe >= 0) && (firstframe <= 2))
+	                && showoverlay < 0 && menuin < 0 && menuout < 0
+	                && !showfps && ghosted == ghosted_;
+	trackedScreen_ = screen;
+	ghosted_ = ghosted;
+	if (!plain)
+		invalidateLines();
+
+	if (!lineHashes) {
+		hashesValid_ = false;
+		invalidateLines();
+		return true;
 	}
-	else if (selectedscaler == "FullScreen DMG-3x")
-	{
-		if (gameiscgb == 1){
-			fullscreen_dotmatrix3((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels, menupalblack);
-		} else {
-			fullscreen_dotmatrix3((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels, menupalwhite);
+
+	int const bufs = screenBuffers();
+	bool changed = false;
+	for (int y = 0; y < 144; ++y) {
+		// a ghosted line keeps fading in after the frame stopped changing.
+		if (!hashesValid_ || lineHashes[y] != lineHash_[y] || (ghosted && !ghost_.settled(y))) {
+			lineHash_[y] = lineHashes[y];
+			lineStale_[y] = bufs;
+			changed = true;
 		}
+
+		rowsChanged_[y] = lineStale_[y] != 0;
 	}
-	else if (selectedscaler == "FullScreen Scan-3x")
-	{
-		fullscreen_crt3((uint32_t*)screen->pixels, (uint32_t*)sourcesurface->pixels);
-	}
-	else if (selectedscaler == "1.5x IPU" ||
-		selectedscaler == "Aspect IPU" ||
-		selectedscaler == "FullScreen IPU")
-	{
-		uint16_t *d = (uint16_t*)screen->pixels + (screen->w - sourcesurface->w) / 2 + (screen->h - sourcesurface->h) * screen->pitch / 4;
-        uint16_t *s = (uint16_t*)sourcesurface->pixels;
-        for (int y = 0; y < sourcesurface->h; y++)
-        {
-            memmove(d, s, sourcesurface->w * sizeof(uint16_t));
-            s += sourcesurface->w;
-            d += screen->w;
-        }
-	}
-	else
-	{
-		uint16_t *d = (uint16_t*)screen->pixels + (screen->w - sourcesurface->w) / 2 + (screen->h - sourcesurface->h) * screen->pitch / 4;
-        uint16_t *s = (uint16_t*)sourcesurface->pixels;
-        for (int y = 0; y < sourcesurface->h; y++)
-        {
-            memmove(d, s, sourcesurface->w * sizeof(uint16_t));
-            s += sourcesurface->w;
-            d += screen->w;
-        }
+
+	hashesValid_ = true;
+	if (!changed && shown_) {
+		skipDraw_ = true;
+		return false;
 	}
+
+	partial_ = plain && scaleFn_ == &SdlBlitter::scaleEngine;
+	return true;
 }
 
 static int frames = 0;
@@ -719,8 +729,21 @@ void SdlBlitter::draw() {
 	if(firstframe >= 400){ //Ensure firstframe value stops counting at some point.
 		firstframe = -1;
 	}
+
+	if(skipDraw_){ //frame is already on screen
+		skipDraw_ = false;
+		skipPresent_ = true;
+		tracked_ = false;
+		return;
+	}
+	if(!tracked_){
+		invalidateLines();
+	}
+
+	TRACE_BEGIN("scale");
+	usec_t const scaleStart = perfHud_ ? perfHud_->start() : 0;
 	
-	if((ghosting == 0) || ((ghosting == 1) && (gameiscgb == 1)) || ((ghosting == 2) && (gameiscgb == 0))){ //Ghosting disabled for current system
+	if(ghostingOff()){ //Ghosting disabled for current system
 		if(showoverlay >= 0){
 			anim_textoverlay(surface);
 		}
@@ -730,20 +753,37 @@ void SdlBlitter::draw() {
 			anim_menuin(surface);
 		}
 		applyScalerToSurface(surface);
+		ghost_.reset();
 	} else if((ghosting == 3) || ((ghosting == 1) && (gameiscgb == 0)) || ((ghosting == 2) && (gameiscgb == 1))){ //Ghosting enabled for current system
 		if(showoverlay >= 0){
 			anim_textoverlay(surface);
 		}
-		blend_frames(surface);
-		store_lastframe(surface);
-		if(menuout >= 0){
-			anim_menuout(currframe);
-		}else if(menuin >= 0){
-			anim_menuin(currframe);
+		if((menuout >= 0) || (menuin >= 0)){ //menu animations draw over the blended frame, keep them out of the history
+			ghost_.setPersistence(ghostpersistence);
+			ghostToSurface(surface, currframe);
+			if(menuout >= 0){
+				anim_menuout(currframe);
+			}else{
+				anim_menuin(currframe);
+			}
+			applyScalerToSurface(currframe);
+		} else {
+			applyGhostedScalerToSurface(surface);
 		}
-		applyScalerToSurface(currframe);
 	}
+	if (perfHud_)
+		perfHud_->stop(PerfHud::time_scale, scaleStart);
+	TRACE_END("scale");
+
 	show_fps(screen, fps);
+
+	for (int y = 0; y < 144; ++y) {
+		if (lineStale_[y])
+			--lineStale_[y];
+	}
+
+	shown_ = true;
+	tracked_ = partial_ = false;
 }
 
 void SdlBlitter::scaleMenu() {
@@ -751,6 +791,8 @@ void SdlBlitter::scaleMenu() {
 	if (!screen || !menuscreen)
 		return;
 
+	invalidateLines();
+
 	if(gambatte_p->isCgb()){
 		if((colorfilter == 1) && (gameiscgb == 1)){
 			apply_cfilter(menuscreen);
@@ -765,6 +807,13 @@ void SdlBlitter::present() {
 	if (!screen)
 		return;
 
+	if (skipPresent_) {
+		skipPresent_ = false;
+		return;
+	}
+
+	TRACE_SCOPE("flip");
+	usec_t const start = perfHud_ ? perfHud_->start() : 0;
 	if (overlay_) {
 		SDL_Rect dstr = { 0, 0, Uint16(screen->w), Uint16(screen->h) };
 		SDL_UnlockYUVOverlay(overlay_.get());
@@ -774,6 +823,9 @@ void SdlBlitter::present() {
 		//SDL_UpdateRect(screen_, 0, 0, screen_->w, screen_->h);
 		SDL_Flip(screen);
 	}
+
+	if (perfHud_)
+		perfHud_->stop(PerfHud::time_present, start);
 }
 
 void SdlBlitter::toggleFullScreen() {
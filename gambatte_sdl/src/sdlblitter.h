@@ -25,9 +25,14 @@
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
 
+#include "../ghostblend.h"
+#include "../scalerengine.h"
+#include "array.h"
+#include "gbint.h"
 #include "scoped_ptr.h"
 #include <cstddef>
 
+class PerfHud;
 struct SDL_Overlay;
 struct SDL_Surface;
 
@@ -45,8 +50,24 @@ public:
 	           int scale, bool yuv, bool full);
 	~SdlBlitter();
 	PixelBuffer inBuffer() const;
+
+	/**
+	  * Takes the line hashes of the frame about to be drawn (GB::lineHashes),
+	  * or 0 if they are not known, and compares them with what the screen
+	  * buffers hold, so that draw() only scales the lines that changed.
+	  * With ghosting on, a line also counts as changed until its blend has
+	  * settled on the frame.
+	  * Returns false if the frame is the one on screen, in which case the
+	  * frame need not be converted and draw() and present() leave the screen
+	  * alone. Without a call before draw() everything is drawn.
+	  */
+	bool setLineHashes(gambatte::uint_least64_t const *lineHashes);
+
 	void draw();
 	void present();
+
+	/** Scaling and present times go to hud. */
+	void setPerfHud(PerfHud *hud) { perfHud_ = hud; }
 	void toggleFullScreen();
 	void CheckIPU();
 	void SetVid(int w, int h, int bpp);
@@ -63,12 +84,42 @@ public:
 
 private:
 	struct SurfaceDeleter;
+	typedef void (SdlBlitter::*ScaleFn)(SDL_Surface *sourcesurface);
+
 
-	
 	//scoped_ptr<SDL_Surface, SurfaceDeleter> const surface_;
 	scoped_ptr<SDL_Overlay, SurfaceDeleter> const overlay_;
+	ScalerEngine engine_;
+	GhostBlend ghost_;
+	ScaleFn scaleFn_;
+	std::string scalerName_;
+	Array<gambatte::uint_least64_t> lineHash_;
+	// number of screen buffers that do not have the current line yet
+	Array<unsigned char> lineStale_;
+	Array<unsigned char> rowsChanged_;
+	SDL_Surface *trackedScreen_;
+	bool hashesValid_;
+	// whether what is on screen went through ghosting
+	bool ghosted_;
+	bool tracked_;
+	bool shown_;
+	bool partial_;
+	bool skipDraw_;
+	bool skipPresent_;
+	PerfHud *perfHud_;
 
 	template<typename T> void swScale();
+	int screenBuffers() const;
+	void invalidateLines();
+	void selectScaler();
+	void scaleNone(SDL_Surface *sourcesurface);
+	void scaleCentered(SDL_Surface *sourcesurface);
+	void scale15xFast(SDL_Surface *sourcesurface);
+	void scaleFullScreenFast(SDL_Surface *sourcesurface);
+	void scaleEngine(SDL_Surface *sourcesurface);
+	void scaleEngineWith(SDL_Surface *sourcesurface, GhostBlend *ghost);
+	void ghostToSurface(SDL_Surface *sourcesurface, SDL_Surface *dst);
+	void applyGhostedScalerToSurface(SDL_Surface *sourcesurface);
 };
 
 extern SDL_Surface *borderimg;
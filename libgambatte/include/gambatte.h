@@ -21,8 +21,10 @@
 
 #include "gbint.h"
 #include "inputgetter.h"
+#include "linkcable.h"
 #include "loadres.h"
 #include <cstddef>
+#include <iosfwd>
 #include <string>
 
 namespace gambatte {
@@ -83,6 +85,108 @@ public:
 	std::ptrdiff_t runFor(gambatte::uint_least32_t *videoBuf, std::ptrdiff_t pitch,
 	                      gambatte::uint_least32_t *audioBuf, std::size_t &samples);
 
+	/**
+	  * Hashes of the 144 lines of the last video frame completed by runFor, taken
+	  * as each line is drawn. A line that hashes the same as in an earlier frame can
+	  * be taken as unchanged, so a frontend can skip scaling it, or skip presenting
+	  * a frame that did not change at all.
+	  *
+	  * @param hashes buffer with space for 144 hashes
+	  */
+	void lineHashes(gambatte::uint_least64_t *hashes) const;
+
+	/**
+	  * OAM DMA transfers completed since the GB was created. A transfer that
+	  * nothing accessed the bus for while it ran, e.g. one waited out in HRAM
+	  * as most games do, is copied in one go at its end rather than a byte at
+	  * a time as it is looked at.
+	  *
+	  * @param transfers set to the number of transfers
+	  * @param batched set to how many of them were copied in one go
+	  */
+	void oamDmaStats(unsigned long &transfers, unsigned long &batched) const;
+
+	/**
+	  * Memory accesses since the ROM was loaded that took the slow path: I/O
+	  * registers, and memory that is not mapped straight to a page, such as
+	  * VRAM and OAM, cartridge RAM with a clock or MBC registers. A game
+	  * doing a lot of them costs more per frame.
+	  *
+	  * These are the totals of the profile's per page counts, so only
+	  * libgambatte built with ENABLE_PROFILER (make PROFILE=YES, scons
+	  * profile=1) counts them; without it both are set to 0.
+	  *
+	  * @param reads set to the number of reads
+	  * @param writes set to the number of writes
+	  * @return false if the accesses are not counted
+	  */
+	bool slowAccessStats(unsigned long &reads, unsigned long &writes) const;
+
+	/** The CPU's program counter where the last runFor stopped. */
+	unsigned pc() const;
+
+	/** Whether the game has the LCD switched on (LCDC bit 7). */
+	bool lcdEnabled() const;
+
+	/**
+	  * The PPU draws background tiles from a cache of decoded tile rows, and
+	  * decodes a tile again only after a write to VRAM changed it. The hit rate
+	  * is about 1 - rowsDecoded / rowsDrawn.
+	  *
+	  * @param rowsDrawn set to the number of tile rows drawn since the ROM was loaded
+	  * @param rowsDecoded set to the number of tile rows decoded since then
+	  */
+	void tileCacheStats(unsigned long &rowsDrawn, unsigned long &rowsDecoded) const;
+
+	/**
+	  * Writes the execution profile of the loaded ROM to path: instructions
+	  * and cycles per ROM bank and PC, hottest first, then the reads and
+	  * writes per 256 byte page that took the slow memory path. Counting
+	  * starts over when a ROM is loaded.
+	  *
+	  * Only libgambatte built with ENABLE_PROFILER (make PROFILE=YES,
+	  * scons profile=1) keeps a profile; without it this returns false.
+	  *
+	  * @return false if there is no profile or it could not be written
+	  */
+	bool writeProfile(std::string const &path) const;
+
+	/**
+	  * Writes the last instructions the CPU ran to path, oldest first, with
+	  * the cycle counter and registers as each of them started.
+	  *
+	  * Only libgambatte built with ENABLE_CPU_TRACE (make CPUTRACE=YES,
+	  * scons cputrace=1) keeps the trace; without it this returns false.
+	  *
+	  * @return false if there is no trace or it could not be written
+	  */
+	bool writeCpuTrace(std::string const &path) const;
+
+	/**
+	  * Writes the CPU trace to path the first time the CPU runs the
+	  * instruction at pc, writes to writeAddress or, if rst38 is set, runs
+	  * opcode 0xFF, which is where running into open bus or erased memory
+	  * usually ends up. Pass -1 for pc or writeAddress to not watch it. The
+	  * triggers are disarmed once one fires; calling this again rearms them.
+	  * Does nothing without ENABLE_CPU_TRACE.
+	  */
+	void setCpuTraceTriggers(std::string const &path, long pc, long writeAddress, bool rst38);
+
+	enum MemoryArea {
+		WRAM, /**< 0xC000-0xDFFF, banks 0-7 of 0x1000 bytes each back to back in CGB mode. */
+		HRAM, /**< 0xFF80-0xFFFE. */
+		SRAM  /**< Cartridge RAM, banks of 0x2000 bytes back to back. */
+	};
+
+	/**
+	  * Direct access to an area of emulated RAM, e.g. for cheat searches.
+	  * Valid until the next load().
+	  *
+	  * @param length set to the size of the area in bytes
+	  * @return start of the area
+	  */
+	unsigned char * memoryArea(MemoryArea area, std::size_t &length);
+
 	/**
 	  * Reset to initial state.
 	  * Equivalent to reloading a ROM image, or turning a Game Boy Color off and on again.
@@ -100,6 +204,30 @@ public:
 	/** Sets the callback used for getting input state. */
 	void setInputGetter(InputGetter *getInput);
 
+	/**
+	  * With late latching the input getter is called when the game first reads
+	  * the joypad register in a frame, and that state is kept until the frame
+	  * ends. A game that does not read it gets the state sampled at the end of
+	  * the frame. Without it (the default) the getter is called on every read
+	  * and on every write selecting a button group.
+	  */
+	void setLateInputLatch(bool enable);
+
+	/**
+	  * Plugs a link cable into the serial port, or unplugs it with 0. Without
+	  * one a transfer clocked by this GB shifts in 0xFF and one waiting for the
+	  * other end to clock it never completes.
+	  */
+	void setLinkCable(LinkCable *cable);
+
+	/**
+	  * The other end of the link cable clocks a transfer of data into this GB.
+	  * If the game is waiting for an externally clocked transfer it gets data
+	  * and a serial interrupt, and the byte it was sending is returned.
+	  * Otherwise nothing happens and 0xFF is returned.
+	  */
+	unsigned linkTransfer(unsigned data);
+
 	/** Sets the callback used for getting the bootloader data. */
 	void setBootloaderGetter(bool (*getter)(void *userdata, bool isgbc, uint8_t *data, uint32_t buf_size));
 	void full_init();
@@ -162,6 +290,20 @@ public:
 	  */
 	bool loadState(std::string const &filepath);
 
+	/**
+	  * Saves emulator state to stream, without a thumbnail. Cheap enough to
+	  * do every frame, e.g. to roll back to.
+	  * @return success
+	  */
+	bool saveState(std::ostream &stream);
+
+	/**
+	  * Loads emulator state saved by saveState(std::ostream &). Unlike the
+	  * other loadState variants this does not write the save data to disk first.
+	  * @return success
+	  */
+	bool loadState(std::istream &stream);
+
 	/**
 	  * Selects which state slot to save state to or load state from.
 	  * There are 10 such slots, numbered from 0 to 9 (periodically extended for all n).
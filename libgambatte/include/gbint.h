@@ -24,6 +24,7 @@
 #include <cstdint>
 
 namespace gambatte {
+using std::uint_least64_t;
 using std::uint_least32_t;
 using std::uint_least16_t;
 }
@@ -33,6 +34,7 @@ using std::uint_least16_t;
 #include <stdint.h>
 
 namespace gambatte {
+using ::uint_least64_t;
 using ::uint_least32_t;
 using ::uint_least16_t;
 }
@@ -40,6 +42,8 @@ using ::uint_least16_t;
 #else
 
 namespace gambatte {
+typedef unsigned long long uint_least64_t;
+
 #ifdef CHAR_LEAST_32
 typedef unsigned char uint_least32_t;
 #elif defined(SHORT_LEAST_32)
@@ -0,0 +1,25 @@
+#ifndef GAMBATTE_LINKCABLE_H
+#define GAMBATTE_LINKCABLE_H
+
+namespace gambatte {
+
+/**
+  * The other end of the link cable plugged into a GB with GB::setLinkCable.
+  * Two GBs run in the same process are linked by giving each a LinkCable
+  * whose exchange() calls GB::linkTransfer on the other.
+  */
+class LinkCable {
+public:
+	virtual ~LinkCable() {}
+
+	/**
+	  * Called when a transfer clocked by this GB completes, with the byte it
+	  * shifted out. Returns the byte shifted in from the other end, 0xFF if
+	  * nothing answers.
+	  */
+	virtual unsigned exchange(unsigned data) = 0;
+};
+
+}
+
+#endif
@@ -80,6 +80,22 @@ static inline unsigned  zfFromF(unsigned f) { return ~f & 0x80; }
 static inline unsigned hf2FromF(unsigned f) { return f << 4 & (hf2_subf | hf2_hcf); }
 static inline unsigned  cfFromF(unsigned f) { return f << 4 & 0x100; }
 
+#ifdef ENABLE_CPU_TRACE
+void CPU::traceInstruction(unsigned const pc, unsigned const opcode, unsigned const a, unsigned long const cc) {
+	CpuTrace::Entry &entry = trace_.next();
+	entry.cc = cc;
+	entry.pc = pc;
+	entry.bc = b << 8 | c;
+	entry.de = d << 8 | e;
+	entry.hl = h << 8 | l;
+	entry.sp = sp;
+	entry.opcode = opcode;
+	entry.a = a;
+	entry.f = toF(updateHf2FromHf1(hf1, hf2), cf, zf);
+	trace_.executed(entry);
+}
+#endif
+
 void CPU::setStatePtrs(SaveState &state) {
 	mem_.setStatePtrs(state);
 }
@@ -134,8 +150,14 @@ void CPU::loadState(SaveState const &state) {
 #define PC_READ(dest) do { (dest) = mem_.read(pc, cycleCounter); pc = (pc + 1) & 0xFFFF; cycleCounter += 4; } while (0)
 #define FF_READ(dest, addr) do { (dest) = mem_.ff_read(addr, cycleCounter); cycleCounter += 4; } while (0)
 
-#define WRITE(addr, data) do { mem_.write(addr, data, cycleCounter); cycleCounter += 4; } while (0)
-#define FF_WRITE(addr, data) do { mem_.ff_write(addr, data, cycleCounter); cycleCounter += 4; } while (0)
+#ifdef ENABLE_CPU_TRACE
+#define TRACE_WRITE(addr) trace_.written(addr)
+#else
+#define TRACE_WRITE(addr) ((void)0)
+#endif
+
+#define WRITE(addr, data) do { TRACE_WRITE(addr); mem_.write(addr, data, cycleCounter); cycleCounter += 4; } while (0)
+#define FF_WRITE(addr, data) do { TRACE_WRITE(0xFF00 | (addr)); mem_.ff_write(addr, data, cycleCounter); cycleCounter += 4; } while (0)
 
 #define PC_MOD(data) do { pc = data; cycleCounter += 4; } while (0)
 
@@ -504,6 +526,13 @@ void CPU::process(unsigned long const cycles) {
 		} else while (cycleCounter < mem_.nextEventTime()) {
 			unsigned char opcode;
 
+#ifdef ENABLE_PROFILER
+			mem_.profileInstruction(pc, cycleCounter);
+#endif
+#ifdef ENABLE_CPU_TRACE
+			unsigned const tracePc = pc;
+			unsigned long const traceCc = cycleCounter;
+#endif
 			PC_READ(opcode);
 
 			if (skip_) {
@@ -511,6 +540,10 @@ void CPU::process(unsigned long const cycles) {
 				skip_ = false;
 			}
 
+#ifdef ENABLE_CPU_TRACE
+			traceInstruction(tracePc, opcode, a, traceCc);
+#endif
+
 			switch (opcode) {
 			case 0x00:
 				break;
@@ -19,6 +19,7 @@
 #ifndef CPU_H
 #define CPU_H
 
+#include "cputrace.h"
 #include "memory.h"
 
 namespace gambatte {
@@ -37,10 +38,43 @@ public:
 		mem_.setVideoBuffer(videoBuf, pitch);
 	}
 
+	uint_least64_t const * lineHashes() const { return mem_.lineHashes(); }
+	unsigned long oamDmaTransfers() const { return mem_.oamDmaTransfers(); }
+	unsigned long oamDmaBatched() const { return mem_.oamDmaBatched(); }
+	unsigned pc() const { return pc_; }
+	bool lcdEnabled() const { return mem_.lcdEnabled(); }
+	void tileCacheStats(unsigned long &rowsDrawn, unsigned long &rowsDecoded) const {
+		mem_.tileCacheStats(rowsDrawn, rowsDecoded);
+	}
+
+#ifdef ENABLE_PROFILER
+	bool writeProfile(char const *path) const { return mem_.writeProfile(path); }
+	void slowAccesses(unsigned long &reads, unsigned long &writes) const {
+		mem_.slowAccesses(reads, writes);
+	}
+#endif
+#ifdef ENABLE_CPU_TRACE
+	bool writeCpuTrace(char const *path) const { return trace_.write(path); }
+
+	void setCpuTraceTriggers(std::string const &path, long pc, long writeAddress, bool rst38) {
+		trace_.setTriggers(path, pc, writeAddress, rst38);
+	}
+#endif
+
+	unsigned char * wramdata() const { return mem_.wramdata(); }
+	unsigned char * wramdataend() const { return mem_.wramdataend(); }
+	unsigned char * sramdata() const { return mem_.sramdata(); }
+	unsigned char * sramdataend() const { return mem_.sramdataend(); }
+	unsigned char * hramdata() { return mem_.hramdata(); }
+
 	void setInputGetter(InputGetter *getInput) {
 		mem_.setInputGetter(getInput);
 	}
 
+	void setLateInputLatch(bool enable) { mem_.setLateInputLatch(enable); }
+	void setLinkCable(LinkCable *cable) { mem_.setLinkCable(cable); }
+	unsigned linkTransfer(unsigned data) { return mem_.linkTransfer(data); }
+
 	void setSaveDir(std::string const &sdir) {
 		mem_.setSaveDir(sdir);
 	}
@@ -86,6 +120,11 @@ private:
 	unsigned hf1, hf2, zf, cf;
 	unsigned char a_, b, c, d, e, /*f,*/ h, l;
 	bool skip_;
+#ifdef ENABLE_CPU_TRACE
+	CpuTrace trace_;
+
+	void traceInstruction(unsigned pc, unsigned opcode, unsigned a, unsigned long cc);
+#endif
 
 	void process(unsigned long cycles);
 };
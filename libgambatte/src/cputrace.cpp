@@ -0,0 +1,63 @@
+#include "cputrace.h"
+
+#ifdef ENABLE_CPU_TRACE
+
+#include <cstdio>
+
+namespace {
+
+unsigned long watched(long const address) {
+	return address >= 0 && address <= 0xFFFF ? address : -1ul;
+}
+
+}
+
+namespace gambatte {
+
+CpuTrace::CpuTrace()
+: count_(0)
+, triggerPc_(-1ul)
+, triggerWrite_(-1ul)
+, triggerRst38_(false)
+{
+}
+
+void CpuTrace::setTriggers(std::string const &path, long const pc, long const writeAddress, bool const rst38) {
+	triggerPath_ = path;
+	triggerPc_ = watched(pc);
+	triggerWrite_ = watched(writeAddress);
+	triggerRst38_ = rst38;
+}
+
+void CpuTrace::fire(char const *const reason) {
+	triggerPc_ = triggerWrite_ = -1ul;
+	triggerRst38_ = false;
+	if (write(triggerPath_.c_str(), reason))
+		std::printf("cpu trace: %s trigger fired, written to %s\n", reason, triggerPath_.c_str());
+}
+
+bool CpuTrace::write(char const *const path, char const *const reason) const {
+	std::FILE *const file = std::fopen(path, "w");
+	if (!file)
+		return false;
+
+	if (reason)
+		std::fprintf(file, "# %s trigger fired on the last instruction\n", reason);
+
+	std::fputs("# registers as each instruction started, oldest first\n"
+	           "#      cycle   pc op  a  f   bc   de   hl   sp\n", file);
+	unsigned long const count = count_ < unsigned(ring_size) ? count_ : unsigned(ring_size);
+	for (unsigned long n = count_ - count; n != count_; ++n) {
+		Entry const &e = ring_[n % ring_size];
+		std::fprintf(file, "%12lu %04X %02X %02X %02X %04X %04X %04X %04X\n",
+		             e.cc, e.pc, e.opcode, e.a, e.f, e.bc, e.de, e.hl, e.sp);
+	}
+
+	bool const ok = !std::ferror(file);
+	std::fclose(file);
+	return ok;
+}
+
+}
+
+#endif
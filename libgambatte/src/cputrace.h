@@ -0,0 +1,69 @@
+#ifndef CPUTRACE_H
+#define CPUTRACE_H
+
+// The last instructions the CPU ran, for finding out how a game got to where
+// it crashed. Built with -DENABLE_CPU_TRACE (make CPUTRACE=YES,
+// scons cputrace=1), CPU::process records every instruction with its
+// registers into a ring that keeps the newest CpuTrace::ring_size, and
+// writes the ring out on request or when a trigger fires. Without
+// ENABLE_CPU_TRACE none of it is compiled in.
+
+#ifdef ENABLE_CPU_TRACE
+
+#include <string>
+
+namespace gambatte {
+
+class CpuTrace {
+public:
+	enum { ring_size = 1 << 16 };
+
+	struct Entry {
+		unsigned long cc;
+		unsigned short pc, bc, de, hl, sp;
+		unsigned char opcode, a, f;
+	};
+
+	CpuTrace();
+
+	/**
+	  * The entry to fill in for the next instruction. The caller fills it in
+	  * and then checks the PC and opcode triggers with executed().
+	  */
+	Entry & next() { return ring_[count_++ % ring_size]; }
+
+	void executed(Entry const &e) {
+		if (e.pc == triggerPc_ || (e.opcode == 0xFF && triggerRst38_))
+			fire(e.opcode == 0xFF && triggerRst38_ ? "rst 38h" : "pc");
+	}
+
+	void written(unsigned p) {
+		if (p == triggerWrite_)
+			fire("write");
+	}
+
+	/**
+	  * Writes the ring to path the first time one of the triggers fires.
+	  * pc and writeAddress are ignored when outside [0, 0xFFFF].
+	  */
+	void setTriggers(std::string const &path, long pc, long writeAddress, bool rst38);
+
+	/** Writes the ring to path, oldest first. Returns false if it could not be written. */
+	bool write(char const *path, char const *reason = 0) const;
+
+private:
+	Entry ring_[ring_size];
+	unsigned long count_;
+	std::string triggerPath_;
+	unsigned long triggerPc_;
+	unsigned long triggerWrite_;
+	bool triggerRst38_;
+
+	void fire(char const *reason);
+};
+
+}
+
+#endif
+
+#endif
@@ -23,6 +23,8 @@
 #include "state_osd_elements.h"
 #include "statesaver.h"
 #include "bootloader.h"
+#include "trace.h"
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <stdio.h>
@@ -65,6 +67,7 @@ std::string GB::getSaveStatePath(int statenum){
 
 std::ptrdiff_t GB::runFor(gambatte::uint_least32_t *const videoBuf, std::ptrdiff_t const pitch,
                           gambatte::uint_least32_t *const soundBuf, std::size_t &samples) {
+	TRACE_SCOPE("runFor");
 	if (!p_->cpu.loaded()) {
 		samples = 0;
 		return -1;
@@ -80,6 +83,83 @@ std::ptrdiff_t GB::runFor(gambatte::uint_least32_t *const videoBuf, std::ptrdiff
 	     : cyclesSinceBlit;
 }
 
+void GB::lineHashes(gambatte::uint_least64_t *const hashes) const {
+	std::copy(p_->cpu.lineHashes(), p_->cpu.lineHashes() + 144, hashes);
+}
+
+void GB::oamDmaStats(unsigned long &transfers, unsigned long &batched) const {
+	transfers = p_->cpu.oamDmaTransfers();
+	batched = p_->cpu.oamDmaBatched();
+}
+
+bool GB::slowAccessStats(unsigned long &reads, unsigned long &writes) const {
+#ifdef ENABLE_PROFILER
+	p_->cpu.slowAccesses(reads, writes);
+	return true;
+#else
+	reads = writes = 0;
+	return false;
+#endif
+}
+
+unsigned GB::pc() const {
+	return p_->cpu.pc();
+}
+
+bool GB::lcdEnabled() const {
+	return p_->cpu.lcdEnabled();
+}
+
+void GB::tileCacheStats(unsigned long &rowsDrawn, unsigned long &rowsDecoded) const {
+	p_->cpu.tileCacheStats(rowsDrawn, rowsDecoded);
+}
+
+bool GB::writeProfile(std::string const &path) const {
+#ifdef ENABLE_PROFILER
+	return p_->cpu.writeProfile(path.c_str());
+#else
+	(void)path;
+	return false;
+#endif
+}
+
+bool GB::writeCpuTrace(std::string const &path) const {
+#ifdef ENABLE_CPU_TRACE
+	return p_->cpu.writeCpuTrace(path.c_str());
+#else
+	(void)path;
+	return false;
+#endif
+}
+
+void GB::setCpuTraceTriggers(std::string const &path, long pc, long writeAddress, bool rst38) {
+#ifdef ENABLE_CPU_TRACE
+	p_->cpu.setCpuTraceTriggers(path, pc, writeAddress, rst38);
+#else
+	(void)path;
+	(void)pc;
+	(void)writeAddress;
+	(void)rst38;
+#endif
+}
+
+unsigned char * GB::memoryArea(MemoryArea const area, std::size_t &length) {
+	switch (area) {
+	case WRAM:
+		length = p_->cpu.wramdataend() - p_->cpu.wramdata();
+		return p_->cpu.wramdata();
+	case HRAM:
+		length = 0x7F;
+		return p_->cpu.hramdata();
+	case SRAM:
+		length = p_->cpu.sramdataend() - p_->cpu.sramdata();
+		return p_->cpu.sramdata();
+	}
+
+	length = 0;
+	return 0;
+}
+
 void GB::Priv::full_init() {
 
 	SaveState state;
@@ -124,6 +204,18 @@ void GB::setInputGetter(InputGetter *getInput) {
 	p_->cpu.setInputGetter(getInput);
 }
 
+void GB::setLateInputLatch(bool const enable) {
+	p_->cpu.setLateInputLatch(enable);
+}
+
+void GB::setLinkCable(LinkCable *const cable) {
+	p_->cpu.setLinkCable(cable);
+}
+
+unsigned GB::linkTransfer(unsigned const data) {
+	return p_->cpu.linkTransfer(data);
+}
+
 void GB::setBootloaderGetter(bool (*getter)(void* userdata, bool isgbc, uint8_t* data, uint32_t max_size)) {
    p_->cpu.mem_.bootloader.set_bootloader_getter(getter);
 }
@@ -180,6 +272,7 @@ void GB::setColorFilter(int activated, int filtercolors[12]) {
 }
 
 bool GB::loadState(std::string const &filepath) {
+	TRACE_SCOPE("loadState");
 	if (p_->cpu.loaded()) {
 		p_->cpu.saveSavedata();
 
@@ -232,6 +325,7 @@ bool GB::loadState_NoOsd() {
 
 bool GB::saveState(gambatte::uint_least32_t const *videoBuf, std::ptrdiff_t pitch,
                    std::string const &filepath) {
+	TRACE_SCOPE("saveState");
 	if (p_->cpu.loaded()) {
 		SaveState state;
 		p_->cpu.setStatePtrs(state);
@@ -242,6 +336,33 @@ bool GB::saveState(gambatte::uint_least32_t const *videoBuf, std::ptrdiff_t pitc
 	return false;
 }
 
+bool GB::saveState(std::ostream &stream) {
+	if (p_->cpu.loaded()) {
+		// zeroed so that equal states give equal bytes, whatever the MBC leaves unset.
+		SaveState state = SaveState();
+		p_->cpu.setStatePtrs(state);
+		p_->cpu.saveState(state);
+		return StateSaver::saveState(state, 0, 0, stream);
+	}
+
+	return false;
+}
+
+bool GB::loadState(std::istream &stream) {
+	if (p_->cpu.loaded()) {
+		SaveState state;
+		p_->cpu.setStatePtrs(state);
+
+		if (StateSaver::loadState(state, stream)) {
+			p_->cpu.loadState(state);
+			p_->cpu.mem_.bootloader.choosebank(state.mem.ioamhram.get()[0x150] != 0xFF);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void GB::selectState(int n) {
 	n -= (n / 10) * 10;
 	p_->stateNo = n < 0 ? n + 10 : n;
@@ -18,25 +18,35 @@
 
 #include "memory.h"
 #include "inputgetter.h"
+#include "linkcable.h"
 #include "savestate.h"
 #include "sound.h"
 #include "video.h"
 #include "bootloader.h"
+#include "trace.h"
+#include <algorithm>
 #include <cstring>
 
 namespace gambatte {
 
 Memory::Memory(Interrupter const &interrupter)
 : getInput_(0)
+, linkCable_(0)
 , divLastUpdate_(0)
 , lastOamDmaUpdate_(disabled_time)
 , lcd_(ioamhram_, 0, VideoInterruptRequester(intreq_))
 , interrupter_(interrupter)
 , dmaSource_(0)
 , dmaDestination_(0)
+, oamDmaTransfers_(0)
+, oamDmaBatched_(0)
 , oamDmaPos_(0xFE)
 , serialCnt_(0)
+, latchedInput_(0)
 , blanklcd_(false)
+, oamDmaSplit_(false)
+, lateInputLatch_(false)
+, inputLatched_(false)
 {
 	intreq_.setEventTime<intevent_blit>(144 * 456ul);
 	intreq_.setEventTime<intevent_end>(0);
@@ -93,6 +103,8 @@ void Memory::loadState(SaveState const &state) {
 	dmaSource_ = state.mem.dmaSource;
 	dmaDestination_ = state.mem.dmaDestination;
 	oamDmaPos_ = state.mem.oamDmaPos;
+	oamDmaSplit_ = true;
+	inputLatched_ = false;
 	serialCnt_ = intreq_.eventTime(intevent_serial) != disabled_time
 	           ? serialCntFrom(intreq_.eventTime(intevent_serial) - state.cpu.cycleCounter,
 	                           ioamhram_[0x102] & isCgb() * 2)
@@ -119,6 +131,11 @@ void Memory::loadState(SaveState const &state) {
 		std::memset(cart_.vramdata() + 0x2000, 0, 0x2000);
 }
 
+void Memory::tileCacheStats(unsigned long &rowsDrawn, unsigned long &rowsDecoded) const {
+	rowsDrawn = lcd_.tileCache().rowsDrawn();
+	rowsDecoded = lcd_.tileCache().rowsDecoded();
+}
+
 void Memory::setEndtime(unsigned long cc, unsigned long inc) {
 	if (intreq_.eventTime(intevent_blit) <= cc) {
 		intreq_.setEventTime<intevent_blit>(intreq_.eventTime(intevent_blit)
@@ -131,11 +148,15 @@ void Memory::setEndtime(unsigned long cc, unsigned long inc) {
 void Memory::updateSerial(unsigned long const cc) {
 	if (intreq_.eventTime(intevent_serial) != disabled_time) {
 		if (intreq_.eventTime(intevent_serial) <= cc) {
-			ioamhram_[0x101] = (((ioamhram_[0x101] + 1) << serialCnt_) - 1) & 0xFF;
+			ioamhram_[0x101] = linkCable_
+			                 ? linkCable_->exchange(ioamhram_[0x101]) & 0xFF
+			                 : (((ioamhram_[0x101] + 1) << serialCnt_) - 1) & 0xFF;
 			ioamhram_[0x102] &= 0x7F;
 			intreq_.setEventTime<intevent_serial>(disabled_time);
 			intreq_.flagIrq(8);
-		} else {
+		} else if (!linkCable_) {
+			// with a cable the byte going out stays in SB until the transfer
+			// completes, which keeps it in save states taken half way.
 			int const targetCnt = serialCntFrom(intreq_.eventTime(intevent_serial) - cc,
 			                                    ioamhram_[0x102] & isCgb() * 2);
 			ioamhram_[0x101] = (((ioamhram_[0x101] + 1) << (serialCnt_ - targetCnt)) - 1) & 0xFF;
@@ -144,6 +165,17 @@ void Memory::updateSerial(unsigned long const cc) {
 	}
 }
 
+unsigned Memory::linkTransfer(unsigned const data) {
+	if ((ioamhram_[0x102] & 0x81) != 0x80)
+		return 0xFF;
+
+	unsigned const out = ioamhram_[0x101];
+	ioamhram_[0x101] = data & 0xFF;
+	ioamhram_[0x102] &= 0x7F;
+	intreq_.flagIrq(8);
+	return out;
+}
+
 void Memory::updateTimaIrq(unsigned long cc) {
 	while (intreq_.eventTime(intevent_tima) <= cc)
 		tima_.doIrqEvent(TimaInterruptRequester(intreq_));
@@ -156,8 +188,12 @@ void Memory::updateIrqs(unsigned long cc) {
 }
 
 unsigned long Memory::event(unsigned long cc) {
-	if (lastOamDmaUpdate_ != disabled_time)
+	// Nothing but DMA sees OAM DMA progress between its start and end events,
+	// anything else that could is a memory access that catches up by itself.
+	if (lastOamDmaUpdate_ != disabled_time
+			&& (cc + 1 >= intreq_.eventTime(intevent_oam) || intreq_.minEventId() == intevent_dma)) {
 		updateOamDma(cc);
+	}
 
 	switch (intreq_.minEventId()) {
 	case intevent_unhalt:
@@ -177,10 +213,18 @@ unsigned long Memory::event(unsigned long cc) {
 		break;
 	case intevent_blit:
 		{
+			// latch for games that did not read P1 this frame, so that one
+			// waiting on the joypad interrupt still sees the press.
+			if (lateInputLatch_ && !inputLatched_)
+				latchInput();
+
+			inputLatched_ = false;
+
 			bool const lcden = ioamhram_[0x140] & lcdc_en;
 			unsigned long blitTime = intreq_.eventTime(intevent_blit);
 
 			if (lcden | blanklcd_) {
+				TRACE_INSTANT("blit");
 				lcd_.updateScreen(blanklcd_, cc);
 				intreq_.setEventTime<intevent_blit>(disabled_time);
 				intreq_.setEventTime<intevent_end>(disabled_time);
@@ -226,6 +270,12 @@ unsigned long Memory::event(unsigned long cc) {
 				unsigned long lOamDmaUpdate = lastOamDmaUpdate_;
 				lastOamDmaUpdate_ = disabled_time;
 
+				if (lOamDmaUpdate == disabled_time && bulkDma(dmaSrc, dmaDest, length, cc)) {
+					dmaSrc += length;
+					dmaDest += length;
+					length = 0;
+				}
+
 				while (length--) {
 					unsigned const src = dmaSrc++ & 0xFFFF;
 					unsigned const data = (src & 0xE000) == 0x8000 || src > 0xFDFF
@@ -244,6 +294,7 @@ unsigned long Memory::event(unsigned long cc) {
 
 							ioamhram_[src & 0xFF] = data;
 						} else if (oamDmaPos_ == 0xA0) {
+							++oamDmaTransfers_;
 							endOamDma(lOamDmaUpdate - 1);
 							lOamDmaUpdate = disabled_time;
 						}
@@ -371,11 +422,16 @@ unsigned long Memory::resetCounters(unsigned long cc) {
 	return cc;
 }
 
+void Memory::latchInput() {
+	latchedInput_ = getInput_ ? (*getInput_)() : 0;
+	inputLatched_ = true;
+}
+
 void Memory::updateInput() {
 	unsigned state = 0xF;
 
 	if ((ioamhram_[0x100] & 0x30) != 0x30 && getInput_) {
-		unsigned input = (*getInput_)();
+		unsigned input = lateInputLatch_ ? latchedInput_ : (*getInput_)();
 		unsigned dpad_state = ~input >> 4;
 		unsigned button_state = ~input;
 		if (!(ioamhram_[0x100] & 0x10))
@@ -390,25 +446,51 @@ void Memory::updateInput() {
 	ioamhram_[0x100] = (ioamhram_[0x100] & -0x10u) | state;
 }
 
+// Catches up with OAM DMA, copying every byte due by cc at once.
 void Memory::updateOamDma(unsigned long const cc) {
 	unsigned char const *const oamDmaSrc = oamDmaSrcPtr();
 	unsigned cycles = (cc - lastOamDmaUpdate_) >> 2;
 
-	while (cycles--) {
-		oamDmaPos_ = (oamDmaPos_ + 1) & 0xFF;
-		lastOamDmaUpdate_ += 4;
+	while (cycles) {
+		unsigned const pos = (oamDmaPos_ + 1) & 0xFF;
+		if (pos >= 0xA0) {
+			oamDmaPos_ = pos;
+			lastOamDmaUpdate_ += 4;
+			--cycles;
+
+			if (pos == 0xA0) {
+				++oamDmaTransfers_;
+				oamDmaBatched_ += !oamDmaSplit_;
+				endOamDma(lastOamDmaUpdate_ - 1);
+				lastOamDmaUpdate_ = disabled_time;
+				break;
+			}
 
-		if (oamDmaPos_ < 0xA0) {
-			if (oamDmaPos_ == 0)
-				startOamDma(lastOamDmaUpdate_ - 1);
+			continue;
+		}
 
-			ioamhram_[oamDmaPos_] = oamDmaSrc ? oamDmaSrc[oamDmaPos_] : cart_.rtcRead();
-		} else if (oamDmaPos_ == 0xA0) {
-			endOamDma(lastOamDmaUpdate_ - 1);
-			lastOamDmaUpdate_ = disabled_time;
-			break;
+		if (pos == 0) {
+			oamDmaSplit_ = false;
+			startOamDma(lastOamDmaUpdate_ + 3);
+		}
+
+		unsigned const n = std::min(cycles, 0xA0 - pos);
+		if (oamDmaSrc) {
+			std::memcpy(ioamhram_ + pos, oamDmaSrc + pos, n);
+		} else {
+			for (unsigned i = pos; i < pos + n; ++i)
+				ioamhram_[i] = cart_.rtcRead();
 		}
+
+		oamDmaPos_ = pos + n - 1;
+		lastOamDmaUpdate_ += n * 4;
+		cycles -= n;
 	}
+
+	// something looked at the transfer half way through, whether or not this
+	// catch-up is the one that started it.
+	if (oamDmaPos_ < 0x9F)
+		oamDmaSplit_ = true;
 }
 
 void Memory::oamDmaInitSetup() {
@@ -420,6 +502,39 @@ void Memory::oamDmaInitSetup() {
 		cart_.setOamDmaSrc(oam_dma_src_invalid);
 }
 
+// Does a whole GDMA/HDMA transfer at once when none of the byte by byte
+// work of the event loop could make a difference: every source byte reads
+// without side effects, and VRAM stays accessible from the first write to
+// the last. Returns false, having done nothing, otherwise.
+bool Memory::bulkDma(unsigned const src, unsigned const dest, unsigned const length,
+                     unsigned long &cc) {
+	unsigned char data[0x800];
+	for (unsigned i = 0; i < length; ++i) {
+		unsigned const p = (src + i) & 0xFFFF;
+		if ((p & 0xE000) == 0x8000 || p > 0xFDFF)
+			data[i] = 0xFF;
+		else if (unsigned char const *const mem = cart_.rmem(p >> 12))
+			data[i] = mem[p];
+		else
+			return false;
+	}
+
+	unsigned long const byteTime = 2 << isDoubleSpeed();
+	unsigned long const end = cc + length * byteTime;
+	if (!lcd_.vramAccessibleThrough(cc + byteTime, end))
+		return false;
+
+	unsigned char *const vram = cart_.vrambankptr() + 0x8000;
+	unsigned const bankOffset = vram - cart_.vramdata();
+	unsigned const first = std::min(length, 0x2000 - (dest & 0x1FFF));
+	lcd_.vramChange(end, bankOffset + (dest & 0x1FFF), first);
+	lcd_.vramChange(end, bankOffset, length - first);
+	std::memcpy(vram + (dest & 0x1FFF), data, first);
+	std::memcpy(vram, data + first, length - first);
+	cc = end;
+	return true;
+}
+
 static unsigned char const * oamDmaSrcZero() {
 	static unsigned char zeroMem[0xA0];
 	return zeroMem;
@@ -459,6 +574,9 @@ unsigned Memory::nontrivial_ff_read(unsigned const p, unsigned long const cc) {
 
 	switch (p) {
 	case 0x00:
+		if (lateInputLatch_ && !inputLatched_)
+			latchInput();
+
 		updateInput();
 		break;
 	case 0x01:
@@ -1032,7 +1150,7 @@ void Memory::nontrivial_write(unsigned const p, unsigned const data, unsigned lo
 			if (p < 0x8000) {
 				cart_.mbcWrite(p, data);
 			} else if (lcd_.vramAccessible(cc)) {
-				lcd_.vramChange(cc);
+				lcd_.vramChange(cc, cart_.vrambankptr() + p - cart_.vramdata(), 1);
 				cart_.vrambankptr()[p] = data;
 			}
 		} else if (p < 0xC000) {
@@ -1062,6 +1180,9 @@ LoadRes Memory::loadROM(std::string const &romfile, bool const forceDmg, bool co
 	psg_.init(cart_.isCgb());
 	lcd_.reset(ioamhram_, cart_.vramdata(), cart_.isCgb());
 	interrupter_.setGameShark(std::string());
+#ifdef ENABLE_PROFILER
+	profiler_.reset(cart_.romdataend() - cart_.romdata());
+#endif
 
 	return LOADRES_OK;
 }
@@ -23,6 +23,7 @@
 #include "interrupter.h"
 #include "bootloader.h"
 #include "pakinfo.h"
+#include "profiler.h"
 #include "sound.h"
 #include "tima.h"
 #include "video.h"
@@ -31,6 +32,7 @@ namespace gambatte {
 
 class InputGetter;
 class FilterInfo;
+class LinkCable;
 
 class Memory {
 public:
@@ -70,32 +72,70 @@ public:
 	void di() { intreq_.di(); }
 
 	unsigned ff_read(unsigned p, unsigned long cc) {
-		return p < 0x80 ? nontrivial_ff_read(p, cc) : ioamhram_[p + 0x100];
+		if (p < 0x80) {
+#ifdef ENABLE_PROFILER
+			profiler_.slowRead(0xFF00 | p);
+#endif
+			return nontrivial_ff_read(p, cc);
+		}
+
+		return ioamhram_[p + 0x100];
 	}
 
 	unsigned read(unsigned p, unsigned long cc) {
-		return cart_.rmem(p >> 12) ? cart_.rmem(p >> 12)[p] : nontrivial_read(p, cc);
+		if (cart_.rmem(p >> 12))
+			return cart_.rmem(p >> 12)[p];
+
+#ifdef ENABLE_PROFILER
+		profiler_.slowRead(p);
+#endif
+		return nontrivial_read(p, cc);
 	}
 
 	void write(unsigned p, unsigned data, unsigned long cc) {
 		if (cart_.wmem(p >> 12)) {
 			cart_.wmem(p >> 12)[p] = data;
-		} else
+		} else {
+#ifdef ENABLE_PROFILER
+			profiler_.slowWrite(p);
+#endif
 			nontrivial_write(p, data, cc);
+		}
 	}
 
 	void ff_write(unsigned p, unsigned data, unsigned long cc) {
 		if (p - 0x80u < 0x7Fu) {
 			ioamhram_[p + 0x100] = data;
-		} else
+		} else {
+#ifdef ENABLE_PROFILER
+			profiler_.slowWrite(0xFF00 | p);
+#endif
 			nontrivial_ff_write(p, data, cc);
+		}
 	}
 
+#ifdef ENABLE_PROFILER
+	void profileInstruction(unsigned pc, unsigned long cc) {
+		// not rmem, which OAM DMA disconnects while the CPU may still run from ROM.
+		profiler_.instruction(pc < 0x8000
+			? cart_.romdata(pc >> 14) + pc - cart_.romdata()
+			: cart_.romdataend() - cart_.romdata() + pc - 0x8000, cc);
+	}
+
+	bool writeProfile(char const *path) const { return profiler_.write(path); }
+	void slowAccesses(unsigned long &reads, unsigned long &writes) const {
+		profiler_.slowAccesses(reads, writes);
+	}
+#endif
+
 	unsigned long event(unsigned long cycleCounter);
 	unsigned long resetCounters(unsigned long cycleCounter);
 	LoadRes loadROM(std::string const &romfile, bool forceDmg, bool multicartCompat, int preferCGB);
 	void setSaveDir(std::string const &dir) { cart_.setSaveDir(dir); }
 	void setInputGetter(InputGetter *getInput) { getInput_ = getInput; }
+	void setLateInputLatch(bool enable) { lateInputLatch_ = enable; inputLatched_ = false; }
+	void setLinkCable(LinkCable *cable) { linkCable_ = cable; }
+	unsigned linkTransfer(unsigned data);
 	void setEndtime(unsigned long cc, unsigned long inc);
 	void setSoundBuffer(uint_least32_t *buf) { psg_.setBuffer(buf); }
 	std::size_t fillSoundBuffer(unsigned long cc);
@@ -104,6 +144,17 @@ public:
 		lcd_.setVideoBuffer(videoBuf, pitch);
 	}
 
+	uint_least64_t const * lineHashes() const { return lcd_.lineHashes(); }
+	unsigned long oamDmaTransfers() const { return oamDmaTransfers_; }
+	unsigned long oamDmaBatched() const { return oamDmaBatched_; }
+	bool lcdEnabled() const { return ioamhram_[0x140] & lcdc_en; }
+	void tileCacheStats(unsigned long &rowsDrawn, unsigned long &rowsDecoded) const;
+	unsigned char * wramdata() const { return cart_.wramdata(0); }
+	unsigned char * wramdataend() const { return cart_.wramdataend(); }
+	unsigned char * sramdata() const { return cart_.rambankdata(); }
+	unsigned char * sramdataend() const { return cart_.rambankdataend(); }
+	unsigned char * hramdata() { return ioamhram_ + 0x180; }
+
 	void setDmgPaletteColor(int palNum, int colorNum, unsigned long rgb32) {
 		lcd_.setDmgPaletteColor(palNum, colorNum, rgb32);
 	}
@@ -120,6 +171,7 @@ private:
 	Cartridge cart_;
 	unsigned char ioamhram_[0x200];
 	InputGetter *getInput_;
+	LinkCable *linkCable_;
 	unsigned long divLastUpdate_;
 	unsigned long lastOamDmaUpdate_;
 	InterruptRequester intreq_;
@@ -129,16 +181,27 @@ private:
 	Interrupter interrupter_;
 	unsigned short dmaSource_;
 	unsigned short dmaDestination_;
+	unsigned long oamDmaTransfers_;
+	unsigned long oamDmaBatched_;
 	unsigned char oamDmaPos_;
 	unsigned char serialCnt_;
+	unsigned char latchedInput_;
 	bool blanklcd_;
+	bool oamDmaSplit_;
+	bool lateInputLatch_;
+	bool inputLatched_;
+#ifdef ENABLE_PROFILER
+	Profiler profiler_;
+#endif
 
 	void decEventCycles(IntEventId eventId, unsigned long dec);
+	void latchInput();
 	void oamDmaInitSetup();
 	void updateOamDma(unsigned long cycleCounter);
 	void startOamDma(unsigned long cycleCounter);
 	void endOamDma(unsigned long cycleCounter);
 	unsigned char const * oamDmaSrcPtr() const;
+	bool bulkDma(unsigned src, unsigned dest, unsigned length, unsigned long &cycleCounter);
 	unsigned nontrivial_ff_read(unsigned p, unsigned long cycleCounter);
 	unsigned nontrivial_read(unsigned p, unsigned long cycleCounter);
 	void nontrivial_ff_write(unsigned p, unsigned data, unsigned long cycleCounter);
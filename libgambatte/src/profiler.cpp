@@ -0,0 +1,99 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct MoreCycles {
+	unsigned long const *cycles;
+	unsigned long const *instructions;
+
+	bool operator()(std::size_t lhs, std::size_t rhs) const {
+		return cycles[lhs] != cycles[rhs]
+		     ? cycles[lhs] > cycles[rhs]
+		     : instructions[lhs] > instructions[rhs];
+	}
+};
+
+}
+
+namespace gambatte {
+
+Profiler::Profiler() {
+	reset(0);
+}
+
+void Profiler::reset(std::size_t const romSize) {
+	instructions_.reset(romSize + 0x8000);
+	cycles_.reset(romSize + 0x8000);
+	std::memset(instructions_, 0, instructions_.size() * sizeof *instructions_);
+	std::memset(cycles_, 0, cycles_.size() * sizeof *cycles_);
+	std::memset(reads_, 0, sizeof reads_);
+	std::memset(writes_, 0, sizeof writes_);
+	romSize_ = romSize;
+	last_ = 0;
+	lastCc_ = -1ul;
+}
+
+void Profiler::slowAccesses(unsigned long &reads, unsigned long &writes) const {
+	reads = writes = 0;
+	for (int page = 0; page < 0x100; ++page) {
+		reads += reads_[page];
+		writes += writes_[page];
+	}
+}
+
+bool Profiler::write(char const *const path) const {
+	std::FILE *const file = std::fopen(path, "w");
+	if (!file)
+		return false;
+
+	std::vector<std::size_t> hot;
+	unsigned long long totalInstructions = 0, totalCycles = 0;
+	for (std::size_t i = 0; i < instructions_.size(); ++i) {
+		if (instructions_[i]) {
+			hot.push_back(i);
+			totalInstructions += instructions_[i];
+			totalCycles += cycles_[i];
+		}
+	}
+
+	MoreCycles const moreCycles = { cycles_, instructions_ };
+	std::sort(hot.begin(), hot.end(), moreCycles);
+
+	std::fprintf(file, "# %llu instructions, %llu cycles\n"
+	                   "# cycles until the next instruction are charged to the one before\n"
+	                   "#\n"
+	                   "# bank:pc   instructions       cycles  cycles%%\n",
+	             totalInstructions, totalCycles);
+	for (std::size_t n = 0; n < hot.size(); ++n) {
+		std::size_t const i = hot[n];
+		if (i < romSize_) {
+			unsigned const bank = i >> 14;
+			std::fprintf(file, "%6X:%04X", bank, unsigned(i & 0x3FFF) | (bank ? 0x4000 : 0));
+		} else
+			std::fprintf(file, "   RAM:%04X", unsigned(i - romSize_ + 0x8000));
+
+		std::fprintf(file, " %12lu %12lu %8.3f\n", instructions_[i], cycles_[i],
+		             totalCycles ? 100.0 * cycles_[i] / totalCycles : 0.0);
+	}
+
+	std::fputs("#\n# nontrivial reads and writes per page\n#\n# page        reads       writes\n", file);
+	for (unsigned page = 0; page < 0x100; ++page) {
+		if (reads_[page] || writes_[page])
+			std::fprintf(file, "  %02X00 %12lu %12lu\n", page, reads_[page], writes_[page]);
+	}
+
+	bool const ok = !std::ferror(file);
+	std::fclose(file);
+	return ok;
+}
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Where the running ROM spends its time, for finding idle loops worth
+// skipping, checking what a speedhack bypasses and seeing which games live in
+// the slow memory paths. Built with -DENABLE_PROFILER (make PROFILE=YES,
+// scons profile=1), CPU::process counts instructions and cycles per
+// (ROM bank, PC) and Memory counts its nontrivial reads and writes per 256
+// byte page. Without ENABLE_PROFILER none of it is compiled in.
+
+#ifdef ENABLE_PROFILER
+
+#include "array.h"
+#include <cstddef>
+
+namespace gambatte {
+
+class Profiler {
+public:
+	Profiler();
+
+	/** Starts over for a ROM of romSize bytes. */
+	void reset(std::size_t romSize);
+
+	/**
+	  * Counts an instruction starting at cycle cc. offset is the ROM offset of
+	  * its PC for PCs below 0x8000, and romSize + PC - 0x8000 for PCs above.
+	  *
+	  * The cycles until the next instruction are charged to this one, so HALT
+	  * gets the time spent halted and an instruction gets the interrupt
+	  * dispatch that follows it. An offset out of range is not counted.
+	  */
+	void instruction(std::size_t offset, unsigned long cc) {
+		if (offset >= instructions_.size())
+			return;
+
+		// cc goes back when the core rebases its cycle counter.
+		if (cc >= lastCc_)
+			cycles_[last_] += cc - lastCc_;
+
+		++instructions_[offset];
+		last_ = offset;
+		lastCc_ = cc;
+	}
+
+	void slowRead(unsigned p) { ++reads_[p >> 8]; }
+	void slowWrite(unsigned p) { ++writes_[p >> 8]; }
+
+	/** Slow path reads and writes over all pages since the last reset. */
+	void slowAccesses(unsigned long &reads, unsigned long &writes) const;
+
+	/** Writes the report, hottest code first. Returns false if it could not be written. */
+	bool write(char const *path) const;
+
+private:
+	Array<unsigned long> instructions_;
+	Array<unsigned long> cycles_;
+	unsigned long reads_[0x100];
+	unsigned long writes_[0x100];
+	std::size_t romSize_;
+	std::size_t last_;
+	unsigned long lastCc_;
+};
+
+}
+
+#endif
+
+#endif
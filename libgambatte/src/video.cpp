@@ -260,6 +260,7 @@ void LCD::updateScreen(bool const blanklcd, unsigned long const cycleCounter) {
 	if (blanklcd && ppu_.frameBuf().fb()) {
 		unsigned long color = ppu_.cgb() ? gbcToRgb32(0xFFFF) : dmgColorsRgb32_[0];
 		clear(ppu_.frameBuf().fb(), color, ppu_.frameBuf().pitch());
+		ppu_.rehashLines(0, 144);
 	}
 
 	if (ppu_.frameBuf().fb() && osdElement_) {
@@ -278,9 +279,13 @@ void LCD::updateScreen(bool const blanklcd, unsigned long const cycleCounter) {
 				               ppu_.frameBuf().pitch(), Blend<4>());
 				break;
 			}
+
+			ppu_.rehashLines(osdElement_->y(), osdElement_->y() + osdElement_->h());
 		} else
 			osdElement_.reset();
 	}
+
+	ppu_.finishFrame();
 }
 
 void LCD::resetCc(unsigned long const oldCc, unsigned long const newCc) {
@@ -389,6 +394,29 @@ bool LCD::vramAccessible(unsigned long const cc) {
 	    || cc + isDoubleSpeed() - ppu_.cgb() + 2 >= m0TimeOfCurrentLine(cc);
 }
 
+// True if VRAM is accessible at cc and stays so up to end without the PPU
+// fetching from it in between, so that writes made at any time in that span
+// can all be made at end instead.
+bool LCD::vramAccessibleThrough(unsigned long const cc, unsigned long const end) {
+	if (!vramAccessible(cc))
+		return false;
+
+	if (!(ppu_.lcdc() & lcdc_en))
+		return true;
+
+	LyCounter const &lyCounter = ppu_.lyCounter();
+	if (lyCounter.ly() >= 144)
+		return end < lyCounter.time() + (153ul - lyCounter.ly()) * lyCounter.lineTime();
+
+	if (end >= lyCounter.time())
+		return false;
+
+	if (lyCounter.lineCycles(cc) < 80)
+		return lyCounter.lineCycles(end) < 80;
+
+	return cc >= m0TimeOfCurrentLine(cc);
+}
+
 bool LCD::cgbpAccessible(unsigned long const cc) {
 	if (cc >= eventTimes_.nextEventTime())
 		update(cc);
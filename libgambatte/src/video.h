@@ -56,6 +56,8 @@ public:
 	void setDmgPaletteColor(unsigned palNum, unsigned colorNum, unsigned long rgb32);
 	void setColorFilter(int activated, int filtercolors[12]);
 	void setVideoBuffer(uint_least32_t *videoBuf, std::ptrdiff_t pitch);
+	uint_least64_t const * lineHashes() const { return ppu_.frameBuf().lineHashes(); }
+	TileCache const & tileCache() const { return ppu_.tileCache(); }
 	void setOsdElement(transfer_ptr<OsdElement> osdElement) { osdElement_ = osdElement; }
 
 	void dmgBgPaletteChange(unsigned data, unsigned long cycleCounter) {
@@ -98,6 +100,7 @@ public:
 	void resetCc(unsigned long oldCC, unsigned long newCc);
 	void speedChange(unsigned long cycleCounter);
 	bool vramAccessible(unsigned long cycleCounter);
+	bool vramAccessibleThrough(unsigned long cycleCounter, unsigned long end);
 	bool oamReadable(unsigned long cycleCounter);
 	bool oamWritable(unsigned long cycleCounter);
 	void wxChange(unsigned newValue, unsigned long cycleCounter);
@@ -106,7 +109,11 @@ public:
 	void oamChange(const unsigned char *oamram, unsigned long cycleCounter);
 	void scxChange(unsigned newScx, unsigned long cycleCounter);
 	void scyChange(unsigned newValue, unsigned long cycleCounter);
-	void vramChange(unsigned long cycleCounter) { update(cycleCounter); }
+	void vramChange(unsigned long cycleCounter, unsigned offset, unsigned length) {
+		update(cycleCounter);
+		ppu_.vramChange(offset, length);
+	}
+
 	unsigned getStat(unsigned lycReg, unsigned long cycleCounter);
 
 	unsigned getLyReg(unsigned long const cc) {
@@ -99,7 +99,7 @@ namespace StartWindowDraw {
 enum { win_draw_start = 1, win_draw_started = 2 };
 enum { m2_ds_offset = 3 };
 enum { max_m3start_cycles = 80 };
-enum { attr_yflip = 0x40, attr_bgpriority = 0x80 };
+enum { attr_xflip = 0x20, attr_yflip = 0x40, attr_bgpriority = 0x80 };
 
 static inline int lcdcEn(   PPUPriv const &p) { return p.lcdc & lcdc_en;    }
 static inline int lcdcWinEn(PPUPriv const &p) { return p.lcdc & lcdc_we;    }
@@ -320,8 +320,9 @@ namespace M3Loop {
 static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, uint_least32_t *const dbufline,
 		unsigned char const *const tileMapLine, unsigned const tileline, unsigned tileMapXpos) {
 	unsigned const tileIndexSign = ~p.lcdc << 3 & 0x80;
-	unsigned char const *const tileDataLine = p.vram + tileIndexSign * 32 + tileline * 2;
+	unsigned const tileDataLine = tileIndexSign * 32 + tileline * 2;
 	int xpos = p.xpos;
+	p.tileCache.update(p.vram);
 
 	do {
 		int nextSprite = p.nextSprite;
@@ -387,8 +388,7 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, uint_least32_t *c
 				tileMapXpos += n >> 3;
 
 				unsigned const tno = tileMapLine[(tileMapXpos - 1) & 0x1F];
-				ntileword = expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[0]]
-				          + expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[1]] * 2;
+				ntileword = p.tileCache.row(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32, false);
 			} else do {
 				dst[0] = p.bgPalette[ ntileword & 0x0003       ];
 				dst[1] = p.bgPalette[(ntileword & 0x000C) >>  2];
@@ -402,8 +402,7 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, uint_least32_t *c
 
 				unsigned const tno = tileMapLine[tileMapXpos & 0x1F];
 				tileMapXpos = (tileMapXpos & 0x1F) + 1;
-				ntileword = expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[0]]
-				          + expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[1]] * 2;
+				ntileword = p.tileCache.row(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32, false);
 			} while (dst != dstend);
 
 			p.ntileword = ntileword;
@@ -498,12 +497,12 @@ static void doFullTilesUnrolledDmg(PPUPriv &p, int const xend, uint_least32_t *c
 
 		unsigned const tno = tileMapLine[tileMapXpos & 0x1F];
 		tileMapXpos = (tileMapXpos & 0x1F) + 1;
-		p.ntileword = expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[0]]
-		            + expand_lut[(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32)[1]] * 2;
+		p.ntileword = p.tileCache.row(tileDataLine + tno * 16 - (tno & tileIndexSign) * 32, false);
 
 		xpos = xpos + 8;
 	} while (xpos < xend);
 
+	p.tileCache.countDrawn((xpos - p.xpos) >> 3);
 	p.xpos = xpos;
 }
 
@@ -512,6 +511,7 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, uint_least32_t *c
 	int xpos = p.xpos;
 	unsigned char const *const vram = p.vram;
 	unsigned const tdoffset = tileline * 2 + (~p.lcdc & 0x10) * 0x100;
+	p.tileCache.update(vram);
 
 	do {
 		int nextSprite = p.nextSprite;
@@ -580,11 +580,10 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, uint_least32_t *c
 				tileMapXpos = (tileMapXpos & 0x1F) + 1;
 
 				unsigned const tdo = tdoffset & ~(tno << 5);
-				unsigned char const *const td = vram + tno * 16
-				                                     + (nattrib & attr_yflip ? tdo ^ 14 : tdo)
-				                                     + (nattrib << 10 & 0x2000);
-				unsigned short const *const explut = expand_lut + (nattrib << 3 & 0x100);
-				ntileword = explut[td[0]] + explut[td[1]] * 2;
+				ntileword = p.tileCache.row(tno * 16
+				                            + (nattrib & attr_yflip ? tdo ^ 14 : tdo)
+				                            + (nattrib << 10 & 0x2000),
+				                            nattrib & attr_xflip);
 			} while (dst != dstend);
 
 			p.ntileword = ntileword;
@@ -720,20 +719,21 @@ static void doFullTilesUnrolledCgb(PPUPriv &p, int const xend, uint_least32_t *c
 			tileMapXpos = (tileMapXpos & 0x1F) + 1;
 
 			unsigned const tdo = tdoffset & ~(tno << 5);
-			unsigned char const *const td = vram + tno * 16
-			                                     + (nattrib & attr_yflip ? tdo ^ 14 : tdo)
-			                                     + (nattrib << 10 & 0x2000);
-			unsigned short const *const explut = expand_lut + (nattrib << 3 & 0x100);
-			p.ntileword = explut[td[0]] + explut[td[1]] * 2;
+			p.ntileword = p.tileCache.row(tno * 16
+			                              + (nattrib & attr_yflip ? tdo ^ 14 : tdo)
+			                              + (nattrib << 10 & 0x2000),
+			                              nattrib & attr_xflip);
 			p.nattrib   = nattrib;
 		}
 
 		xpos = xpos + 8;
 	} while (xpos < xend);
 
+	p.tileCache.countDrawn((xpos - p.xpos) >> 3);
 	p.xpos = xpos;
 }
 
+template<bool cgb>
 static void doFullTilesUnrolled(PPUPriv &p) {
 	int xpos = p.xpos;
 	int const xend = static_cast<int>(p.wx) < xpos || p.wx >= 168
@@ -755,14 +755,14 @@ static void doFullTilesUnrolled(PPUPriv &p) {
 	} else {
 		tileMapLine = p.vram + (p.lcdc << 7 & 0x400)
 		                     + ((p.scy + p.lyCounter.ly()) & 0xF8) * 4 + 0x1800;
-		tileMapXpos = (p.scx + xpos + 1 - p.cgb) >> 3;
+		tileMapXpos = (p.scx + xpos + 1 - cgb) >> 3;
 		tileline    = (p.scy + p.lyCounter.ly()) & 7;
 	}
 
 	if (xpos < 8) {
 		uint_least32_t prebuf[16];
 
-		if (p.cgb) {
+		if (cgb) {
 			doFullTilesUnrolledCgb(p, xend < 8 ? xend : 8, prebuf + (8 - xpos),
 			                       tileMapLine, tileline, tileMapXpos);
 		} else {
@@ -783,12 +783,13 @@ static void doFullTilesUnrolled(PPUPriv &p) {
 		tileMapXpos += (newxpos - xpos) >> 3;
 	}
 
-	if (p.cgb) {
+	if (cgb) {
 		doFullTilesUnrolledCgb(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
 	} else
 		doFullTilesUnrolledDmg(p, xend, dbufline, tileMapLine, tileline, tileMapXpos);
 }
 
+template<bool cgb>
 static void plotPixel(PPUPriv &p) {
 	int const xpos = p.xpos;
 	unsigned const tileword = p.tileword;
@@ -800,11 +801,11 @@ static void plotPixel(PPUPriv &p) {
 		if (p.winDrawState == 0 && lcdcWinEn(p)) {
 			p.winDrawState = win_draw_start | win_draw_started;
 			++p.winYPos;
-		} else if (!p.cgb && (p.winDrawState == 0 || xpos == 166))
+		} else if (!cgb && (p.winDrawState == 0 || xpos == 166))
 			p.winDrawState |= win_draw_start;
 	}
 
-	unsigned const twdata = tileword & ((p.lcdc & 1) | p.cgb) * 3;
+	unsigned const twdata = tileword & ((p.lcdc & 1) | cgb) * 3;
 	unsigned long pixel = p.bgPalette[twdata + (p.attrib & 7) * 4];
 	int i = static_cast<int>(p.nextSprite) - 1;
 
@@ -812,7 +813,7 @@ static void plotPixel(PPUPriv &p) {
 		unsigned spdata = 0;
 		unsigned attrib = 0;
 
-		if (p.cgb) {
+		if (cgb) {
 			unsigned minId = 0xFF;
 
 			do {
@@ -853,17 +854,25 @@ static void plotPixel(PPUPriv &p) {
 	p.tileword = tileword >> 2;
 }
 
+template<bool cgb>
 static void plotPixelIfNoSprite(PPUPriv &p) {
 	if (p.spriteList[p.nextSprite].spx == p.xpos) {
-		if (!(lcdcObjEn(p) | p.cgb)) {
+		if (!(lcdcObjEn(p) | cgb)) {
 			do {
 				++p.nextSprite;
 			} while (p.spriteList[p.nextSprite].spx == p.xpos);
 
-			plotPixel(p);
+			plotPixel<cgb>(p);
 		}
 	} else
-		plotPixel(p);
+		plotPixel<cgb>(p);
+}
+
+static void plotPixelIfNoSprite(PPUPriv &p) {
+	if (p.cgb)
+		plotPixelIfNoSprite<true>(p);
+	else
+		plotPixelIfNoSprite<false>(p);
 }
 
 static unsigned long nextM2Time(PPUPriv const &p) {
@@ -885,6 +894,7 @@ static void xpos168(PPUPriv &p) {
 		?  long((p.now - nextm2) >> p.lyCounter.isDoubleSpeed())
 		: -long((nextm2 - p.now) >> p.lyCounter.isDoubleSpeed());
 
+	p.framebuf.hashLine(p.lyCounter.ly());
 	nextCall(0, p.lyCounter.ly() == 143 ? M2_Ly0::f0_ : M2_LyNon0::f0_, p);
 }
 
@@ -1075,7 +1085,7 @@ namespace Tile {
 		if ((p.winDrawState & win_draw_start) && handleWinDrawStartReq(p))
 			return StartWindowDraw::f0(p);
 
-		doFullTilesUnrolled(p);
+		p.fullTiles(p);
 
 		if (p.xpos == 168) {
 			++p.cycles;
@@ -1142,7 +1152,8 @@ namespace Tile {
 			nextCall(1, f5_, p);
 	}
 
-	static void f5(PPUPriv &p) {
+	template<bool cgb>
+	static void plotRun(PPUPriv &p) {
 		int endx = p.endx;
 		p.nextCallPtr = &f5_;
 
@@ -1151,7 +1162,7 @@ namespace Tile {
 				return StartWindowDraw::f0(p);
 
 			if (p.spriteList[p.nextSprite].spx == p.xpos) {
-				if (lcdcObjEn(p) | p.cgb) {
+				if (lcdcObjEn(p) | cgb) {
 					p.currentSprite = p.nextSprite;
 					return LoadSprites::f0(p);
 				}
@@ -1161,7 +1172,7 @@ namespace Tile {
 				} while (p.spriteList[p.nextSprite].spx == p.xpos);
 			}
 
-			plotPixel(p);
+			plotPixel<cgb>(p);
 
 			if (p.xpos == endx) {
 				if (endx < 168) {
@@ -1173,6 +1184,10 @@ namespace Tile {
 			}
 		} while (--p.cycles >= 0);
 	}
+
+	static void f5(PPUPriv &p) {
+		p.plotRun(p);
+	}
 }
 
 } // namespace M3Loop
@@ -1481,10 +1496,74 @@ namespace M2_LyNon0 {
 	}
 }
 
+// 64-bit FNV-1a over whole pixels, in four interleaved lanes so that the
+// multiplies do not wait on each other, folded into one at the end. A frontend
+// leaves a line alone when its hash matches, and with 32 bits a game that
+// changes every line would have one changed line taken for unchanged about
+// once a week.
+static uint_least64_t hashPixels(uint_least32_t const *line) {
+	uint_least64_t const basis = 14695981039346656037ull;
+	uint_least64_t const prime = 1099511628211ull;
+	uint_least64_t const mask = 0xFFFFFFFFFFFFFFFFull;
+	uint_least64_t h[4] = { basis, basis, basis, basis };
+	for (int i = 0; i < 160; i += 4) {
+		h[0] = (h[0] ^ line[i    ]) * prime & mask;
+		h[1] = (h[1] ^ line[i + 1]) * prime & mask;
+		h[2] = (h[2] ^ line[i + 2]) * prime & mask;
+		h[3] = (h[3] ^ line[i + 3]) * prime & mask;
+	}
+
+	uint_least64_t hash = h[0];
+	for (int i = 1; i < 4; ++i)
+		hash = (hash ^ h[i]) * prime & mask;
+
+	return hash;
+}
+
 } // anon namespace
 
 namespace gambatte {
 
+PPUFrameBuf::PPUFrameBuf()
+: buf_(0)
+, fbline_(nullfbline())
+, pitch_(0)
+{
+	std::fill_n(lineHash_, static_cast<int>(lines), 0);
+	std::fill_n(frameHash_, static_cast<int>(lines), 0);
+	std::fill_n(hashed_, static_cast<int>(lines), false);
+}
+
+void PPUFrameBuf::hashLine(unsigned const ly) {
+	if (buf_ && ly < lines) {
+		lineHash_[ly] = hashPixels(fbline_);
+		hashed_[ly] = true;
+	}
+}
+
+void PPUFrameBuf::rehashLines(unsigned const first, unsigned const end) {
+	if (!buf_)
+		return;
+
+	for (unsigned ly = first; ly < end && ly < lines; ++ly) {
+		lineHash_[ly] = hashPixels(buf_ + std::ptrdiff_t(ly) * pitch_);
+		hashed_[ly] = true;
+	}
+}
+
+void PPUFrameBuf::finishFrame() {
+	if (!buf_)
+		return;
+
+	for (unsigned ly = 0; ly < lines; ++ly) {
+		if (!hashed_[ly])
+			lineHash_[ly] = hashPixels(buf_ + std::ptrdiff_t(ly) * pitch_);
+
+		frameHash_[ly] = lineHash_[ly];
+		hashed_[ly] = false;
+	}
+}
+
 PPUPriv::PPUPriv(NextM0Time &nextM0Time, unsigned char const *const oamram, unsigned char const *const vram)
 : nextSprite(0)
 , currentSprite(0xFF)
@@ -1513,6 +1592,8 @@ PPUPriv::PPUPriv(NextM0Time &nextM0Time, unsigned char const *const oamram, unsi
 , endx(0)
 , cgb(false)
 , weMaster(false)
+, fullTiles(M3Loop::doFullTilesUnrolled<false>)
+, plotRun(M3Loop::Tile::plotRun<false>)
 {
 	std::memset(spriteList, 0, sizeof spriteList);
 	std::memset(spwordList, 0, sizeof spwordList);
@@ -1659,6 +1740,7 @@ void PPU::loadState(SaveState const &ss, unsigned char const *const oamram) {
 	p_.lyCounter.setDoubleSpeed(ds);
 	p_.lyCounter.reset(std::min(ss.ppu.videoCycles, 70223ul), ss.cpu.cycleCounter);
 	p_.spriteMapper.loadState(ss, oamram);
+	p_.tileCache.invalidateAll();
 	p_.winYPos = ss.ppu.winYPos;
 	p_.scy = ss.mem.ioamhram.get()[0x142];
 	p_.scx = ss.mem.ioamhram.get()[0x143];
@@ -1712,7 +1794,11 @@ void PPU::loadState(SaveState const &ss, unsigned char const *const oamram) {
 void PPU::reset(unsigned char const *oamram, unsigned char const *vram, bool cgb) {
 	p_.vram = vram;
 	p_.cgb = cgb;
+	p_.fullTiles = cgb ? M3Loop::doFullTilesUnrolled<true> : M3Loop::doFullTilesUnrolled<false>;
+	p_.plotRun = cgb ? M3Loop::Tile::plotRun<true> : M3Loop::Tile::plotRun<false>;
 	p_.spriteMapper.reset(oamram, cgb);
+	p_.tileCache.invalidateAll();
+	p_.tileCache.resetStats();
 }
 
 void PPU::resetCc(unsigned long const oldCc, unsigned long const newCc) {
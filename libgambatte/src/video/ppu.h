@@ -22,6 +22,7 @@
 #include "lcddef.h"
 #include "ly_counter.h"
 #include "sprite_mapper.h"
+#include "tile_cache.h"
 #include "gbint.h"
 #include <cstddef>
 
@@ -29,17 +30,31 @@ namespace gambatte {
 
 class PPUFrameBuf {
 public:
-	PPUFrameBuf() : buf_(0), fbline_(nullfbline()), pitch_(0) {}
+	enum { lines = 144 };
+
+	PPUFrameBuf();
 	uint_least32_t * fb() const { return buf_; }
 	uint_least32_t * fbline() const { return fbline_; }
 	std::ptrdiff_t pitch() const { return pitch_; }
 	void setBuf(uint_least32_t *buf, std::ptrdiff_t pitch) { buf_ = buf; pitch_ = pitch; fbline_ = nullfbline(); }
 	void setFbline(unsigned ly) { fbline_ = buf_ ? buf_ + std::ptrdiff_t(ly) * pitch_ : nullfbline(); }
 
+	/** Hashes line ly right after it has been drawn, while it is still in cache. */
+	void hashLine(unsigned ly);
+	/** Hashes lines [first, end) again after something drew over them. */
+	void rehashLines(unsigned first, unsigned end);
+	/** Hashes the lines that were not drawn this frame and publishes the hashes of the frame. */
+	void finishFrame();
+	/** Line hashes of the last finished frame. */
+	uint_least64_t const * lineHashes() const { return frameHash_; }
+
 private:
 	uint_least32_t *buf_;
 	uint_least32_t *fbline_;
 	std::ptrdiff_t pitch_;
+	uint_least64_t lineHash_[lines];
+	uint_least64_t frameHash_[lines];
+	bool hashed_[lines];
 
 	static uint_least32_t * nullfbline() { static uint_least32_t nullfbline_[160]; return nullfbline_; }
 };
@@ -73,6 +88,7 @@ struct PPUPriv {
 	SpriteMapper spriteMapper;
 	LyCounter lyCounter;
 	PPUFrameBuf framebuf;
+	TileCache tileCache;
 
 	unsigned char lcdc;
 	unsigned char scy;
@@ -93,6 +109,13 @@ struct PPUPriv {
 	bool cgb;
 	bool weMaster;
 
+	/**
+	  * Mode 3 pixel loops built for the console model by PPU::reset, so that
+	  * they do not test cgb for every pixel.
+	  */
+	void (*fullTiles)(PPUPriv &p);
+	void (*plotRun)(PPUPriv &p);
+
 	PPUPriv(NextM0Time &nextM0Time, unsigned char const *oamram, unsigned char const *vram);
 };
 
@@ -108,6 +131,7 @@ public:
 	void doLyCountEvent() { p_.lyCounter.doEvent(); }
 	unsigned long doSpriteMapEvent(unsigned long time) { return p_.spriteMapper.doEvent(time); }
 	PPUFrameBuf const & frameBuf() const { return p_.framebuf; }
+	void finishFrame() { p_.framebuf.finishFrame(); }
 
 	bool inactivePeriodAfterDisplayEnable(unsigned long cc) const {
 		return p_.spriteMapper.inactivePeriodAfterDisplayEnable(cc);
@@ -121,6 +145,7 @@ public:
 	void oamChange(unsigned long cc) { p_.spriteMapper.oamChange(cc); }
 	void oamChange(unsigned char const *oamram, unsigned long cc) { p_.spriteMapper.oamChange(oamram, cc); }
 	unsigned long predictedNextXposTime(unsigned xpos) const;
+	void rehashLines(unsigned first, unsigned end) { p_.framebuf.rehashLines(first, end); }
 	void reset(unsigned char const *oamram, unsigned char const *vram, bool cgb);
 	void resetCc(unsigned long oldCc, unsigned long newCc);
 	void saveState(SaveState &ss) const;
@@ -134,7 +159,9 @@ public:
 	void updateWy2() { p_.wy2 = p_.wy; }
 	void speedChange(unsigned long cycleCounter);
 	unsigned long * spPalette() { return p_.spPalette; }
+	TileCache const & tileCache() const { return p_.tileCache; }
 	void update(unsigned long cc);
+	void vramChange(unsigned offset, unsigned length) { p_.tileCache.invalidate(offset, length); }
 
 private:
 	PPUPriv p_;
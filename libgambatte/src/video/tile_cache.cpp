@@ -0,0 +1,71 @@
+#include "tile_cache.h"
+
+namespace {
+
+// bit n of b to bit 2n.
+unsigned spread(unsigned b) {
+	b = (b | b << 4) & 0x0F0F;
+	b = (b | b << 2) & 0x3333;
+	return (b | b << 1) & 0x5555;
+}
+
+unsigned reverse(unsigned b) {
+	b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+	b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+	return (b & 0xAA) >> 1 | (b & 0x55) << 1;
+}
+
+}
+
+namespace gambatte {
+
+TileCache::TileCache()
+: rowsDrawn_(0)
+, rowsDecoded_(0)
+{
+	invalidateAll();
+}
+
+void TileCache::invalidate(unsigned const offset, unsigned const length) {
+	unsigned const end = (offset + length + 15) >> 4;
+	for (unsigned tile = offset >> 4; tile < end && tile < num_tiles; ++tile) {
+		// the tile maps take up the rest of bank 0
+		if ((tile & 0x1FF) < 0x180) {
+			changed_[tile >> 5] |= 1ul << (tile & 31);
+			anyChanged_ = true;
+		}
+	}
+}
+
+void TileCache::invalidateAll() {
+	for (unsigned i = 0; i < sizeof changed_ / sizeof changed_[0]; ++i)
+		changed_[i] = (i & 15) < 0x180 / 32 ? 0xFFFFFFFF : 0;
+
+	anyChanged_ = true;
+}
+
+void TileCache::decodeChanged(unsigned char const *const vram) {
+	for (unsigned i = 0; i < sizeof changed_ / sizeof changed_[0]; ++i) {
+		if (!changed_[i])
+			continue;
+
+		for (unsigned tile = i * 32; tile < i * 32 + 32; ++tile) {
+			if (!(changed_[i] >> (tile & 31) & 1))
+				continue;
+
+			for (unsigned row = tile * 8; row < tile * 8 + 8; ++row) {
+				unsigned const b0 = vram[row * 2], b1 = vram[row * 2 + 1];
+				rows_[0][row] = spread(reverse(b0)) | spread(reverse(b1)) << 1;
+				rows_[1][row] = spread(b0) | spread(b1) << 1;
+			}
+
+			rowsDecoded_ += 8;
+		}
+
+		changed_[i] = 0;
+	}
+
+	anyChanged_ = false;
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+namespace gambatte {
+
+/**
+  * Tile data rows of both VRAM banks expanded to two bits per pixel, leftmost
+  * pixel lowest, the way the PPU draws them. Every row is kept as is and
+  * horizontally flipped.
+  *
+  * Tile data changes far less often than it is drawn, so writes only mark the
+  * tiles they hit as changed, and update() expands those again before the
+  * next rows are drawn.
+  */
+class TileCache {
+public:
+	TileCache();
+
+	/** Marks the tiles overlapping [offset, offset + length) of VRAM as changed. */
+	void invalidate(unsigned offset, unsigned length);
+	void invalidateAll();
+
+	void update(unsigned char const *vram) {
+		if (anyChanged_)
+			decodeChanged(vram);
+	}
+
+	/**
+	  * The row whose first byte is at offset in VRAM, which must be within the
+	  * tile data of one of the banks. Only valid after update().
+	  */
+	unsigned row(unsigned offset, bool hflip) const { return rows_[hflip][offset >> 1]; }
+
+	void countDrawn(unsigned rows) { rowsDrawn_ += rows; }
+	unsigned long rowsDrawn() const { return rowsDrawn_; }
+	unsigned long rowsDecoded() const { return rowsDecoded_; }
+	void resetStats() { rowsDrawn_ = rowsDecoded_ = 0; }
+
+private:
+	// tile data ends at 0x1800 in bank 0 and 0x3800 in bank 1
+	enum { num_tiles = 0x3800 / 16 };
+
+	unsigned short rows_[2][num_tiles * 8];
+	unsigned long changed_[(num_tiles + 31) / 32];
+	unsigned long rowsDrawn_;
+	unsigned long rowsDecoded_;
+	bool anyChanged_;
+
+	void decodeChanged(unsigned char const *vram);
+};
+
+}
+
+#endif